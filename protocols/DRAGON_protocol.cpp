@@ -0,0 +1,369 @@
+#include "DRAGON_protocol.h"
+#include "../sim/mreq.h"
+#include "../sim/sim.h"
+#include "../sim/checkpoint.h"
+#include "../sim/hash_table.h"
+
+extern Simulator *Sim;
+
+/*************************
+ * Constructor/Destructor.
+ *************************/
+DRAGON_protocol::DRAGON_protocol (Hash_table *my_table, Hash_entry *my_entry)
+    : Protocol (my_table, my_entry)
+{
+    this->state = DRAGON_CACHE_I;
+}
+
+DRAGON_protocol::~DRAGON_protocol ()
+{
+}
+
+void DRAGON_protocol::dump (void)
+{
+    const char *block_states[10] = {"X","I","E","Sc","Sm","M","IS","IM","ScU","SmU"};
+    fprintf (stderr, "DRAGON_protocol - state: %s\n", block_states[state]);
+}
+
+void DRAGON_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t DRAGON_protocol::get_permission (void)
+{
+    switch (state) {
+    case DRAGON_CACHE_I: return PERM_INVALID;
+    case DRAGON_CACHE_E: return PERM_WRITE;
+    case DRAGON_CACHE_SC: return PERM_READ;
+    case DRAGON_CACHE_SM: return PERM_READ;
+    case DRAGON_CACHE_M: return PERM_WRITE;
+    case DRAGON_CACHE_IS: return PERM_PENDING;
+    case DRAGON_CACHE_IM: return PERM_PENDING;
+    case DRAGON_CACHE_SCU: return PERM_PENDING;
+    case DRAGON_CACHE_SMU: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for DRAGON Protocol\n");
+    }
+}
+
+bool DRAGON_protocol::cancel_store (void)
+{
+    switch (state) {
+    case DRAGON_CACHE_IM: state = DRAGON_CACHE_I; return true;
+    case DRAGON_CACHE_SCU: state = DRAGON_CACHE_SC; return true;
+    case DRAGON_CACHE_SMU: state = DRAGON_CACHE_SM; return true;
+    default: return false;
+    }
+}
+
+void DRAGON_protocol::process_cache_request (Mreq *request)
+{
+	switch (state) {
+    case DRAGON_CACHE_I:  do_cache_I (request); break;
+    case DRAGON_CACHE_E:  do_cache_E (request); break;
+    case DRAGON_CACHE_SC: do_cache_SC (request); break;
+    case DRAGON_CACHE_SM: do_cache_SM (request); break;
+    case DRAGON_CACHE_M:  do_cache_M (request); break;
+    case DRAGON_CACHE_IS:
+    case DRAGON_CACHE_IM:
+    case DRAGON_CACHE_SCU:
+    case DRAGON_CACHE_SMU: do_cache_pending (request); break;
+    default:
+        fatal_error ("Invalid Cache State for DRAGON Protocol\n");
+    }
+}
+
+void DRAGON_protocol::process_snoop_request (Mreq *request)
+{
+	switch (state) {
+    case DRAGON_CACHE_I:   do_snoop_I (request); break;
+    case DRAGON_CACHE_E:   do_snoop_E (request); break;
+    case DRAGON_CACHE_SC:  do_snoop_SC (request); break;
+    case DRAGON_CACHE_SM:  do_snoop_SM (request); break;
+    case DRAGON_CACHE_M:   do_snoop_M (request); break;
+    case DRAGON_CACHE_IS:  do_snoop_IS (request); break;
+    case DRAGON_CACHE_IM:  do_snoop_IM (request); break;
+    case DRAGON_CACHE_SCU: do_snoop_SCU (request); break;
+    case DRAGON_CACHE_SMU: do_snoop_SMU (request); break;
+    default:
+    	fatal_error ("Invalid Cache State for DRAGON Protocol\n");
+    }
+}
+
+inline void DRAGON_protocol::do_cache_I (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+    	send_GETS(request->addr);
+    	state = DRAGON_CACHE_IS;
+    	count_miss ();
+    	break;
+    case STORE:
+    	/* There is no GETM: fetch the line, then update the other copies
+    	 * if it turns out to be shared.
+    	 */
+    	send_GETS(request->addr);
+    	state = DRAGON_CACHE_IM;
+    	count_miss ();
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: I state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_cache_E (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+        send_DATA_to_proc(request->addr);
+    	break;
+    case STORE:
+        send_DATA_to_proc(request->addr);
+        state = DRAGON_CACHE_M;
+        Sim->silent_upgrades++;
+        break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: E state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_cache_SC (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+        send_DATA_to_proc(request->addr);
+    	break;
+    case STORE:
+    	/* Broadcast the new value; the other copies stay valid.  */
+        send_BUSUPD(request->addr);
+        state = DRAGON_CACHE_SCU;
+        break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: Sc state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_cache_SM (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+        send_DATA_to_proc(request->addr);
+    	break;
+    case STORE:
+        send_BUSUPD(request->addr);
+        state = DRAGON_CACHE_SMU;
+        break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: Sm state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_cache_M (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+    case STORE:
+    	send_DATA_to_proc(request->addr);
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: M state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_cache_pending (Mreq *request)
+{
+	/* Transient states mean a bus transaction is outstanding for the
+	 * processor's only request.
+	 */
+    request->print_msg (my_table->moduleID, "ERROR");
+	fatal_error("Should only have one outstanding request per processor!");
+}
+
+inline void DRAGON_protocol::do_snoop_I (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    case BUSUPD:
+    case DATA:
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: I state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_snoop_E (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	/* Clean, so memory supplies the data.  */
+    	set_shared_line();
+    	state = DRAGON_CACHE_SC;
+    	break;
+    case BUSUPD:
+    case DATA:
+    	fatal_error ("Should not see this for a line I hold exclusively!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: E state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_snoop_SC (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    case BUSUPD:
+    	/* Another copy exists (or is being updated); we stay valid.  */
+    	set_shared_line();
+    	break;
+    case DATA:
+    	fatal_error ("Should not see data for this line!  I have the line!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: Sc state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_snoop_SM (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	/* We own the dirty line, so we supply it.  */
+    	set_shared_line();
+    	send_DATA_on_bus(request->addr,request->src_mid);
+    	break;
+    case BUSUPD:
+    	/* The updater becomes the owner.  */
+    	set_shared_line();
+    	state = DRAGON_CACHE_SC;
+    	break;
+    case DATA:
+    	fatal_error ("Should not see data for this line!  I have the line!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: Sm state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_snoop_M (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	set_shared_line();
+    	send_DATA_on_bus(request->addr,request->src_mid);
+    	state = DRAGON_CACHE_SM;
+    	break;
+    case BUSUPD:
+    case DATA:
+    	fatal_error ("Should not see this for a line I hold exclusively!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: M state shouldn't see this message\n");
+    }
+}
+
+inline void DRAGON_protocol::do_snoop_IS (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case BUSUPD:
+		/* Our own GETS, or traffic for data we don't have yet.  */
+		break;
+	case DATA:
+		send_DATA_to_proc(request->addr);
+		state = get_shared_line() ? DRAGON_CACHE_SC : DRAGON_CACHE_E;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: IS state shouldn't see this message\n");
+	}
+}
+
+inline void DRAGON_protocol::do_snoop_IM (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case BUSUPD:
+		break;
+	case DATA:
+		/* Shared: the write still has to be broadcast before the store
+		 * completes.  Otherwise we now hold the only copy.
+		 */
+		if (get_shared_line())
+		{
+			send_BUSUPD(request->addr);
+			state = DRAGON_CACHE_SCU;
+		}
+		else
+		{
+			send_DATA_to_proc(request->addr);
+			state = DRAGON_CACHE_M;
+		}
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: IM state shouldn't see this message\n");
+	}
+}
+
+inline void DRAGON_protocol::do_snoop_SCU (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+		set_shared_line();
+		break;
+	case BUSUPD:
+		if (request->src_mid == my_table->moduleID)
+			complete_BUSUPD(request->addr);
+		else
+			set_shared_line();
+		break;
+	case DATA:
+		/* Our update is done.  If nobody else held a copy we are exclusive.  */
+		send_DATA_to_proc(request->addr);
+		state = get_shared_line() ? DRAGON_CACHE_SM : DRAGON_CACHE_M;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: ScU state shouldn't see this message\n");
+	}
+}
+
+inline void DRAGON_protocol::do_snoop_SMU (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+		set_shared_line();
+		send_DATA_on_bus(request->addr,request->src_mid);
+		break;
+	case BUSUPD:
+		if (request->src_mid == my_table->moduleID)
+		{
+			complete_BUSUPD(request->addr);
+		}
+		else
+		{
+			set_shared_line();
+			state = DRAGON_CACHE_SCU;
+		}
+		break;
+	case DATA:
+		send_DATA_to_proc(request->addr);
+		state = get_shared_line() ? DRAGON_CACHE_SM : DRAGON_CACHE_M;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: SmU state shouldn't see this message\n");
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef _DRAGON_CACHE_H
+#define _DRAGON_CACHE_H
+
+#include "../sim/types.h"
+#include "../sim/enums.h"
+#include "../sim/module.h"
+#include "../sim/mreq.h"
+#include "protocol.h"
+
+/** Cache states.  Dragon never invalidates: a write to a shared line is
+ *  broadcast with BUSUPD and the other copies are updated in place.  */
+typedef enum {
+    DRAGON_CACHE_I = 1,
+    DRAGON_CACHE_E,      // Exclusive clean
+    DRAGON_CACHE_SC,     // Shared clean
+    DRAGON_CACHE_SM,     // Shared modified (owner, supplies data)
+    DRAGON_CACHE_M,      // Exclusive modified
+    DRAGON_CACHE_IS,
+    DRAGON_CACHE_IM,
+    DRAGON_CACHE_SCU,    // Shared clean, own BUSUPD pending
+    DRAGON_CACHE_SMU     // Shared modified, own BUSUPD pending
+} DRAGON_cache_state_t;
+
+class DRAGON_protocol : public Protocol {
+public:
+    DRAGON_protocol (Hash_table *my_table, Hash_entry *my_entry);
+    ~DRAGON_protocol ();
+
+    DRAGON_cache_state_t state;
+
+    void process_cache_request (Mreq *request);
+    void process_snoop_request (Mreq *request);
+    void dump (void);
+    perm_t get_permission (void);
+    bool cancel_store (void);
+    void checkpoint (Checkpoint *ckpt);
+
+    inline void do_cache_I (Mreq *request);
+    inline void do_cache_E (Mreq *request);
+    inline void do_cache_SC (Mreq *request);
+    inline void do_cache_SM (Mreq *request);
+    inline void do_cache_M (Mreq *request);
+    inline void do_cache_pending (Mreq *request);
+
+    inline void do_snoop_I (Mreq *request);
+    inline void do_snoop_E (Mreq *request);
+    inline void do_snoop_SC (Mreq *request);
+    inline void do_snoop_SM (Mreq *request);
+    inline void do_snoop_M (Mreq *request);
+    inline void do_snoop_IS (Mreq *request);
+    inline void do_snoop_IM (Mreq *request);
+    inline void do_snoop_SCU (Mreq *request);
+    inline void do_snoop_SMU (Mreq *request);
+};
+
+#endif // _DRAGON_CACHE_H
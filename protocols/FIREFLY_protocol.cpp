@@ -0,0 +1,290 @@
+#include "FIREFLY_protocol.h"
+#include "../sim/mreq.h"
+#include "../sim/sim.h"
+#include "../sim/checkpoint.h"
+#include "../sim/hash_table.h"
+
+extern Simulator *Sim;
+
+/*************************
+ * Constructor/Destructor.
+ *************************/
+FIREFLY_protocol::FIREFLY_protocol (Hash_table *my_table, Hash_entry *my_entry)
+    : Protocol (my_table, my_entry)
+{
+    this->state = FIREFLY_CACHE_I;
+}
+
+FIREFLY_protocol::~FIREFLY_protocol ()
+{
+}
+
+void FIREFLY_protocol::dump (void)
+{
+    const char *block_states[8] = {"X","I","V","S","D","IS","IM","SU"};
+    fprintf (stderr, "FIREFLY_protocol - state: %s\n", block_states[state]);
+}
+
+void FIREFLY_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t FIREFLY_protocol::get_permission (void)
+{
+    switch (state) {
+    case FIREFLY_CACHE_I: return PERM_INVALID;
+    case FIREFLY_CACHE_V: return PERM_WRITE;
+    case FIREFLY_CACHE_S: return PERM_READ;
+    case FIREFLY_CACHE_D: return PERM_WRITE;
+    case FIREFLY_CACHE_IS: return PERM_PENDING;
+    case FIREFLY_CACHE_IM: return PERM_PENDING;
+    case FIREFLY_CACHE_SU: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for FIREFLY Protocol\n");
+    }
+}
+
+bool FIREFLY_protocol::cancel_store (void)
+{
+    switch (state) {
+    case FIREFLY_CACHE_IM: state = FIREFLY_CACHE_I; return true;
+    case FIREFLY_CACHE_SU: state = FIREFLY_CACHE_S; return true;
+    default: return false;
+    }
+}
+
+void FIREFLY_protocol::process_cache_request (Mreq *request)
+{
+	switch (state) {
+    case FIREFLY_CACHE_I:  do_cache_I (request); break;
+    case FIREFLY_CACHE_V:  do_cache_V (request); break;
+    case FIREFLY_CACHE_S:  do_cache_S (request); break;
+    case FIREFLY_CACHE_D:  do_cache_D (request); break;
+    case FIREFLY_CACHE_IS:
+    case FIREFLY_CACHE_IM:
+    case FIREFLY_CACHE_SU: do_cache_pending (request); break;
+    default:
+        fatal_error ("Invalid Cache State for FIREFLY Protocol\n");
+    }
+}
+
+void FIREFLY_protocol::process_snoop_request (Mreq *request)
+{
+	switch (state) {
+    case FIREFLY_CACHE_I:  do_snoop_I (request); break;
+    case FIREFLY_CACHE_V:  do_snoop_V (request); break;
+    case FIREFLY_CACHE_S:  do_snoop_S (request); break;
+    case FIREFLY_CACHE_D:  do_snoop_D (request); break;
+    case FIREFLY_CACHE_IS: do_snoop_IS (request); break;
+    case FIREFLY_CACHE_IM: do_snoop_IM (request); break;
+    case FIREFLY_CACHE_SU: do_snoop_SU (request); break;
+    default:
+    	fatal_error ("Invalid Cache State for FIREFLY Protocol\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_cache_I (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+    	send_GETS(request->addr);
+    	state = FIREFLY_CACHE_IS;
+    	count_miss ();
+    	break;
+    case STORE:
+    	/* Fetch the line, then write through if it turns out to be shared.  */
+    	send_GETS(request->addr);
+    	state = FIREFLY_CACHE_IM;
+    	count_miss ();
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: I state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_cache_V (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+        send_DATA_to_proc(request->addr);
+    	break;
+    case STORE:
+        send_DATA_to_proc(request->addr);
+        state = FIREFLY_CACHE_D;
+        Sim->silent_upgrades++;
+        break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: V state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_cache_S (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+        send_DATA_to_proc(request->addr);
+    	break;
+    case STORE:
+    	/* Write through to memory and the other copies.  */
+        send_BUSUPD(request->addr);
+        state = FIREFLY_CACHE_SU;
+        break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: S state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_cache_D (Mreq *request)
+{
+    switch (request->msg) {
+    case LOAD:
+    case STORE:
+    	send_DATA_to_proc(request->addr);
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: D state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_cache_pending (Mreq *request)
+{
+	/* Transient states mean a bus transaction is outstanding for the
+	 * processor's only request.
+	 */
+    request->print_msg (my_table->moduleID, "ERROR");
+	fatal_error("Should only have one outstanding request per processor!");
+}
+
+inline void FIREFLY_protocol::do_snoop_I (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    case BUSUPD:
+    case DATA:
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: I state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_snoop_V (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	/* Clean, so memory supplies the data.  */
+    	set_shared_line();
+    	state = FIREFLY_CACHE_S;
+    	break;
+    case BUSUPD:
+    case DATA:
+    	fatal_error ("Should not see this for a line I hold exclusively!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: V state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_snoop_S (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    case BUSUPD:
+    	set_shared_line();
+    	break;
+    case DATA:
+    	fatal_error ("Should not see data for this line!  I have the line!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: S state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_snoop_D (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	/* Supply the dirty line; memory picks it up too, so we are clean.  */
+    	set_shared_line();
+    	send_DATA_on_bus(request->addr,request->src_mid);
+    	state = FIREFLY_CACHE_S;
+    	break;
+    case BUSUPD:
+    case DATA:
+    	fatal_error ("Should not see this for a line I hold exclusively!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: D state shouldn't see this message\n");
+    }
+}
+
+inline void FIREFLY_protocol::do_snoop_IS (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case BUSUPD:
+		break;
+	case DATA:
+		send_DATA_to_proc(request->addr);
+		state = get_shared_line() ? FIREFLY_CACHE_S : FIREFLY_CACHE_V;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: IS state shouldn't see this message\n");
+	}
+}
+
+inline void FIREFLY_protocol::do_snoop_IM (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case BUSUPD:
+		break;
+	case DATA:
+		if (get_shared_line())
+		{
+			send_BUSUPD(request->addr);
+			state = FIREFLY_CACHE_SU;
+		}
+		else
+		{
+			send_DATA_to_proc(request->addr);
+			state = FIREFLY_CACHE_D;
+		}
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: IM state shouldn't see this message\n");
+	}
+}
+
+inline void FIREFLY_protocol::do_snoop_SU (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+		set_shared_line();
+		break;
+	case BUSUPD:
+		if (request->src_mid == my_table->moduleID)
+			complete_BUSUPD(request->addr);
+		else
+			set_shared_line();
+		break;
+	case DATA:
+		/* Written through, so clean either way.  */
+		send_DATA_to_proc(request->addr);
+		state = get_shared_line() ? FIREFLY_CACHE_S : FIREFLY_CACHE_V;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: SU state shouldn't see this message\n");
+	}
+}
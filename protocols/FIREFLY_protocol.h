@@ -0,0 +1,52 @@
+#ifndef _FIREFLY_CACHE_H
+#define _FIREFLY_CACHE_H
+
+#include "../sim/types.h"
+#include "../sim/enums.h"
+#include "../sim/module.h"
+#include "../sim/mreq.h"
+#include "protocol.h"
+
+/** Cache states.  Firefly writes to shared lines through to memory with
+ *  BUSUPD, updating the other copies, so shared lines are always clean
+ *  and only an exclusive line can be dirty.  */
+typedef enum {
+    FIREFLY_CACHE_I = 1,
+    FIREFLY_CACHE_V,     // Valid exclusive, clean
+    FIREFLY_CACHE_S,     // Shared, clean
+    FIREFLY_CACHE_D,     // Dirty exclusive
+    FIREFLY_CACHE_IS,
+    FIREFLY_CACHE_IM,
+    FIREFLY_CACHE_SU     // Shared, own BUSUPD pending
+} FIREFLY_cache_state_t;
+
+class FIREFLY_protocol : public Protocol {
+public:
+    FIREFLY_protocol (Hash_table *my_table, Hash_entry *my_entry);
+    ~FIREFLY_protocol ();
+
+    FIREFLY_cache_state_t state;
+
+    void process_cache_request (Mreq *request);
+    void process_snoop_request (Mreq *request);
+    void dump (void);
+    perm_t get_permission (void);
+    bool cancel_store (void);
+    void checkpoint (Checkpoint *ckpt);
+
+    inline void do_cache_I (Mreq *request);
+    inline void do_cache_V (Mreq *request);
+    inline void do_cache_S (Mreq *request);
+    inline void do_cache_D (Mreq *request);
+    inline void do_cache_pending (Mreq *request);
+
+    inline void do_snoop_I (Mreq *request);
+    inline void do_snoop_V (Mreq *request);
+    inline void do_snoop_S (Mreq *request);
+    inline void do_snoop_D (Mreq *request);
+    inline void do_snoop_IS (Mreq *request);
+    inline void do_snoop_IM (Mreq *request);
+    inline void do_snoop_SU (Mreq *request);
+};
+
+#endif // _FIREFLY_CACHE_H
@@ -0,0 +1,430 @@
+#include "HYBRID_protocol.h"
+#include "../sim/mreq.h"
+#include "../sim/sim.h"
+#include "../sim/checkpoint.h"
+#include "../sim/hash_table.h"
+#include "../sim/predictor.h"
+
+extern Simulator *Sim;
+
+/*************************
+ * Constructor/Destructor.
+ *************************/
+HYBRID_protocol::HYBRID_protocol (Hash_table *my_table, Hash_entry *my_entry)
+    : Protocol (my_table, my_entry)
+{
+    this->state = HYBRID_CACHE_I;
+    this->invalidator = -1;
+    this->updater = -1;
+}
+
+HYBRID_protocol::~HYBRID_protocol ()
+{
+}
+
+void HYBRID_protocol::dump (void)
+{
+    const char *block_states[10] = {"X","I","S","E","M","IS","IM","IU","SM","SU"};
+    fprintf (stderr, "HYBRID_protocol - state: %s\n", block_states[state]);
+}
+
+void HYBRID_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+    ckpt->io (invalidator);
+    ckpt->io (updater);
+}
+
+perm_t HYBRID_protocol::get_permission (void)
+{
+    switch (state) {
+    case HYBRID_CACHE_I: return PERM_INVALID;
+    case HYBRID_CACHE_S: return PERM_READ;
+    case HYBRID_CACHE_E: return PERM_WRITE;
+    case HYBRID_CACHE_M: return PERM_WRITE;
+    case HYBRID_CACHE_IS: return PERM_PENDING;
+    case HYBRID_CACHE_IM: return PERM_PENDING;
+    case HYBRID_CACHE_IU: return PERM_PENDING;
+    case HYBRID_CACHE_SM: return PERM_PENDING;
+    case HYBRID_CACHE_SU: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for HYBRID Protocol\n");
+    }
+}
+
+bool HYBRID_protocol::cancel_store (void)
+{
+    switch (state) {
+    case HYBRID_CACHE_IM: state = HYBRID_CACHE_I; return true;
+    case HYBRID_CACHE_IU: state = HYBRID_CACHE_I; return true;
+    case HYBRID_CACHE_SM: state = HYBRID_CACHE_I; return true;
+    case HYBRID_CACHE_SU: state = HYBRID_CACHE_S; return true;
+    default: return false;
+    }
+}
+
+void HYBRID_protocol::process_cache_request (Mreq *request)
+{
+	switch (state) {
+    case HYBRID_CACHE_I:  do_cache_I (request); break;
+    case HYBRID_CACHE_S:  do_cache_S (request); break;
+    case HYBRID_CACHE_E:  do_cache_E (request); break;
+    case HYBRID_CACHE_M:  do_cache_M (request); break;
+    case HYBRID_CACHE_IS:
+    case HYBRID_CACHE_IM:
+    case HYBRID_CACHE_IU:
+    case HYBRID_CACHE_SM:
+    case HYBRID_CACHE_SU: do_cache_pending (request); break;
+    default:
+        fatal_error ("Invalid Cache State for HYBRID Protocol\n");
+    }
+}
+
+void HYBRID_protocol::process_snoop_request (Mreq *request)
+{
+	switch (state) {
+    case HYBRID_CACHE_I:  do_snoop_I (request); break;
+    case HYBRID_CACHE_S:  do_snoop_S (request); break;
+    case HYBRID_CACHE_E:  do_snoop_E (request); break;
+    case HYBRID_CACHE_M:  do_snoop_M (request); break;
+    case HYBRID_CACHE_IS: do_snoop_IS (request); break;
+    case HYBRID_CACHE_IM: do_snoop_IM (request); break;
+    case HYBRID_CACHE_IU: do_snoop_IU (request); break;
+    case HYBRID_CACHE_SM: do_snoop_SM (request); break;
+    case HYBRID_CACHE_SU: do_snoop_SU (request); break;
+    default:
+    	fatal_error ("Invalid Cache State for HYBRID Protocol\n");
+    }
+}
+
+/** The processor used the line: an update it received since the last use
+ *  saved it a miss.  */
+inline void HYBRID_protocol::touch (paddr_t addr)
+{
+    if (updater >= 0)
+    {
+        Sim->Nd[updater]->predictor->update_used (addr);
+        updater = -1;
+    }
+}
+
+inline void HYBRID_protocol::do_cache_I (Mreq *request)
+{
+    Predictor *predictor = Sim->Nd[my_table->moduleID.nodeID]->predictor;
+
+    switch (request->msg) {
+    case LOAD:
+    	/* A re-read of a copy somebody invalidated is a miss an update
+    	 * would have avoided; tell the writer's predictor.
+    	 */
+    	if (invalidator >= 0)
+    		Sim->Nd[invalidator]->predictor->invalidation_missed (request->addr);
+    	invalidator = -1;
+    	send_GETS(request->addr);
+    	state = HYBRID_CACHE_IS;
+    	count_miss ();
+    	break;
+    case STORE:
+    	invalidator = -1;
+    	if (predictor->predict_update (request->addr))
+    	{
+    		send_GETS(request->addr);
+    		state = HYBRID_CACHE_IU;
+    	}
+    	else
+    	{
+    		send_GETM(request->addr);
+    		state = HYBRID_CACHE_IM;
+    	}
+    	count_miss ();
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: I state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_cache_S (Mreq *request)
+{
+    Predictor *predictor = Sim->Nd[my_table->moduleID.nodeID]->predictor;
+
+    touch (request->addr);
+    switch (request->msg) {
+    case LOAD:
+        send_DATA_to_proc(request->addr);
+    	break;
+    case STORE:
+    	if (predictor->predict_update (request->addr))
+    	{
+    		send_BUSUPD(request->addr);
+    		state = HYBRID_CACHE_SU;
+    	}
+    	else
+    	{
+    		send_GETM(request->addr);
+    		state = HYBRID_CACHE_SM;
+    		count_miss ();
+    	}
+        break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: S state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_cache_E (Mreq *request)
+{
+    touch (request->addr);
+    switch (request->msg) {
+    case LOAD:
+        send_DATA_to_proc(request->addr);
+    	break;
+    case STORE:
+        send_DATA_to_proc(request->addr);
+        state = HYBRID_CACHE_M;
+        Sim->silent_upgrades++;
+        break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: E state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_cache_M (Mreq *request)
+{
+    touch (request->addr);
+    switch (request->msg) {
+    case LOAD:
+    case STORE:
+    	send_DATA_to_proc(request->addr);
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: M state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_cache_pending (Mreq *request)
+{
+	/* Transient states mean a bus transaction is outstanding for the
+	 * processor's only request.
+	 */
+    request->print_msg (my_table->moduleID, "ERROR");
+	fatal_error("Should only have one outstanding request per processor!");
+}
+
+inline void HYBRID_protocol::do_snoop_I (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    case GETM:
+    case BUSUPD:
+    case DATA:
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: I state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_snoop_S (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	set_shared_line();
+    	break;
+    case GETM:
+    	invalidator = request->src_mid.nodeID;
+    	updater = -1;
+    	state = HYBRID_CACHE_I;
+    	break;
+    case BUSUPD:
+    	/* A second update before we used the first one: the copy is not
+    	 * worth keeping.  Drop it without asserting the shared line, so a
+    	 * lone updater ends up exclusive.
+    	 */
+    	if (updater >= 0)
+    	{
+    		Sim->Nd[request->src_mid.nodeID]->predictor->update_dropped (request->addr);
+    		invalidator = -1;
+    		updater = -1;
+    		state = HYBRID_CACHE_I;
+    	}
+    	else
+    	{
+    		set_shared_line();
+    		updater = request->src_mid.nodeID;
+    	}
+    	break;
+    case DATA:
+    	fatal_error ("Should not see data for this line!  I have the line!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: S state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_snoop_E (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	set_shared_line();
+    	send_DATA_on_bus(request->addr,request->src_mid);
+    	state = HYBRID_CACHE_S;
+    	break;
+    case GETM:
+    	set_shared_line();
+    	send_DATA_on_bus(request->addr,request->src_mid);
+    	invalidator = request->src_mid.nodeID;
+    	state = HYBRID_CACHE_I;
+    	break;
+    case BUSUPD:
+    case DATA:
+    	fatal_error ("Should not see this for a line I hold exclusively!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: E state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_snoop_M (Mreq *request)
+{
+    switch (request->msg) {
+    case GETS:
+    	set_shared_line();
+    	send_DATA_on_bus(request->addr,request->src_mid);
+    	state = HYBRID_CACHE_S;
+    	break;
+    case GETM:
+    	set_shared_line();
+    	send_DATA_on_bus(request->addr,request->src_mid);
+    	invalidator = request->src_mid.nodeID;
+    	state = HYBRID_CACHE_I;
+    	break;
+    case BUSUPD:
+    case DATA:
+    	fatal_error ("Should not see this for a line I hold exclusively!");
+    	break;
+    default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: M state shouldn't see this message\n");
+    }
+}
+
+inline void HYBRID_protocol::do_snoop_IS (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case GETM:
+	case BUSUPD:
+		break;
+	case DATA:
+		send_DATA_to_proc(request->addr);
+		state = get_shared_line() ? HYBRID_CACHE_S : HYBRID_CACHE_E;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: IS state shouldn't see this message\n");
+	}
+}
+
+inline void HYBRID_protocol::do_snoop_IM (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case GETM:
+	case BUSUPD:
+		break;
+	case DATA:
+		send_DATA_to_proc(request->addr);
+		state = HYBRID_CACHE_M;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: IM state shouldn't see this message\n");
+	}
+}
+
+inline void HYBRID_protocol::do_snoop_IU (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case GETM:
+	case BUSUPD:
+		break;
+	case DATA:
+		/* Shared: broadcast the write before the store completes.  */
+		if (get_shared_line())
+		{
+			send_BUSUPD(request->addr);
+			state = HYBRID_CACHE_SU;
+		}
+		else
+		{
+			send_DATA_to_proc(request->addr);
+			state = HYBRID_CACHE_M;
+		}
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: IU state shouldn't see this message\n");
+	}
+}
+
+inline void HYBRID_protocol::do_snoop_SM (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+	case BUSUPD:
+		set_shared_line();
+		break;
+	case GETM:
+		/* Invalidated before our upgrade won the bus; our GETM now
+		 * fetches the line from the new owner.
+		 */
+		if (request->src_mid != my_table->moduleID)
+			state = HYBRID_CACHE_IM;
+		break;
+	case DATA:
+		send_DATA_to_proc(request->addr);
+		state = HYBRID_CACHE_M;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: SM state shouldn't see this message\n");
+	}
+}
+
+inline void HYBRID_protocol::do_snoop_SU (Mreq *request)
+{
+	switch (request->msg) {
+	case GETS:
+		set_shared_line();
+		break;
+	case GETM:
+		/* Our copy is gone, so the queued update has nothing to update.
+		 * Turn it into an upgrade miss instead.
+		 */
+		if (!Sim->bus->retype_request (request->addr, my_table->moduleID, GETM))
+			fatal_error ("HYBRID: SU without a queued BUSUPD!");
+		state = HYBRID_CACHE_IM;
+		count_miss ();
+		break;
+	case BUSUPD:
+		if (request->src_mid == my_table->moduleID)
+			complete_BUSUPD(request->addr);
+		else
+			set_shared_line();
+		break;
+	case DATA:
+		/* Updates write through, so the line is clean.  */
+		send_DATA_to_proc(request->addr);
+		state = get_shared_line() ? HYBRID_CACHE_S : HYBRID_CACHE_E;
+		break;
+	default:
+        request->print_msg (my_table->moduleID, "ERROR");
+        fatal_error ("Client: SU state shouldn't see this message\n");
+	}
+}
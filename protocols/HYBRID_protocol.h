@@ -0,0 +1,64 @@
+#ifndef _HYBRID_CACHE_H
+#define _HYBRID_CACHE_H
+
+#include "../sim/types.h"
+#include "../sim/enums.h"
+#include "../sim/module.h"
+#include "../sim/mreq.h"
+#include "protocol.h"
+
+/** Cache states.  HYBRID is MESI plus Firefly-style write-through updates:
+ *  a write to a shared line either invalidates the other copies (GETM) or
+ *  updates them (BUSUPD), as the writer's Predictor decides.  A copy that
+ *  receives a second update without being read in between drops itself.  */
+typedef enum {
+    HYBRID_CACHE_I = 1,
+    HYBRID_CACHE_S,
+    HYBRID_CACHE_E,
+    HYBRID_CACHE_M,
+    HYBRID_CACHE_IS,
+    HYBRID_CACHE_IM,
+    HYBRID_CACHE_IU,     // Store miss, fetching the line to update it
+    HYBRID_CACHE_SM,     // Upgrade by invalidation, GETM pending
+    HYBRID_CACHE_SU      // Upgrade by update, own BUSUPD pending
+} HYBRID_cache_state_t;
+
+class HYBRID_protocol : public Protocol {
+public:
+    HYBRID_protocol (Hash_table *my_table, Hash_entry *my_entry);
+    ~HYBRID_protocol ();
+
+    HYBRID_cache_state_t state;
+
+    /** Node whose GETM took our copy away, or -1.  */
+    int invalidator;
+    /** Node that last updated our copy since we last used it, or -1.  */
+    int updater;
+
+    void process_cache_request (Mreq *request);
+    void process_snoop_request (Mreq *request);
+    void dump (void);
+    perm_t get_permission (void);
+    bool cancel_store (void);
+    void checkpoint (Checkpoint *ckpt);
+
+    inline void touch (paddr_t addr);
+
+    inline void do_cache_I (Mreq *request);
+    inline void do_cache_S (Mreq *request);
+    inline void do_cache_E (Mreq *request);
+    inline void do_cache_M (Mreq *request);
+    inline void do_cache_pending (Mreq *request);
+
+    inline void do_snoop_I (Mreq *request);
+    inline void do_snoop_S (Mreq *request);
+    inline void do_snoop_E (Mreq *request);
+    inline void do_snoop_M (Mreq *request);
+    inline void do_snoop_IS (Mreq *request);
+    inline void do_snoop_IM (Mreq *request);
+    inline void do_snoop_IU (Mreq *request);
+    inline void do_snoop_SM (Mreq *request);
+    inline void do_snoop_SU (Mreq *request);
+};
+
+#endif // _HYBRID_CACHE_H
@@ -1,6 +1,7 @@
 #include "MESI_protocol.h"
 #include "../sim/mreq.h"
 #include "../sim/sim.h"
+#include "../sim/checkpoint.h"
 #include "../sim/hash_table.h"
 
 extern Simulator *Sim;
@@ -21,10 +22,39 @@ MESI_protocol::~MESI_protocol ()
 
 void MESI_protocol::dump (void)
 {
-    const char *block_states[5] = {"X","I","S","E","M"};
+    const char *block_states[8] = {"X","I","S","E","M","IS","IM","SM"};
     fprintf (stderr, "MESI_protocol - state: %s\n", block_states[state]);
 }
 
+void MESI_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t MESI_protocol::get_permission (void)
+{
+    switch (state) {
+    case MESI_CACHE_I: return PERM_INVALID;
+    case MESI_CACHE_S: return PERM_READ;
+    case MESI_CACHE_E: return PERM_WRITE;
+    case MESI_CACHE_M: return PERM_WRITE;
+    case MESI_CACHE_IS: return PERM_PENDING;
+    case MESI_CACHE_IM: return PERM_PENDING;
+    case MESI_CACHE_SM: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for MESI Protocol\n");
+    }
+}
+
+bool MESI_protocol::cancel_store (void)
+{
+    switch (state) {
+    case MESI_CACHE_IM: state = MESI_CACHE_I; return true;
+    case MESI_CACHE_SM: state = MESI_CACHE_I; return true;
+    default: return false;
+    }
+}
+
 void MESI_protocol::process_cache_request (Mreq *request)
 {
 	switch (state) {
@@ -67,7 +97,7 @@ inline void MESI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MESI_CACHE_IS;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     case STORE:
     	/* Line up the GETM in the Bus' queue */
@@ -77,7 +107,7 @@ inline void MESI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MESI_CACHE_IM;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -103,7 +133,7 @@ inline void MESI_protocol::do_cache_S (Mreq *request)
      */
         send_GETM(request->addr);
         state = MESI_CACHE_SM;
-        Sim->cache_misses++;
+        count_miss ();
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -311,6 +341,17 @@ inline void MESI_protocol::do_snoop_M (Mreq *request)
 {
     switch (request->msg) {
     case GETS:
+    	/**
+    	 * Set dueling policy B (migratory): give the reader the only copy
+    	 * without raising the shared line, so it fills in E and can write
+    	 * without an upgrade miss.
+    	 */
+    	if (Sim->dueling && Sim->dueling->use_policy_b (request->addr))
+    	{
+    		send_DATA_on_bus(request->addr,request->src_mid);
+    		state = MESI_CACHE_I;
+    		break;
+    	}
     	/**
     	 * Another cache wants the data and we have the dirty copy of the data
     	 * Memory has the stale copy of the data
@@ -1,6 +1,7 @@
 #include "MI_protocol.h"
 #include "../sim/mreq.h"
 #include "../sim/sim.h"
+#include "../sim/checkpoint.h"
 #include "../sim/hash_table.h"
 
 extern Simulator *Sim;
@@ -28,6 +29,30 @@ void MI_protocol::dump (void)
     fprintf (stderr, "MI_protocol - state: %s\n", block_states[state]);
 }
 
+void MI_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t MI_protocol::get_permission (void)
+{
+    switch (state) {
+    case MI_CACHE_I: return PERM_INVALID;
+    case MI_CACHE_IM: return PERM_PENDING;
+    case MI_CACHE_M: return PERM_WRITE;
+    default:
+        fatal_error ("Invalid Cache State for MI Protocol\n");
+    }
+}
+
+bool MI_protocol::cancel_store (void)
+{
+    switch (state) {
+    case MI_CACHE_IM: state = MI_CACHE_I; return true;
+    default: return false;
+    }
+}
+
 void MI_protocol::process_cache_request (Mreq *request)
 {
 	switch (state) {
@@ -63,7 +88,7 @@ inline void MI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MI_CACHE_IM;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -25,6 +25,9 @@ public:
     void process_cache_request (Mreq *request);
     void process_snoop_request (Mreq *request);
     void dump (void);
+    perm_t get_permission (void);
+    bool cancel_store (void);
+    void checkpoint (Checkpoint *ckpt);
 
     /* Functions that specify the actions to take on requests from the processor
      * when the cache is in various states
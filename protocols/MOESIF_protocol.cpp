@@ -1,6 +1,7 @@
 #include "MOESIF_protocol.h"
 #include "../sim/mreq.h"
 #include "../sim/sim.h"
+#include "../sim/checkpoint.h"
 #include "../sim/hash_table.h"
 
 extern Simulator *Sim;
@@ -21,10 +22,45 @@ MOESIF_protocol::~MOESIF_protocol ()
 
 void MOESIF_protocol::dump (void)
 {
-    const char *block_states[9] = {"X","I","S","E","O","M","F"};
+    const char *block_states[12] = {"X","I","S","E","O","M","F","IS","IM","SM","OM","FM"};
     fprintf (stderr, "MOESIF_protocol - state: %s\n", block_states[state]);
 }
 
+void MOESIF_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t MOESIF_protocol::get_permission (void)
+{
+    switch (state) {
+    case MOESIF_CACHE_I: return PERM_INVALID;
+    case MOESIF_CACHE_S: return PERM_READ;
+    case MOESIF_CACHE_E: return PERM_WRITE;
+    case MOESIF_CACHE_O: return PERM_READ;
+    case MOESIF_CACHE_M: return PERM_WRITE;
+    case MOESIF_CACHE_F: return PERM_READ;
+    case MOESIF_CACHE_IS: return PERM_PENDING;
+    case MOESIF_CACHE_IM: return PERM_PENDING;
+    case MOESIF_CACHE_SM: return PERM_PENDING;
+    case MOESIF_CACHE_OM: return PERM_PENDING;
+    case MOESIF_CACHE_FM: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for MOESIF Protocol\n");
+    }
+}
+
+bool MOESIF_protocol::cancel_store (void)
+{
+    switch (state) {
+    case MOESIF_CACHE_IM: state = MOESIF_CACHE_I; return true;
+    case MOESIF_CACHE_SM: state = MOESIF_CACHE_I; return true;
+    case MOESIF_CACHE_OM: state = MOESIF_CACHE_O; return true;
+    case MOESIF_CACHE_FM: state = MOESIF_CACHE_F; return true;
+    default: return false;
+    }
+}
+
 void MOESIF_protocol::process_cache_request (Mreq *request)
 {
 	switch (state) {
@@ -75,7 +111,7 @@ inline void MOESIF_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MOESIF_CACHE_IS;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     case STORE:
     	/* Line up the GETM in the Bus' queue */
@@ -85,7 +121,7 @@ inline void MOESIF_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MOESIF_CACHE_IM;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -108,7 +144,7 @@ inline void MOESIF_protocol::do_cache_S (Mreq *request)
      */
         send_GETM(request->addr);
         state = MOESIF_CACHE_SM;
-        Sim->cache_misses++;
+        count_miss ();
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -160,7 +196,7 @@ inline void MOESIF_protocol::do_cache_O (Mreq *request)
      */
         send_GETM(request->addr);
         state = MOESIF_CACHE_OM;
-        Sim->cache_misses++;                                                                        
+        count_miss ();                                                                        
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -202,7 +238,7 @@ inline void MOESIF_protocol::do_cache_F (Mreq *request)
      */
         send_GETM(request->addr);
         state = MOESIF_CACHE_FM;
-        Sim->cache_misses++;                                                                        
+        count_miss ();                                                                        
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -32,6 +32,9 @@ public:
     void process_cache_request (Mreq *request);
     void process_snoop_request (Mreq *request);
     void dump (void);
+    perm_t get_permission (void);
+    bool cancel_store (void);
+    void checkpoint (Checkpoint *ckpt);
 
     inline void do_cache_I (Mreq *request);
     inline void do_cache_S (Mreq *request);
@@ -1,6 +1,7 @@
 #include "MOESI_protocol.h"
 #include "../sim/mreq.h"
 #include "../sim/sim.h"
+#include "../sim/checkpoint.h"
 #include "../sim/hash_table.h"
 
 extern Simulator *Sim;
@@ -21,10 +22,42 @@ MOESI_protocol::~MOESI_protocol ()
 
 void MOESI_protocol::dump (void)
 {
-    const char *block_states[6] = {"X","I","S","E","O","M"};
+    const char *block_states[10] = {"X","I","S","E","O","M","IS","IM","SM","OM"};
     fprintf (stderr, "MOESI_protocol - state: %s\n", block_states[state]);
 }
 
+void MOESI_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t MOESI_protocol::get_permission (void)
+{
+    switch (state) {
+    case MOESI_CACHE_I: return PERM_INVALID;
+    case MOESI_CACHE_S: return PERM_READ;
+    case MOESI_CACHE_E: return PERM_WRITE;
+    case MOESI_CACHE_O: return PERM_READ;
+    case MOESI_CACHE_M: return PERM_WRITE;
+    case MOESI_CACHE_IS: return PERM_PENDING;
+    case MOESI_CACHE_IM: return PERM_PENDING;
+    case MOESI_CACHE_SM: return PERM_PENDING;
+    case MOESI_CACHE_OM: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for MOESI Protocol\n");
+    }
+}
+
+bool MOESI_protocol::cancel_store (void)
+{
+    switch (state) {
+    case MOESI_CACHE_IM: state = MOESI_CACHE_I; return true;
+    case MOESI_CACHE_SM: state = MOESI_CACHE_I; return true;
+    case MOESI_CACHE_OM: state = MOESI_CACHE_O; return true;
+    default: return false;
+    }
+}
+
 void MOESI_protocol::process_cache_request (Mreq *request)
 {
 	switch (state) {
@@ -71,7 +104,7 @@ inline void MOESI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MOESI_CACHE_IS;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     case STORE:
     	/* Line up the GETM in the Bus' queue */
@@ -81,7 +114,7 @@ inline void MOESI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MOESI_CACHE_IM;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -104,7 +137,7 @@ inline void MOESI_protocol::do_cache_S (Mreq *request)
      */
         send_GETM(request->addr);
         state = MOESI_CACHE_SM;
-        Sim->cache_misses++;
+        count_miss ();
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -156,7 +189,7 @@ inline void MOESI_protocol::do_cache_O (Mreq *request)
      */
         send_GETM(request->addr);
         state = MOESI_CACHE_OM;
-        Sim->cache_misses++;                                                                        
+        count_miss ();                                                                        
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -1,6 +1,7 @@
 #include "MOSI_protocol.h"
 #include "../sim/mreq.h"
 #include "../sim/sim.h"
+#include "../sim/checkpoint.h"
 #include "../sim/hash_table.h"
 
 extern Simulator *Sim;
@@ -21,10 +22,39 @@ MOSI_protocol::~MOSI_protocol ()
 
 void MOSI_protocol::dump (void)
 {
-    const char *block_states[5] = {"X","I","S","O","M"};
+    const char *block_states[8] = {"X","I","S","O","M","IS","IM","OM"};
     fprintf (stderr, "MOSI_protocol - state: %s\n", block_states[state]);
 }
 
+void MOSI_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t MOSI_protocol::get_permission (void)
+{
+    switch (state) {
+    case MOSI_CACHE_I: return PERM_INVALID;
+    case MOSI_CACHE_S: return PERM_READ;
+    case MOSI_CACHE_O: return PERM_READ;
+    case MOSI_CACHE_M: return PERM_WRITE;
+    case MOSI_CACHE_IS: return PERM_PENDING;
+    case MOSI_CACHE_IM: return PERM_PENDING;
+    case MOSI_CACHE_OM: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for MOSI Protocol\n");
+    }
+}
+
+bool MOSI_protocol::cancel_store (void)
+{
+    switch (state) {
+    case MOSI_CACHE_IM: state = MOSI_CACHE_I; return true;
+    case MOSI_CACHE_OM: state = MOSI_CACHE_O; return true;
+    default: return false;
+    }
+}
+
 void MOSI_protocol::process_cache_request (Mreq *request)
 {
 	switch (state) {
@@ -67,7 +97,7 @@ inline void MOSI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MOSI_CACHE_IS;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     case STORE:
     	/* Line up the GETM in the Bus' queue */
@@ -77,7 +107,7 @@ inline void MOSI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MOSI_CACHE_IM;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -100,7 +130,7 @@ inline void MOSI_protocol::do_cache_S (Mreq *request)
      */
         send_GETM(request->addr);
         state = MOSI_CACHE_IM;
-        Sim->cache_misses++;
+        count_miss ();
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -126,7 +156,7 @@ inline void MOSI_protocol::do_cache_O (Mreq *request)
      */
         send_GETM(request->addr);
         state = MOSI_CACHE_OM;
-        Sim->cache_misses++;                                                                          // Think over it
+        count_miss ();                                                                          // Think over it
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
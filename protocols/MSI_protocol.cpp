@@ -1,6 +1,7 @@
 #include "MSI_protocol.h"
 #include "../sim/mreq.h"
 #include "../sim/sim.h"
+#include "../sim/checkpoint.h"
 #include "../sim/hash_table.h"
 
 extern Simulator *Sim;
@@ -21,10 +22,36 @@ MSI_protocol::~MSI_protocol ()
 
 void MSI_protocol::dump (void)
 {
-    const char *block_states[4] = {"X","I","S","M"};
+    const char *block_states[6] = {"X","I","S","M","IS","IM"};
     fprintf (stderr, "MSI_protocol - state: %s\n", block_states[state]);
 }
 
+void MSI_protocol::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (state);
+}
+
+perm_t MSI_protocol::get_permission (void)
+{
+    switch (state) {
+    case MSI_CACHE_I: return PERM_INVALID;
+    case MSI_CACHE_S: return PERM_READ;
+    case MSI_CACHE_M: return PERM_WRITE;
+    case MSI_CACHE_IS: return PERM_PENDING;
+    case MSI_CACHE_IM: return PERM_PENDING;
+    default:
+        fatal_error ("Invalid Cache State for MSI Protocol\n");
+    }
+}
+
+bool MSI_protocol::cancel_store (void)
+{
+    switch (state) {
+    case MSI_CACHE_IM: state = MSI_CACHE_I; return true;
+    default: return false;
+    }
+}
+
 void MSI_protocol::process_cache_request (Mreq *request)
 {
 	switch (state) {
@@ -63,7 +90,7 @@ inline void MSI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MSI_CACHE_IS;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     case STORE:
     	/* Line up the GETM in the Bus' queue */
@@ -73,7 +100,7 @@ inline void MSI_protocol::do_cache_I (Mreq *request)
     	 */
     	state = MSI_CACHE_IM;
     	/* This is a cache miss */
-    	Sim->cache_misses++;
+    	count_miss ();
     	break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -96,7 +123,7 @@ inline void MSI_protocol::do_cache_S (Mreq *request)
      */
         send_GETM(request->addr);
         state = MSI_CACHE_IM;
-        Sim->cache_misses++;
+        count_miss ();
         break;
     default:
         request->print_msg (my_table->moduleID, "ERROR");
@@ -24,5 +24,7 @@ const char * Mreq::message_t_str[MREQ_MESSAGE_NUM] = {
 
     "DATA",
 
+    "BUSUPD",
+
     "MREQ_INVALID"
 };
@@ -24,6 +24,8 @@ typedef enum
 
     DATA,
 
+    BUSUPD,     // Write update broadcast (Dragon/Firefly), no DATA reply needed
+
     MREQ_INVALID,
 	MREQ_MESSAGE_NUM	// Use this to make a Stat Array of message types
 } message_t;
@@ -43,7 +43,7 @@ void Protocol::send_DATA_on_bus(paddr_t addr, ModuleID dest)
 	// When DATA is sent on the bus it _MUST_ have a destination module
 	new_request = new Mreq(DATA, addr, my_table->moduleID, dest);
 	/* Debug Message -- DO NOT REMOVE or you won't match the validation runs */
-	fprintf(stderr,"**** DATA_SEND Cache: %d -- Clock: %lld\n",my_table->moduleID.nodeID,Global_Clock);
+	sim_log ("**** DATA_SEND Cache: %d -- Clock: %lld\n",my_table->moduleID.nodeID,(long long int)Global_Clock);
 	/* This will but the message in the bus' arbitration queue to sent */
 	this->my_table->write_to_bus(new_request);
 
@@ -63,6 +63,29 @@ void Protocol::send_DATA_to_proc(paddr_t addr)
 	this->my_table->write_to_proc(new_request);
 }
 
+void Protocol::count_miss (void)
+{
+	if (!my_table->issuing_prefetch)
+		Sim->cache_misses++;
+}
+
+void Protocol::send_BUSUPD(paddr_t addr)
+{
+	Mreq * new_request;
+	new_request = new Mreq(BUSUPD,addr);
+	this->my_table->write_to_bus(new_request);
+}
+
+void Protocol::complete_BUSUPD(paddr_t addr)
+{
+	/* The bus holds a transaction until a DATA reply; the updater sends
+	 * that reply to itself.  This is not a cache-to-cache transfer.
+	 */
+	Mreq * new_request;
+	new_request = new Mreq(DATA, addr, my_table->moduleID, my_table->moduleID);
+	this->my_table->write_to_bus(new_request);
+}
+
 void Protocol::set_shared_line ()
 {
 	// Set the bus' shared line
@@ -4,9 +4,19 @@
 #include "../sim/module.h"
 #include "../sim/mreq.h"
 
+class Checkpoint;
 class Hash_table;
 class Sharers;
 
+/** What a line's current state lets the processor do without a bus
+ *  transaction.  Transient states are PERM_PENDING.  */
+typedef enum {
+    PERM_INVALID = 0,
+    PERM_PENDING,
+    PERM_READ,
+    PERM_WRITE
+} perm_t;
+
 /** This is the base class for all Coherence Protocols
  * All of your protocols will inherit from this class
  */
@@ -35,6 +45,20 @@ public:
 	 * This function dumps the coherence state (Useful for debugging)
 	 */
     virtual void dump (void) =0;  
+    /** This virtual function must be implemented by all children
+	 * This function maps the coherence state onto a perm_t
+	 */
+    virtual perm_t get_permission (void) =0;
+    /** This virtual function must be implemented by all children
+	 * This function saves or restores the coherence state
+	 */
+    virtual void checkpoint (Checkpoint *ckpt) =0;
+    /** This virtual function must be implemented by all children
+	 * The processor withdrew the store whose bus request is still queued
+	 * (an SC that lost its link): go back to a stable state without it,
+	 * invalid if the copy may be stale.  False if no store is pending.
+	 */
+    virtual bool cancel_store (void) =0;
 
     /** These helper functions are provided to you to make it easier to
      * interface with the processor and bus.
@@ -46,6 +70,12 @@ public:
     void send_GETS(paddr_t addr);
     void send_DATA_on_bus(paddr_t addr, ModuleID dest);
     void send_DATA_to_proc(paddr_t addr);
+    /** Update protocols: broadcast a write, and end our own BUSUPD's bus
+     *  transaction once it has been snooped.  */
+    void send_BUSUPD(paddr_t addr);
+    void complete_BUSUPD(paddr_t addr);
+    /** Count a cache miss; prefetches sent as LOADs are not misses.  */
+    void count_miss (void);
     /** These helper functions are for setting and getting the bus' shared line */
     void set_shared_line();
     bool get_shared_line();
@@ -1,47 +1,116 @@
 #include "bus.h"
+#include "checkpoint.h"
+#include "hash_table.h"
 #include "mreq.h"
+#include "preq.h"
+#include "sim.h"
+#include "snoop_filter.h"
+
+extern Sim_settings settings;
+
+extern Simulator *Sim;
 
 Bus::Bus()
 {
     current_request = NULL;
+    granted_preq = NULL;
     data_reply = NULL;
+    grant_time = 0;
+    data_start = 0;
+    data_time = 0;
     request_in_progress = false;
     shared_line = false;
+    last_busy = 0;
+    stats = new Bus_stat_engine ("bus");
+
+    if (settings.bus_width < 0 || settings.bus_addr_cycles < 1 || settings.c2c_latency < 0)
+        fatal_error ("Bus: bad bus_width %d, bus_addr_cycles %d or c2c_latency %d\n",
+                     settings.bus_width, settings.bus_addr_cycles, settings.c2c_latency);
+    data_cycles = 1;
+    if (settings.bus_width)
+        data_cycles = (settings.cache_line_size + settings.bus_width - 1) / settings.bus_width;
+
+    snoop_filter = Snoop_filter::create (settings.snoop_filter);
+    if (snoop_filter)
+        stats->add_child (snoop_filter->stats);
 }
 
 Bus::~Bus()
 {
+    delete stats;
+    if (snoop_filter)
+        delete snoop_filter;
 }
 
 void Bus::tick()
 {
 	if (current_request)
+	{
+		/** Every L1 has now snooped it.  */
+		if (Sim->checker)
+			Sim->checker->check_swmr (current_request->addr);
 		delete current_request;
+	}
+
+	expire_prefetches ();
 
 	if (request_in_progress)
 	{
-		if (data_reply)
+		if (Global_Clock < grant_time + settings.bus_addr_cycles)
+			stats->addr_busy_cycles->inc ();
+		if (data_reply && Global_Clock >= data_start)
+		{
+			stats->data_busy_cycles->inc ();
+			last_busy = Global_Clock;
+		}
+
+		if (data_reply && Global_Clock >= data_time)
 		{
 			current_request = data_reply;
 			data_reply = NULL;
 			request_in_progress=false;
+			if (granted_preq)
+				granted_preq->mark (PREQ_DATA_ARRIVAL);
 		}
 		else
 		{
 			current_request = NULL;
 		}
 	}
-	else if (!pending_requests.empty())
+	else if (!pending_requests.empty() || !prefetch_requests.empty())
 	{
+		LIST<Mreq *> *queue = pending_requests.empty() ? &prefetch_requests : &pending_requests;
+
 		shared_line = false;
-	    current_request = pending_requests.front();
-	    pending_requests.pop_front();
+	    current_request = queue->front();
+	    queue->pop_front();
 	    request_in_progress = true;
+	    grant_time = Global_Clock;
+	    stats->addr_busy_cycles->inc ();
+	    granted_preq = current_request->preq;
+	    if (granted_preq)
+	    	granted_preq->mark_first (PREQ_BUS_GRANT);
+	    if (Sim->analysis)
+	    	Sim->analysis->bus_transaction (current_request);
+	    if (Sim->sd_profiler)
+	    	Sim->sd_profiler->bus_transaction (current_request);
+	    if (snoop_filter)
+	    	snoop_filter->transaction (current_request->addr);
 	}
 	else
 	{
 		current_request = NULL;
 	}
+
+	if (current_request)
+	{
+		if (Sim->checker)
+			Sim->checker->bus_transaction (current_request);
+		stats->busy_cycles->inc ();
+		last_busy = Global_Clock;
+		stats->transactions[current_request->msg]->inc ();
+	}
+	stats->queue_depth->add (pending_requests.size () + prefetch_requests.size ());
 }
 
 bool Bus::bus_request(Mreq *request)
@@ -50,6 +119,24 @@ bool Bus::bus_request(Mreq *request)
 	{
 		assert (data_reply == NULL);
 		data_reply = request;
+
+		/** A self-addressed reply only closes an update and carries no
+		 *  line.  */
+		data_start = Global_Clock + 1;
+		if (request->src_mid.module_index != MC_M && request->src_mid != request->dest_mid)
+			data_start += settings.c2c_latency;
+		if (data_start < grant_time + settings.bus_addr_cycles)
+			data_start = grant_time + settings.bus_addr_cycles;
+		data_time = data_start + (request->src_mid == request->dest_mid ? 1 : data_cycles) - 1;
+		if (granted_preq)
+		{
+			granted_preq->mark (PREQ_SNOOP_RESPONSE);
+			granted_preq->data_from_memory = (request->src_mid.module_index == MC_M);
+		}
+	}
+	else if (request->prefetch)
+	{
+		prefetch_requests.push_back(request);
 	}
 	else
     {
@@ -59,6 +146,41 @@ bool Bus::bus_request(Mreq *request)
 	return true;
 }
 
+/** A demand request is waiting on this prefetch; move it into the demand
+ *  queue.  Nothing to do if it has already been granted.  */
+void Bus::promote_prefetch (paddr_t addr, ModuleID src_mid)
+{
+	LIST<Mreq *>::iterator it;
+
+	for (it = prefetch_requests.begin(); it != prefetch_requests.end(); it++)
+		if ((*it)->addr == addr && (*it)->src_mid == src_mid)
+		{
+			pending_requests.push_back(*it);
+			prefetch_requests.erase(it);
+			return;
+		}
+}
+
+/** Cancel the prefetches that have waited prefetch_max_wait cycles
+ *  without winning the bus, so they do not hold their L1's outstanding
+ *  slots while demand traffic keeps the bus busy.  */
+void Bus::expire_prefetches (void)
+{
+	Mreq *request;
+
+	if (!settings.prefetch_max_wait)
+		return;
+
+	while (!prefetch_requests.empty() &&
+	       Global_Clock - prefetch_requests.front()->req_time >= (timestamp_t)settings.prefetch_max_wait)
+	{
+		request = prefetch_requests.front();
+		prefetch_requests.pop_front();
+		Sim->get_L1 (request->src_mid.nodeID)->cancel_prefetch (request->addr);
+		delete request;
+	}
+}
+
 Mreq* Bus::bus_snoop()
 {
     Mreq *request;
@@ -74,3 +196,137 @@ Mreq* Bus::bus_snoop()
         return NULL;
     }
 }
+
+/** Whether the L1 mid needs to see this cycle's bus message.  A DATA
+ *  reply only concerns its destination; without a snoop filter every L1
+ *  sees every request.  */
+bool Bus::snoop_wanted (ModuleID mid)
+{
+	if (!current_request)
+		return true;
+	if (current_request->msg == DATA)
+		return current_request->dest_mid == mid;
+	if (!snoop_filter)
+		return true;
+
+	snoop_filter->lookups->inc ();
+	if (current_request->src_mid == mid ||
+	    snoop_filter->may_hold (current_request->addr, mid.nodeID))
+		return true;
+
+	snoop_filter->filtered->inc ();
+	return false;
+}
+
+/** Whether a queued request for addr could be granted, and so snooped,
+ *  before anything issued now.  */
+bool Bus::line_queued (paddr_t addr)
+{
+	LIST<Mreq *>::iterator it;
+
+	for (it = pending_requests.begin(); it != pending_requests.end(); it++)
+		if ((*it)->addr == addr)
+			return true;
+	for (it = prefetch_requests.begin(); it != prefetch_requests.end(); it++)
+		if ((*it)->addr == addr)
+			return true;
+	return false;
+}
+
+/** The next tick neither grants a request, delivers a DATA reply nor
+ *  holds the bus for either phase.  */
+bool Bus::quiet (void)
+{
+	if (data_reply || (request_in_progress && Global_Clock + 1 < grant_time + settings.bus_addr_cycles))
+		return false;
+	return request_in_progress || (pending_requests.empty() && prefetch_requests.empty());
+}
+
+/** Change the message of a demand request still waiting for the bus, e.g.
+ *  an update whose line was invalidated before it was granted.  Returns
+ *  false if no such request is queued.  */
+bool Bus::retype_request (paddr_t addr, ModuleID src_mid, message_t msg)
+{
+	LIST<Mreq *>::iterator it;
+
+	for (it = pending_requests.begin(); it != pending_requests.end(); it++)
+		if ((*it)->addr == addr && (*it)->src_mid == src_mid)
+		{
+			(*it)->msg = msg;
+			return true;
+		}
+	return false;
+}
+
+/** Drop src_mid's demand request for addr that is still waiting for the
+ *  bus.  Returns false if no such request is queued.  */
+bool Bus::cancel_request (paddr_t addr, ModuleID src_mid)
+{
+	LIST<Mreq *>::iterator it;
+
+	for (it = pending_requests.begin(); it != pending_requests.end(); it++)
+		if ((*it)->addr == addr && (*it)->src_mid == src_mid)
+		{
+			delete *it;
+			pending_requests.erase(it);
+			return true;
+		}
+	return false;
+}
+
+/** Per-phase utilization, only when the bus timing is not the default.  */
+void Bus::report (FILE *fp)
+{
+	double cycles = Global_Clock ? (double)Global_Clock : 1.0;
+
+	if (!settings.bus_width && settings.bus_addr_cycles == 1 && !settings.c2c_latency)
+		return;
+
+	fprintf (fp, "Bus Address:      %8llu busy cycles (%.1f%%)\n",
+	         (unsigned long long int)stats->addr_busy_cycles->value,
+	         100.0 * stats->addr_busy_cycles->value / cycles);
+	fprintf (fp, "Bus Data:         %8llu busy cycles (%.1f%%), %d cycles per line\n",
+	         (unsigned long long int)stats->data_busy_cycles->value,
+	         100.0 * stats->data_busy_cycles->value / cycles, data_cycles);
+	fprintf (fp, "Bus Queue:        %8.2f requests waiting on average\n",
+	         stats->queue_depth->get_mean ());
+}
+
+static void checkpoint_queue (Checkpoint *ckpt, LIST<Mreq *> &queue)
+{
+	LIST<Mreq *>::iterator it;
+	int size = queue.size ();
+
+	ckpt->io (size);
+	if (ckpt->saving)
+	{
+		for (it = queue.begin(); it != queue.end(); it++)
+			ckpt->io_mreq (*it);
+		return;
+	}
+
+	assert (queue.empty());
+	for (int i = 0; i < size; i++)
+	{
+		Mreq *request = NULL;
+
+		ckpt->io_mreq (request);
+		queue.push_back(request);
+	}
+}
+
+/** Messages in flight and queued.  The snoop filter is rebuilt from the
+ *  L1s on restore.  */
+void Bus::checkpoint (Checkpoint *ckpt)
+{
+	ckpt->io_mreq (current_request);
+	ckpt->io_preq (granted_preq);
+	ckpt->io_mreq (data_reply);
+	ckpt->io (request_in_progress);
+	ckpt->io (shared_line);
+	ckpt->io (grant_time);
+	ckpt->io (data_start);
+	ckpt->io (data_time);
+	checkpoint_queue (ckpt, pending_requests);
+	checkpoint_queue (ckpt, prefetch_requests);
+}
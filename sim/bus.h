@@ -1,10 +1,25 @@
 #ifndef BUS_H_
 #define BUS_H_
 
+#include <stdio.h>
+
+#include "module.h"
 #include "types.h"
+#include "stat_engine.h"
 
+class Checkpoint;
 class Mreq;
+class Snoop_filter;
 
+/**
+ * The bus holds one transaction at a time, from the grant of its request
+ * to the delivery of its DATA reply.  The request takes settings.
+ * bus_addr_cycles of address phase; the reply then moves a line in
+ * data_cycles, cache_line_size / bus_width, and is delivered, i.e. seen by
+ * the snoopers, in the last of them.  A cache's reply waits c2c_latency
+ * cycles before its transfer starts; memory's latency is mem_hit_time.
+ * The defaults give one cycle for each phase.
+ */
 class Bus{
 public:
     Bus();
@@ -13,18 +28,47 @@ public:
     //TODO: Add shared, flush lines, etc...
 
 	Mreq *current_request;
+	Preq *granted_preq;
     LIST <Mreq *>pending_requests;
+    /** Prefetches only win arbitration when no demand request waits, and
+     *  are cancelled once they have waited prefetch_max_wait cycles.  */
+    LIST <Mreq *>prefetch_requests;
     Mreq *data_reply;
+    /** Cycle the current request was granted.  */
+    timestamp_t grant_time;
+    /** First transfer cycle of data_reply and the cycle it is delivered.  */
+    timestamp_t data_start;
+    timestamp_t data_time;
+    /** Cycles to transfer a line.  */
+    int data_cycles;
     
     bool request_in_progress;
 
     bool shared_line;
 
+    /** Cycle of the last transaction, for the watchdog.  */
+    timestamp_t last_busy;
+
+    Bus_stat_engine *stats;
+
+    /** NULL unless settings.snoop_filter is set.  */
+    Snoop_filter *snoop_filter;
+
     void tick ();
 
     bool is_shared_active () { return shared_line; }
     bool bus_request (Mreq * request);
+    void promote_prefetch (paddr_t addr, ModuleID src_mid);
+    void expire_prefetches (void);
+    bool retype_request (paddr_t addr, ModuleID src_mid, message_t msg);
+    bool cancel_request (paddr_t addr, ModuleID src_mid);
+    bool line_queued (paddr_t addr);
+    bool quiet (void);
+    void report (FILE *fp);
+
+    void checkpoint (Checkpoint *ckpt);
     Mreq *bus_snoop();
+    bool snoop_wanted (ModuleID mid);
 };
 
 #endif
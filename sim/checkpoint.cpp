@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "mreq.h"
+#include "preq.h"
+#include "processor.h"
+#include "sim.h"
+
+extern Simulator *Sim;
+
+Checkpoint::Checkpoint (const char *file, bool saving)
+{
+    char magic[8] = CHECKPOINT_MAGIC;
+    char saved[8];
+
+    this->file = strdup (file);
+    this->saving = saving;
+    this->buffer = NULL;
+    this->size = 0;
+    this->offset = 0;
+    this->fp = fopen (file, saving ? "wb" : "rb");
+    if (!fp)
+        fatal_error ("Checkpoint: unable to open %s\n", file);
+
+    memcpy (saved, magic, sizeof (magic));
+    io (saved, sizeof (saved));
+    if (memcmp (saved, magic, sizeof (magic)))
+        fatal_error ("Checkpoint: %s is not a checkpoint\n", file);
+    check (CHECKPOINT_VERSION, "checkpoint version");
+}
+
+Checkpoint::Checkpoint (void *buffer, size_t size, bool saving)
+{
+    this->file = NULL;
+    this->fp = NULL;
+    this->saving = saving;
+    this->buffer = (char *)buffer;
+    this->size = size;
+    this->offset = 0;
+}
+
+Checkpoint::~Checkpoint ()
+{
+    if (buffer)
+        return;
+    if (fclose (fp))
+        fatal_error ("Checkpoint: error closing %s\n", file);
+    free (file);
+}
+
+void Checkpoint::io (void *data, size_t size)
+{
+    if (buffer)
+    {
+        if (offset + size > this->size)
+            fatal_error ("Checkpoint: state image larger than %zu bytes\n", this->size);
+        if (saving)
+            memcpy (buffer + offset, data, size);
+        else
+            memcpy (data, buffer + offset, size);
+        offset += size;
+        return;
+    }
+
+    if (saving)
+    {
+        if (fwrite (data, 1, size, fp) != size)
+            fatal_error ("Checkpoint: error writing %s\n", file);
+    }
+    else
+    {
+        if (fread (data, 1, size, fp) != size)
+            fatal_error ("Checkpoint: %s is truncated\n", file);
+    }
+}
+
+void Checkpoint::io_mreq (Mreq *&mreq)
+{
+    bool present = (mreq != NULL);
+
+    io (present);
+    if (!present)
+    {
+        mreq = NULL;
+        return;
+    }
+    if (!saving)
+        mreq = new Mreq ();
+
+    io (mreq->msg);
+    io (mreq->pc);
+    io (mreq->addr);
+    io_preq (mreq->preq);
+    io (mreq->src_mid);
+    io (mreq->dest_mid);
+    io (mreq->fwd_mid);
+    io (mreq->INV_ACK_count);
+    io (mreq->req_time);
+    io (mreq->stalled);
+    io (mreq->prefetch);
+}
+
+void Checkpoint::io_preq (Preq *&preq)
+{
+    int node = preq ? preq->mid.nodeID : -1;
+
+    io (node);
+    if (!saving)
+        preq = (node < 0) ? NULL : &Sim->get_PR (node)->preq;
+}
+
+void Checkpoint::check (int value, const char *what)
+{
+    int saved = value;
+
+    io (saved);
+    if (saved != value)
+        fatal_error ("Checkpoint: %s was taken with %s %d, not %d\n",
+                     file ? file : "state image", what, saved, value);
+}
@@ -0,0 +1,54 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <stdio.h>
+
+#include "types.h"
+
+using namespace std;
+
+class Mreq;
+class Preq;
+
+#define CHECKPOINT_MAGIC "SIMCKPT"
+/** Bump when the layout of any checkpoint () method changes.  */
+#define CHECKPOINT_VERSION 6
+
+/**
+ * Binary checkpoint file.  Saving and restoring go through the same io ()
+ * calls, so each class has a single checkpoint () method that walks its
+ * state in a fixed order and works in both directions.  The file is only
+ * meant to be read back by the same build with the same configuration;
+ * the header records enough of it to catch a mismatch.
+ */
+class Checkpoint {
+public:
+    Checkpoint (const char *file, bool saving);
+    /** Headerless image of at most size bytes at buffer, e.g. one line's
+     *  protocol state for the state explorer.  */
+    Checkpoint (void *buffer, size_t size, bool saving);
+    ~Checkpoint ();
+
+    char *file;
+    FILE *fp;
+    bool saving;
+
+    /** The in-memory image, NULL for a file; offset is the bytes used.  */
+    char *buffer;
+    size_t size;
+    size_t offset;
+
+    /** Save or restore size bytes at data.  */
+    void io (void *data, size_t size);
+    template <class T> void io (T &value) { io (&value, sizeof (T)); }
+
+    /** Owned, possibly NULL, message.  Restoring allocates it.  */
+    void io_mreq (Mreq *&mreq);
+    /** Pointer to a processor's Preq, saved as the processor's node.  */
+    void io_preq (Preq *&preq);
+
+    /** Save value, or on restore check that the file has the same one.  */
+    void check (int value, const char *what);
+};
+
+#endif // CHECKPOINT_H_
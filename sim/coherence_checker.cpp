@@ -0,0 +1,160 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "coherence_checker.h"
+#include "hash_table.h"
+#include "mreq.h"
+#include "sim.h"
+#include "stat_engine.h"
+
+extern Simulator *Sim;
+
+Coherence_checker::Coherence_checker (int num_nodes, int max_entries)
+    : table (max_entries)
+{
+    this->num_nodes = num_nodes;
+
+    stats = new Stat_engine ("coherence_check");
+    transactions = stats->add_counter ("transactions", "bus transactions checked for SWMR");
+    loads        = stats->add_counter ("loads", "loads checked for the latest value");
+    stores       = stats->add_counter ("stores", "stores numbered");
+    untracked    = stats->add_counter ("untracked", "events on lines past coherence_check_entries");
+}
+
+Coherence_checker::~Coherence_checker ()
+{
+    delete stats;
+}
+
+Hash_entry *Coherence_checker::find (int node, paddr_t addr)
+{
+    MAP<paddr_t, Hash_entry*>::iterator it;
+    Hash_table *l1 = Sim->get_L1 (node);
+
+    it = l1->my_entries.find (addr);
+    return (it == l1->my_entries.end ()) ? NULL : it->second;
+}
+
+void Coherence_checker::violation (paddr_t addr, const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf (stderr, "COHERENCE VIOLATION -- Clock: %lld -- line 0x%llx: ",
+             (long long int)Global_Clock, (unsigned long long int)addr);
+    va_start (ap, fmt);
+    vfprintf (stderr, fmt, ap);
+    va_end (ap);
+
+    for (int i = 0; i < num_nodes; i++)
+    {
+        Hash_entry *entry = find (i, addr);
+
+        if (!entry)
+            continue;
+        fprintf (stderr, "  Cache %d: version %u ", i, entry->data_version);
+        entry->dump ();
+    }
+    fatal_error ("Coherence check failed\n");
+}
+
+void Coherence_checker::bus_transaction (Mreq *request)
+{
+    Coherence_line *line = table.insert (request->addr);
+    Hash_entry *entry;
+    unsigned int version;
+
+    if (!line)
+    {
+        untracked->inc ();
+        return;
+    }
+
+    switch (request->msg) {
+    case DATA:
+        /** A BUSUPD's own completion carries no data.  */
+        if (request->src_mid == request->dest_mid)
+            break;
+        if (request->src_mid.module_index == MC_M)
+            version = line->memory;
+        else
+        {
+            entry = find (request->src_mid.nodeID, request->addr);
+            if (!entry)
+                violation (request->addr, "DATA from cache %d, which never held the line\n",
+                           request->src_mid.nodeID);
+            version = entry->data_version;
+            line->memory = version;
+        }
+        entry = find (request->dest_mid.nodeID, request->addr);
+        if (entry)
+            entry->data_version = version;
+        break;
+
+    case BUSUPD:
+        line->latest++;
+        line->memory = line->latest;
+        for (int i = 0; i < num_nodes; i++)
+            if ((entry = find (i, request->addr)) && entry->data_version == line->latest - 1)
+                entry->data_version = line->latest;
+        if ((entry = find (request->src_mid.nodeID, request->addr)))
+            entry->update_pending = true;
+        stores->inc ();
+        break;
+
+    default:
+        break;
+    }
+}
+
+void Coherence_checker::check_swmr (paddr_t addr)
+{
+    int writers = 0;
+    int readers = 0;
+
+    transactions->inc ();
+    for (int i = 0; i < num_nodes; i++)
+    {
+        Hash_entry *entry = find (i, addr);
+
+        if (!entry)
+            continue;
+        switch (entry->protocol->get_permission ()) {
+        case PERM_WRITE: writers++; break;
+        case PERM_READ:  readers++; break;
+        default:         break;
+        }
+    }
+
+    if (writers > 1 || (writers == 1 && readers > 0))
+        violation (addr, "%d writable and %d readable copies\n", writers, readers);
+}
+
+void Coherence_checker::processor_data (int node, Hash_entry *entry, message_t msg)
+{
+    Coherence_line *line = table.insert (entry->tag);
+
+    if (!line)
+    {
+        untracked->inc ();
+        return;
+    }
+
+    if (msg == STORE)
+    {
+        if (entry->update_pending)
+        {
+            entry->update_pending = false;
+            return;
+        }
+        line->latest++;
+        entry->data_version = line->latest;
+        stores->inc ();
+    }
+    else
+    {
+        loads->inc ();
+        if (entry->data_version != line->latest)
+            violation (entry->tag, "cache %d loaded version %u, latest is %u\n",
+                       node, entry->data_version, line->latest);
+    }
+}
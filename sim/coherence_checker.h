@@ -0,0 +1,67 @@
+#ifndef COHERENCE_CHECKER_H_
+#define COHERENCE_CHECKER_H_
+
+#include "line_table.h"
+#include "types.h"
+#include "../protocols/messages.h"
+
+using namespace std;
+
+class Hash_entry;
+class Mreq;
+class Stat_counter;
+class Stat_engine;
+
+/** The newest value of a line, and the one memory holds, as store counts.  */
+class Coherence_line {
+public:
+    Coherence_line () : latest (0), memory (0) {}
+
+    unsigned int latest;
+    unsigned int memory;
+};
+
+/**
+ * Online coherence invariant checker (coherence_check).  After every bus
+ * transaction it checks single-writer/multiple-reader for that line across
+ * the L1s: at most one copy with write permission, and then no readable
+ * copy anywhere else.  It also numbers the stores to each line and follows
+ * the numbers through the caches (Hash_entry::data_version) and DATA
+ * transfers, so a load that would return anything but the latest store is
+ * caught where it completes.
+ *
+ * Every check touches only the line involved.  A bus update (BUSUPD) is
+ * the store's serialisation point: it brings every up-to-date copy to the
+ * new value and the updating store completes without a second number.
+ * Memory is taken to pick up any data or update that crosses the bus, so
+ * only a reply from memory while a newer copy was never written back is
+ * flagged, not a missing write-back as such.
+ */
+class Coherence_checker {
+public:
+    Coherence_checker (int num_nodes, int max_entries);
+    ~Coherence_checker ();
+
+    int num_nodes;
+    Line_table<Coherence_line> table;
+
+    Stat_engine *stats;
+    Stat_counter *transactions;
+    Stat_counter *loads;
+    Stat_counter *stores;
+    Stat_counter *untracked;
+
+    /** The bus broadcasts request.  */
+    void bus_transaction (Mreq *request);
+    /** All L1s have snooped the last transaction for addr.  */
+    void check_swmr (paddr_t addr);
+    /** node's L1 hands a LOAD or STORE its DATA.  */
+    void processor_data (int node, Hash_entry *entry, message_t msg);
+
+private:
+    Hash_entry *find (int node, paddr_t addr);
+    void violation (paddr_t addr, const char *fmt, ...)
+        __attribute__ ((noreturn, format (printf, 3, 4)));
+};
+
+#endif // COHERENCE_CHECKER_H_
@@ -20,6 +20,9 @@ typedef enum {
     MOESI_PRO,
     MOSI_PRO,
     MOESIF_PRO,
+    DRAGON_PRO,
+    FIREFLY_PRO,
+    HYBRID_PRO,
     NULL_PRO,
     MEM_PRO
 } protocol_t;
@@ -77,7 +80,8 @@ typedef enum {
 	OUTPUT_FMT_COUT = 0,
 	OUTPUT_FMT_CERR,
 	OUTPUT_FMT_CSV,
-	OUTPUT_FMT_NONE
+	OUTPUT_FMT_NONE,
+	OUTPUT_FMT_JSON
 } sim_output_mode_t;
 
 typedef enum {
@@ -104,4 +108,48 @@ typedef enum {
     SEQUENTIAL_MAP
 } thread_map_t;
 
+/** L1 prefetchers, see prefetcher.h.  */
+typedef enum {
+    PREFETCH_NONE = 0,
+    PREFETCH_NEXT_LINE,
+    PREFETCH_STRIDE,
+    PREFETCH_STREAM
+} prefetcher_t;
+
+/** Processor reference sources, see ref_source.h.  */
+typedef enum {
+    REF_SOURCE_TRACE = 0,
+    REF_SOURCE_STRESS,
+    REF_SOURCE_SYNTHETIC
+} ref_source_t;
+
+/** Synthetic workload patterns, see Synthetic_ref_source.  */
+typedef enum {
+    SYNTH_PRIVATE = 0,
+    SYNTH_MIGRATORY,
+    SYNTH_PRODUCER_CONSUMER,
+    SYNTH_READ_MOSTLY,
+    SYNTH_LOCK,
+    SYNTH_FALSE_SHARING
+} synth_pattern_t;
+
+/** Bus snoop filters, see snoop_filter.h.  */
+typedef enum {
+    SNOOP_FILTER_NONE = 0,
+    SNOOP_FILTER_EXACT,
+    SNOOP_FILTER_BLOOM,
+    SNOOP_FILTER_STATE_TABLE
+} snoop_filter_t;
+
+/** Sharing patterns reported by the sim analysis profiler.  */
+typedef enum {
+    SHARING_PRIVATE = 0,
+    SHARING_READ_ONLY,
+    SHARING_MIGRATORY,
+    SHARING_PRODUCER_CONSUMER,
+    SHARING_WIDELY_SHARED,
+    SHARING_OTHER,
+    SHARING_CLASS_NUM
+} sharing_class_t;
+
 #endif
@@ -0,0 +1,661 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "checkpoint.h"
+#include "explorer.h"
+#include "hash_table.h"
+#include "memory.h"
+#include "mreq.h"
+#include "processor.h"
+#include "settings.h"
+#include "sim.h"
+#include "../protocols/MI_protocol.h"
+#include "../protocols/MSI_protocol.h"
+#include "../protocols/MESI_protocol.h"
+#include "../protocols/MOSI_protocol.h"
+#include "../protocols/MOESI_protocol.h"
+#include "../protocols/MOESIF_protocol.h"
+#include "../protocols/DRAGON_protocol.h"
+#include "../protocols/FIREFLY_protocol.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+/** First explored line.  */
+#define EXPLORE_BASE_ADDR 0x10000
+
+/** Bytes of the transaction in a packed state: msg, src, line, reply + 1,
+ *  shared line.  Queue entries are msg, src, line.  */
+#define EXPLORE_TXN_SIZE 5
+#define EXPLORE_QUEUE_ENTRY 3
+
+#define ACTION(step, node, op, line) ((step) | (node) << 4 | (op) << 8 | (line) << 12)
+
+Explorer::Explorer ()
+{
+    num_nodes = settings.num_nodes;
+    num_lines = settings.explore_lines;
+
+    if (num_nodes < 1 || num_nodes > EXPLORE_MAX_NODES)
+        fatal_error ("Explorer: %d caches, at most %d can be explored\n", num_nodes, EXPLORE_MAX_NODES);
+    if (num_lines < 1 || num_lines > EXPLORE_MAX_LINES)
+        fatal_error ("Explorer: invalid explore_lines %d (1 to %d)\n", num_lines, EXPLORE_MAX_LINES);
+    if (settings.explore_max_states <= 0 || settings.explore_max_errors <= 0)
+        fatal_error ("Explorer: invalid explore_max_states %d or explore_max_errors %d\n",
+                     settings.explore_max_states, settings.explore_max_errors);
+    if (settings.qsets_enabled || settings.coherence_check ||
+        settings.checkpoint_file || settings.restore_file)
+        fatal_error ("Explorer: not supported with set dueling, coherence_check or checkpoints\n");
+
+    switch (settings.protocol) {
+    case MI_PRO:      num_states = MI_CACHE_M; break;
+    case MSI_PRO:     num_states = MSI_CACHE_IM; break;
+    case MESI_PRO:    num_states = MESI_CACHE_SM; break;
+    case MOSI_PRO:    num_states = MOSI_CACHE_OM; break;
+    case MOESI_PRO:   num_states = MOESI_CACHE_OM; break;
+    case MOESIF_PRO:  num_states = MOESIF_CACHE_FM; break;
+    case DRAGON_PRO:  num_states = DRAGON_CACHE_SMU; break;
+    case FIREFLY_PRO: num_states = FIREFLY_CACHE_SU; break;
+    default:
+        fatal_error ("Explorer: protocol %d keeps state outside its lines\n", settings.protocol);
+    }
+
+    /** A demand request per node, plus room for a protocol that queues a
+     *  second one, which is reported.  */
+    max_queue = 2 * num_nodes;
+    coverage.assign ((num_states + 1) * MREQ_MESSAGE_NUM, ' ');
+    reached.assign (num_states + 1, false);
+
+    visited = new Line_table<Explore_visit> (settings.explore_max_states);
+    states = 0;
+    transitions = 0;
+    depth = 0;
+    errors = 0;
+    truncated = false;
+    cell = -1;
+    current = NULL;
+}
+
+Explorer::~Explorer ()
+{
+    delete visited;
+    for (unsigned int i = 0; i < reported.size (); i++)
+        free (reported[i]);
+}
+
+paddr_t Explorer::line_addr (int line)
+{
+    return EXPLORE_BASE_ADDR + (paddr_t)line * settings.cache_line_size;
+}
+
+int Explorer::line_of (paddr_t addr)
+{
+    for (int line = 0; line < num_lines; line++)
+        if (line_addr (line) == addr)
+            return line;
+    fatal_error ("Request for address 0x%llx, which is not an explored line\n",
+                 (unsigned long long int)addr);
+}
+
+/** Protocols checkpoint their state enum first.  */
+int Explorer::line_state (const unsigned char *state, int node, int line)
+{
+    int value;
+
+    memcpy (&value, state + (node * num_lines + line) * image_size, sizeof (value));
+    return value;
+}
+
+/********************************************************************************
+ * Packing.
+ ********************************************************************************/
+void Explorer::load (const unsigned char *state)
+{
+    const unsigned char *p = state + num_nodes * num_lines * image_size;
+    Bus *bus = Sim->bus;
+    int queued;
+
+    current = state;
+    for (int node = 0; node < num_nodes; node++)
+        for (int line = 0; line < num_lines; line++)
+        {
+            Checkpoint ckpt ((void *)(state + (node * num_lines + line) * image_size), image_size, false);
+
+            entries[node][line]->protocol->checkpoint (&ckpt);
+        }
+
+    for (int node = 0; node < num_nodes; node++, p++)
+    {
+        proc_op[node] = (message_t)(*p >> 4);
+        proc_line[node] = *p & 0xf;
+
+        /** Left over from a step that failed.  */
+        Processor *pr = Sim->get_PR (node);
+        if (pr->inbound_request_buf)
+        {
+            delete pr->inbound_request_buf;
+            pr->inbound_request_buf = NULL;
+        }
+    }
+
+    txn_msg = (message_t)p[0];
+    txn_src = p[1];
+    txn_line = p[2];
+    txn_reply = (int)p[3] - 1;
+    txn_shared = p[4];
+    p += EXPLORE_TXN_SIZE;
+
+    while (!bus->pending_requests.empty ())
+    {
+        delete bus->pending_requests.front ();
+        bus->pending_requests.pop_front ();
+    }
+    if (bus->data_reply)
+    {
+        delete bus->data_reply;
+        bus->data_reply = NULL;
+    }
+
+    queued = *p++;
+    for (int i = 0; i < queued; i++, p += EXPLORE_QUEUE_ENTRY)
+    {
+        Mreq *request = new Mreq ((message_t)p[0], line_addr (p[2]), Sim->get_L1 (p[1])->moduleID);
+
+        request->preq = &Sim->get_PR (p[1])->preq;
+        bus->pending_requests.push_back (request);
+    }
+}
+
+/** Pack the protocols and the bus queue, which is emptied.  */
+void Explorer::save (unsigned char *state)
+{
+    unsigned char *p = state + num_nodes * num_lines * image_size;
+    LIST<Mreq *> &queue = Sim->bus->pending_requests;
+
+    memset (state, 0, state_size);
+    for (int node = 0; node < num_nodes; node++)
+        for (int line = 0; line < num_lines; line++)
+        {
+            Checkpoint ckpt (state + (node * num_lines + line) * image_size, image_size, true);
+            int value;
+
+            entries[node][line]->protocol->checkpoint (&ckpt);
+            if (ckpt.offset != image_size)
+                fatal_error ("Cache %d line %d saved %zu bytes of state, not %zu\n",
+                             node, line, ckpt.offset, image_size);
+            value = line_state (state, node, line);
+            if (value >= 1 && value <= num_states)
+                reached[value] = true;
+        }
+
+    for (int node = 0; node < num_nodes; node++)
+        *p++ = (unsigned char)(proc_op[node] << 4 | proc_line[node]);
+
+    p[0] = (unsigned char)txn_msg;
+    p[1] = (unsigned char)txn_src;
+    p[2] = (unsigned char)txn_line;
+    p[3] = (unsigned char)(txn_reply + 1);
+    p[4] = txn_shared;
+    p += EXPLORE_TXN_SIZE;
+
+    if ((int)queue.size () > max_queue)
+        fatal_error ("%d requests queued on the bus\n", (int)queue.size ());
+    *p++ = (unsigned char)queue.size ();
+    while (!queue.empty ())
+    {
+        Mreq *request = queue.front ();
+
+        queue.pop_front ();
+        p[0] = (unsigned char)request->msg;
+        p[1] = (unsigned char)request->src_mid.nodeID;
+        p[2] = (unsigned char)line_of (request->addr);
+        delete request;
+        p += EXPLORE_QUEUE_ENTRY;
+    }
+}
+
+void Explorer::enabled (const unsigned char *state, VECTOR<int> &actions)
+{
+    const unsigned char *p = state + num_nodes * num_lines * image_size;
+
+    actions.clear ();
+    for (int node = 0; node < num_nodes; node++)
+        if ((p[node] >> 4) == NOP)
+            for (int line = 0; line < num_lines; line++)
+            {
+                actions.push_back (ACTION (EXPLORE_ISSUE, node, LOAD, line));
+                actions.push_back (ACTION (EXPLORE_ISSUE, node, STORE, line));
+            }
+
+    p += num_nodes;
+    if (p[0] != NOP)
+        actions.push_back (ACTION (EXPLORE_DATA, 0, 0, 0));
+    else if (p[EXPLORE_TXN_SIZE] > 0)
+        actions.push_back (ACTION (EXPLORE_GRANT, 0, 0, 0));
+}
+
+/********************************************************************************
+ * Steps.
+ ********************************************************************************/
+/** Apply action to state.  On success the result is packed into next; on
+ *  an error returns false with the message in error.  */
+bool Explorer::step (const unsigned char *state, int action, unsigned char *next)
+{
+    bool ok = true;
+
+    load (state);
+    fatal_error_throws = true;
+    try
+    {
+        switch (action & 0xf) {
+        case EXPLORE_ISSUE:
+            issue ((action >> 4) & 0xf, (message_t)((action >> 8) & 0xf), (action >> 12) & 0xf);
+            break;
+        case EXPLORE_GRANT:
+            grant ();
+            break;
+        case EXPLORE_DATA:
+            deliver ();
+            break;
+        }
+        check ();
+        save (next);
+    }
+    catch (Sim_error &e)
+    {
+        if (cell >= 0)
+            coverage[cell] = '!';
+        strcpy (error, e.message);
+        ok = false;
+    }
+    fatal_error_throws = false;
+    cell = -1;
+    return ok;
+}
+
+void Explorer::issue (int node, message_t op, int line)
+{
+    proc_op[node] = op;
+    proc_line[node] = line;
+    call (node, line, new Mreq (op, line_addr (line), Sim->get_L1 (node)->moduleID), false);
+}
+
+void Explorer::grant (void)
+{
+    Bus *bus = Sim->bus;
+    Mreq *request = bus->pending_requests.front ();
+
+    bus->pending_requests.pop_front ();
+    txn_msg = request->msg;
+    txn_src = request->src_mid.nodeID;
+    txn_line = line_of (request->addr);
+    txn_reply = -1;
+
+    bus->shared_line = false;
+    for (int node = 0; node < num_nodes; node++)
+    {
+        Mreq *snoop = new Mreq ();
+
+        *snoop = *request;
+        call (node, txn_line, snoop, true);
+    }
+    txn_shared = bus->shared_line;
+    delete request;
+
+    if (txn_reply < 0)
+    {
+        if (txn_msg == BUSUPD)
+            fatal_error ("Cache %d did not complete its BUSUPD\n", txn_src);
+        txn_reply = num_nodes;
+    }
+}
+
+void Explorer::deliver (void)
+{
+    ModuleID src = (txn_reply == num_nodes) ? Sim->get_MC (num_nodes)->moduleID
+                                            : Sim->get_L1 (txn_reply)->moduleID;
+    int dest = txn_src;
+    int line = txn_line;
+
+    /** The bus is free once the DATA is on it.  */
+    txn_msg = NOP;
+    txn_src = 0;
+    txn_line = 0;
+    txn_reply = -1;
+    Sim->bus->shared_line = txn_shared;
+    txn_shared = false;
+
+    call (dest, line, new Mreq (DATA, line_addr (line), src, Sim->get_L1 (dest)->moduleID), true);
+}
+
+/** Hand request, which is freed, to a line's protocol and pick up what it
+ *  sends.  */
+void Explorer::call (int node, int line, Mreq *request, bool snoop)
+{
+    Protocol *protocol = entries[node][line]->protocol;
+    int value = line_state (current, node, line);
+
+    if (value >= 1 && value <= num_states)
+    {
+        cell = value * MREQ_MESSAGE_NUM + request->msg;
+        if (coverage[cell] == ' ')
+            coverage[cell] = 'x';
+    }
+
+    if (snoop)
+        protocol->process_snoop_request (request);
+    else
+        protocol->process_cache_request (request);
+    cell = -1;
+    delete request;
+
+    take_reply (node);
+    collect (node);
+}
+
+void Explorer::take_reply (int node)
+{
+    Mreq *data = Sim->bus->data_reply;
+    ModuleID dest;
+
+    if (!data)
+        return;
+    Sim->bus->data_reply = NULL;
+    dest = data->dest_mid;
+    delete data;
+
+    if (txn_msg == NOP)
+        fatal_error ("Cache %d sent DATA with no request on the bus\n", node);
+    if (txn_reply >= 0)
+        fatal_error ("Cache %d sent a second DATA reply to the %s from cache %d\n",
+                     node, Mreq::message_t_str[txn_msg], txn_src);
+    if (dest != Sim->get_L1 (txn_src)->moduleID)
+        fatal_error ("Cache %d sent DATA to node %d, not to the requester %d\n",
+                     node, dest.nodeID, txn_src);
+    txn_reply = node;
+}
+
+void Explorer::collect (int node)
+{
+    Processor *pr = Sim->get_PR (node);
+    paddr_t addr;
+
+    if (!pr->inbound_request_buf)
+        return;
+    addr = pr->inbound_request_buf->addr;
+    delete pr->inbound_request_buf;
+    pr->inbound_request_buf = NULL;
+
+    if (proc_op[node] == NOP)
+        fatal_error ("Cache %d sent DATA to its processor, which has nothing outstanding\n", node);
+    if (addr != line_addr (proc_line[node]))
+        fatal_error ("Cache %d answered its processor's %s to line %d with line 0x%llx\n",
+                     node, Mreq::message_t_str[proc_op[node]], proc_line[node],
+                     (unsigned long long int)addr);
+    proc_op[node] = NOP;
+    proc_line[node] = 0;
+}
+
+/** SWMR for every line, and no processor waiting on an idle bus.  */
+void Explorer::check (void)
+{
+    for (int line = 0; line < num_lines; line++)
+    {
+        int writers = 0;
+        int readers = 0;
+
+        for (int node = 0; node < num_nodes; node++)
+            switch (entries[node][line]->protocol->get_permission ()) {
+            case PERM_WRITE: writers++; break;
+            case PERM_READ:  readers++; break;
+            default:         break;
+            }
+        if (writers > 1 || (writers == 1 && readers > 0))
+            fatal_error ("Line %d has %d writable and %d readable copies\n", line, writers, readers);
+    }
+
+    if (txn_msg != NOP || !Sim->bus->pending_requests.empty ())
+        return;
+    for (int node = 0; node < num_nodes; node++)
+        if (proc_op[node] != NOP)
+            fatal_error ("Processor %d waits on its %s to line %d with nothing on the bus\n",
+                         node, Mreq::message_t_str[proc_op[node]], proc_line[node]);
+}
+
+/********************************************************************************
+ * Search and reports.
+ ********************************************************************************/
+static uint64_t fingerprint (const unsigned char *state, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= state[i];
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 32;
+
+    /** Line_table reserves all ones for empty slots.  */
+    return (hash == ~(uint64_t)0) ? 0 : hash;
+}
+
+/** Describe action from state; returns the line it acts on.  */
+int Explorer::describe (const unsigned char *state, int action, char *buf, size_t size)
+{
+    int line = (action >> 12) & 0xf;
+    Mreq *request;
+
+    load (state);
+    switch (action & 0xf) {
+    case EXPLORE_ISSUE:
+        snprintf (buf, size, "PR %d issues %s to line %d", (action >> 4) & 0xf,
+                  Mreq::message_t_str[(action >> 8) & 0xf], line);
+        break;
+    case EXPLORE_GRANT:
+        request = Sim->bus->pending_requests.front ();
+        line = line_of (request->addr);
+        snprintf (buf, size, "Bus grants %s from cache %d for line %d",
+                  Mreq::message_t_str[request->msg], request->src_mid.nodeID, line);
+        break;
+    case EXPLORE_DATA:
+        line = txn_line;
+        if (txn_reply == num_nodes)
+            snprintf (buf, size, "Memory DATA for line %d to cache %d", line, txn_src);
+        else
+            snprintf (buf, size, "Cache %d DATA for line %d to cache %d", txn_reply, line, txn_src);
+        break;
+    }
+    return line;
+}
+
+/** Print the shortest trace to the error action hits from the state in
+ *  slot, once per distinct message.  */
+void Explorer::report (unsigned int slot, int action)
+{
+    VECTOR<int> path;
+    VECTOR<unsigned char> state (initial), next (state_size);
+    char message[256];
+    char what[128];
+
+    for (unsigned int i = 0; i < reported.size (); i++)
+        if (!strcmp (reported[i], error))
+            return;
+    reported.push_back (strdup (error));
+    strcpy (message, error);
+    errors++;
+
+    path.push_back (action);
+    for (Explore_visit *visit = visited->entry (slot); visit->action; visit = visited->entry (slot))
+    {
+        path.push_back (visit->action);
+        slot = visit->parent;
+    }
+
+    fprintf (stderr, "EXPLORE ERROR: %s", message);
+    if (message[0] && message[strlen (message) - 1] != '\n')
+        fprintf (stderr, "\n");
+    fprintf (stderr, "  Trace (%d steps):\n", (int)path.size ());
+    for (int i = path.size () - 1; i >= 0; i--)
+    {
+        int line;
+        bool ok;
+
+        line = describe (&state[0], path[i], what, sizeof (what));
+        ok = step (&state[0], path[i], &next[0]);
+        fprintf (stderr, "  %3d. %s%s\n", (int)path.size () - i, what, ok ? "" : " -- error");
+        for (int node = 0; node < num_nodes; node++)
+        {
+            fprintf (stderr, "         Cache %d: ", node);
+            entries[node][line]->dump ();
+        }
+        if (!ok)
+            break;
+        state.swap (next);
+    }
+}
+
+void Explorer::summary (double seconds)
+{
+    unsigned char image[EXPLORE_MAX_IMAGE];
+    int unreached = 0;
+
+    fprintf (stderr, "Explored %lld states, %lld transitions, depth %d in %.2f s (%.0f states/s)\n",
+             states, transitions, depth, seconds, seconds > 0 ? states / seconds : 0.0);
+
+    fprintf (stderr, "Handlers taken (x), failing (!), never taken (.):\n");
+    fprintf (stderr, "  state");
+    for (int msg = LOAD; msg <= BUSUPD; msg++)
+        fprintf (stderr, " %6s", Mreq::message_t_str[msg]);
+    fprintf (stderr, "\n");
+
+    /** Borrow a line to print each state's name.  */
+    for (int value = 1; value <= num_states; value++)
+    {
+        Checkpoint ckpt (image, image_size, false);
+
+        fprintf (stderr, "  %5d", value);
+        for (int msg = LOAD; msg <= BUSUPD; msg++)
+        {
+            char mark = coverage[value * MREQ_MESSAGE_NUM + msg];
+            fprintf (stderr, " %6c", mark == ' ' ? '.' : mark);
+        }
+        fprintf (stderr, "  %s", reached[value] ? "" : "(never reached) ");
+        unreached += !reached[value];
+
+        memset (image, 0, sizeof (image));
+        memcpy (image, &value, sizeof (value));
+        entries[0][0]->protocol->checkpoint (&ckpt);
+        entries[0][0]->protocol->dump ();
+    }
+
+    if (truncated)
+        fprintf (stderr, "EXPLORE INCOMPLETE -- explore_max_states (%d) reached\n",
+                 settings.explore_max_states);
+    if (errors)
+        fprintf (stderr, "EXPLORE FAIL -- %d error%s, %d unreached state%s\n",
+                 errors, errors == 1 ? "" : "s", unreached, unreached == 1 ? "" : "s");
+    else if (!truncated)
+        fprintf (stderr, "EXPLORE PASS -- %d unreached state%s\n", unreached, unreached == 1 ? "" : "s");
+}
+
+void Explorer::run (void)
+{
+    VECTOR<unsigned char> frontier, next_frontier, next;
+    VECTOR<unsigned int> slots, next_slots;
+    VECTOR<int> actions;
+    unsigned char image[EXPLORE_MAX_IMAGE];
+    struct timeval start, end;
+    Explore_visit *visit;
+    bool created;
+    bool stop = false;
+
+    fprintf (stderr, "Exploring %d caches, %d line%s\n", num_nodes, num_lines, num_lines == 1 ? "" : "s");
+    sim_log_muted = true;
+    gettimeofday (&start, NULL);
+
+    for (int node = 0; node < num_nodes; node++)
+        for (int line = 0; line < num_lines; line++)
+            entries[node][line] = Sim->get_L1 (node)->get_entry (line_addr (line));
+
+    {
+        Checkpoint ckpt (image, sizeof (image), true);
+
+        entries[0][0]->protocol->checkpoint (&ckpt);
+        image_size = ckpt.offset;
+    }
+    state_size = num_nodes * num_lines * image_size + num_nodes + EXPLORE_TXN_SIZE
+                 + 1 + max_queue * EXPLORE_QUEUE_ENTRY;
+
+    for (int node = 0; node < num_nodes; node++)
+    {
+        proc_op[node] = NOP;
+        proc_line[node] = 0;
+    }
+    txn_msg = NOP;
+    txn_src = 0;
+    txn_line = 0;
+    txn_reply = -1;
+    txn_shared = false;
+    initial.resize (state_size);
+    save (&initial[0]);
+
+    visit = visited->insert (fingerprint (&initial[0], state_size));
+    frontier = initial;
+    slots.push_back (visit - visited->entry (0));
+    states = 1;
+    next.resize (state_size);
+
+    while (!frontier.empty () && !stop)
+    {
+        next_frontier.clear ();
+        next_slots.clear ();
+
+        for (unsigned int i = 0; i < slots.size () && !stop; i++)
+        {
+            const unsigned char *state = &frontier[i * state_size];
+
+            enabled (state, actions);
+            for (unsigned int a = 0; a < actions.size (); a++)
+            {
+                transitions++;
+                if (!step (state, actions[a], &next[0]))
+                {
+                    report (slots[i], actions[a]);
+                    if (errors >= settings.explore_max_errors)
+                    {
+                        stop = true;
+                        break;
+                    }
+                    continue;
+                }
+
+                visit = visited->insert (fingerprint (&next[0], state_size), &created);
+                if (!visit)
+                {
+                    truncated = stop = true;
+                    break;
+                }
+                if (!created)
+                    continue;
+
+                visit->parent = slots[i];
+                visit->action = actions[a];
+                next_frontier.insert (next_frontier.end (), next.begin (), next.end ());
+                next_slots.push_back (visit - visited->entry (0));
+                states++;
+            }
+        }
+
+        frontier.swap (next_frontier);
+        slots.swap (next_slots);
+        if (!frontier.empty ())
+            depth++;
+    }
+
+    gettimeofday (&end, NULL);
+    sim_log_muted = false;
+    summary ((end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6);
+}
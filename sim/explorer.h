@@ -0,0 +1,139 @@
+#ifndef EXPLORER_H_
+#define EXPLORER_H_
+
+#include <stdint.h>
+
+#include "line_table.h"
+#include "types.h"
+#include "../protocols/messages.h"
+
+using namespace std;
+
+class Hash_entry;
+class Mreq;
+
+#define EXPLORE_MAX_NODES 8
+#define EXPLORE_MAX_LINES 4
+/** Largest protocol checkpoint () image of one line.  */
+#define EXPLORE_MAX_IMAGE 16
+
+/** Explorer steps.  An action packs the step with its node, operation and
+ *  line: step | node << 4 | op << 8 | line << 12.  */
+typedef enum {
+    EXPLORE_ISSUE = 1,      // a processor issues a LOAD or STORE
+    EXPLORE_GRANT,          // the bus grants its oldest request, every L1 snoops it
+    EXPLORE_DATA            // the granted request's DATA reply arrives
+} explore_step_t;
+
+/** How a visited state was first reached: the slot of the state before it
+ *  and the action taken, 0 for the initial state.  */
+class Explore_visit {
+public:
+    Explore_visit () : parent (0), action (0) {}
+
+    unsigned int parent;
+    int action;
+};
+
+/**
+ * Exhaustive state-space explorer (explore).  Instead of running traces it
+ * drives the real protocol objects of a tiny system, -n caches and
+ * explore_lines lines, through every interleaving of processor LOADs and
+ * STOREs, bus grants and DATA replies, breadth first.  Each processor has
+ * at most one request outstanding, the bus grants requests in order and
+ * holds each one until its DATA, as the simulator does, and a granted
+ * request is snooped by all caches in one step.  Memory answers any
+ * request no cache answered, except a BUSUPD, which its sender completes.
+ *
+ * A global state is the checkpoint () image of every line's protocol plus
+ * the outstanding processor requests, the bus queue and the transaction in
+ * progress.  Visited states are kept only as 64-bit fingerprints in a
+ * Line_table of explore_max_states entries (hash compaction: a collision
+ * can hide a state, with odds of about states^2 / 2^65).
+ *
+ * Errors are a fatal_error () anywhere in a protocol, DATA sent where none
+ * is expected, more than one writable copy or a writable and a readable
+ * copy of a line, and a processor left waiting with the bus idle.  Each
+ * distinct error is printed once with the shortest action trace that
+ * reaches it.  Finally every (state, message) handler is listed as taken,
+ * failing or never taken, and states never reached are flagged.
+ *
+ * Protocols whose behaviour depends on state outside the line (HYBRID's
+ * predictors, set dueling) cannot be explored this way.
+ */
+class Explorer {
+public:
+    Explorer ();
+    ~Explorer ();
+
+    int num_nodes;
+    int num_lines;
+    /** Line states run from 1 to num_states.  */
+    int num_states;
+    Hash_entry *entries[EXPLORE_MAX_NODES][EXPLORE_MAX_LINES];
+
+    /** Packed state: the line images, then per node the outstanding
+     *  operation and line, the transaction, and the bus queue.  */
+    size_t image_size;
+    size_t state_size;
+    int max_queue;
+    VECTOR<unsigned char> initial;
+
+    Line_table<Explore_visit> *visited;
+
+    /** coverage[state * MREQ_MESSAGE_NUM + msg]: ' ' never taken, 'x'
+     *  taken, '!' ended in an error.  */
+    VECTOR<char> coverage;
+    VECTOR<bool> reached;
+    /** Messages of the errors already printed.  */
+    VECTOR<char *> reported;
+
+    long long int states;
+    long long int transitions;
+    int depth;
+    int errors;
+    bool truncated;
+
+    void run (void);
+    bool passed (void) { return errors == 0 && !truncated; }
+
+private:
+    /** The state being stepped, unpacked.  proc_op is NOP for an idle
+     *  processor.  txn_msg is NOP while the bus is idle; txn_reply is the
+     *  cache that answered, num_nodes for memory, -1 for none yet.  */
+    const unsigned char *current;
+    message_t proc_op[EXPLORE_MAX_NODES];
+    int proc_line[EXPLORE_MAX_NODES];
+    message_t txn_msg;
+    int txn_src;
+    int txn_line;
+    int txn_reply;
+    bool txn_shared;
+
+    /** Coverage entry of the handler running, -1 outside a protocol.  */
+    int cell;
+    char error[256];
+
+    paddr_t line_addr (int line);
+    int line_of (paddr_t addr);
+    int line_state (const unsigned char *state, int node, int line);
+
+    void load (const unsigned char *state);
+    void save (unsigned char *state);
+    void enabled (const unsigned char *state, VECTOR<int> &actions);
+    bool step (const unsigned char *state, int action, unsigned char *next);
+    int describe (const unsigned char *state, int action, char *buf, size_t size);
+
+    void issue (int node, message_t op, int line);
+    void grant (void);
+    void deliver (void);
+    void call (int node, int line, Mreq *request, bool snoop);
+    void take_reply (int node);
+    void collect (int node);
+    void check (void);
+
+    void report (unsigned int slot, int action);
+    void summary (double seconds);
+};
+
+#endif // EXPLORER_H_
@@ -3,6 +3,7 @@
 #include <math.h>
 #include <string.h>
 
+#include "checkpoint.h"
 #include "hash_table.h"
 #include "../protocols/MI_protocol.h"
 #include "../protocols/MSI_protocol.h"
@@ -10,15 +11,20 @@
 #include "../protocols/MOSI_protocol.h"
 #include "../protocols/MOESI_protocol.h"
 #include "../protocols/MOESIF_protocol.h"
+#include "../protocols/DRAGON_protocol.h"
+#include "../protocols/FIREFLY_protocol.h"
+#include "../protocols/HYBRID_protocol.h"
 #include "settings.h"
 #include "sharers.h"
 #include "sim.h"
+#include "snoop_filter.h"
 #include "types.h"
 #include "processor.h"
 
 using namespace std;
 
 extern Simulator *Sim;
+extern Sim_settings settings;
 
 /***************************************************************************
  * Hash_entry constructor, destructor, and functions.
@@ -27,35 +33,45 @@ Hash_entry::Hash_entry (Hash_table *t, paddr_t tag)
 {
     this->my_table = t;
     this->tag = tag;
+    this->prefetch_pending = false;
+    this->prefetched = false;
+    this->in_snoop_filter = false;
+    this->data_version = 0;
+    this->update_pending = false;
+    this->protocol = create_protocol ();
+}
+
+Hash_entry::~Hash_entry (void)
+{
+}
 
+/** A fresh protocol object, with the line invalid.  */
+Protocol *Hash_entry::create_protocol (void)
+{
     switch (my_table->protocol) {
     case MI_PRO:
-        protocol = new MI_protocol (my_table, this);
-        break;
+        return new MI_protocol (my_table, this);
     case MSI_PRO:
-    	protocol = new MSI_protocol (my_table, this);
-    	break;
+    	return new MSI_protocol (my_table, this);
     case MESI_PRO:
-    	protocol = new MESI_protocol (my_table, this);
-    	break;
+    	return new MESI_protocol (my_table, this);
     case MOSI_PRO:
-    	protocol = new MOSI_protocol (my_table, this);
-    	break;
+    	return new MOSI_protocol (my_table, this);
     case MOESI_PRO:
-    	protocol = new MOESI_protocol (my_table, this);
-    	break;
+    	return new MOESI_protocol (my_table, this);
     case MOESIF_PRO:
-    	protocol = new MOESIF_protocol (my_table, this);
-    	break;
+    	return new MOESIF_protocol (my_table, this);
+    case DRAGON_PRO:
+    	return new DRAGON_protocol (my_table, this);
+    case FIREFLY_PRO:
+    	return new FIREFLY_protocol (my_table, this);
+    case HYBRID_PRO:
+    	return new HYBRID_protocol (my_table, this);
     default:
         fatal_error ("Hash_entry: Unknown coherence protocol!\n");
     }
 }
 
-Hash_entry::~Hash_entry (void)
-{
-}
-
 void Hash_entry::process_request_snoop (Mreq *request)
 {
     assert (protocol);
@@ -66,7 +82,35 @@ void Hash_entry::process_request_snoop (Mreq *request)
 
 void Hash_entry::process_request_processor (Mreq *request)
 {
+    perm_t perm = protocol->get_permission ();
+
+    if (Sim->bus->snoop_filter && !in_snoop_filter)
+    {
+        Sim->bus->snoop_filter->insert (tag, my_table->moduleID.nodeID);
+        in_snoop_filter = true;
+    }
+    if (!my_table->issuing_prefetch)
+        my_table->proc_op = request->msg;
     protocol->process_cache_request (request);
+    if (Sim->bus->snoop_filter && protocol->get_permission () != perm)
+        Sim->bus->snoop_filter->set_state (tag, my_table->moduleID.nodeID,
+                                           protocol->get_permission ());
+}
+
+/** On restore, lines recorded in the snoop filter are put back in it.  */
+void Hash_entry::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (prefetch_pending);
+    ckpt->io (prefetched);
+    ckpt->io (in_snoop_filter);
+    protocol->checkpoint (ckpt);
+
+    if (!ckpt->saving && in_snoop_filter && Sim->bus->snoop_filter)
+    {
+        Sim->bus->snoop_filter->insert (tag, my_table->moduleID.nodeID);
+        Sim->bus->snoop_filter->set_state (tag, my_table->moduleID.nodeID,
+                                           protocol->get_permission ());
+    }
 }
 
 void Hash_entry::dump (void)
@@ -118,13 +162,36 @@ Hash_table::Hash_table (ModuleID moduleID, const char *name,
     index_mask = index_mask << (num_offset_bits);
     index_mask = index_mask & ~tag_mask;
 
+    proc_request = NULL;
+    proc_op = MREQ_INVALID;
+    local_accesses = 0;
     my_entries.clear ();
+
+    stats = new Hash_table_stat_engine (name);
+
+    prefetcher = Prefetcher::create (settings.prefetcher);
+    prefetch_stats = NULL;
+    if (prefetcher)
+    {
+        prefetch_stats = new Prefetch_stat_engine ("prefetch");
+        stats->add_child (prefetch_stats);
+    }
+    prefetches_outstanding = 0;
+    issuing_prefetch = false;
+    deferred_request = NULL;
+    deferred_time = 0;
+    replay_deferred = false;
 }
 
 /** Destructor.  */
 Hash_table::~Hash_table (void)
 {
-
+    if (prefetcher)
+    {
+        delete prefetcher;
+        delete prefetch_stats;
+    }
+    delete stats;
 }
 
 /*****************************
@@ -134,37 +201,319 @@ void Hash_table::tick (void)
 {
     Mreq *request;
     Hash_entry *entry;
+    perm_t perm;
+
+    if (local_accesses)
+    {
+        Sim->cache_accesses += local_accesses;
+        local_accesses = 0;
+    }
 
     /** Request from processor.  */
     if (proc_request)
     {
-    	fprintf(stderr,"** PROC REQUEST -- ");
+    	sim_log ("** PROC REQUEST -- ");
     	proc_request->print_msg (moduleID, NULL);
     	Sim->cache_accesses++;
+        stats->accesses->inc ();
+        if (Sim->analysis)
+            Sim->analysis->processor_access (moduleID.nodeID, proc_request->msg,
+                                             proc_request->preq ? proc_request->preq->addr : proc_request->addr);
+        if (Sim->sd_profiler)
+            Sim->sd_profiler->processor_access (moduleID.nodeID, proc_request->addr);
         entry = get_entry (proc_request->addr);
         assert (entry);
+
+        if (entry->prefetch_pending)
+        {
+            /** Late prefetch: wait for its DATA rather than racing it.  */
+            prefetch_stats->late->inc ();
+            stats->misses->inc ();
+            Sim->bus->promote_prefetch (proc_request->addr, moduleID);
+            deferred_request = proc_request;
+            deferred_time = Global_Clock;
+            proc_request = NULL;
+        }
+    }
+
+    if (proc_request)
+    {
         entry->process_request_processor (proc_request);
+
+        /** Hits hand the DATA straight back to the processor.  */
+        bool hit = Sim->get_PR (moduleID.nodeID)->inbound_request_buf != NULL;
+        if (hit)
+            stats->hits->inc ();
+        else
+            stats->misses->inc ();
+        if (Sim->dueling)
+            Sim->dueling->access (proc_request->addr, hit);
+
+        if (prefetcher)
+        {
+            if (entry->prefetched)
+            {
+                entry->prefetched = false;
+                prefetch_stats->useful->inc ();
+                prefetch_stats->unused->value--;
+            }
+
+            prefetch_candidates.clear ();
+            prefetcher->observe (proc_request->addr, proc_request->pc, hit, prefetch_candidates);
+            for (unsigned int i = 0; i < prefetch_candidates.size (); i++)
+                issue_prefetch (prefetch_candidates[i]);
+        }
         delete proc_request;
         proc_request = NULL;
     }
 
     /** Request from bus.  */
-    request = read_input_port ();
+    request = Sim->bus->snoop_wanted (moduleID) ? read_input_port () : NULL;
     if (request)
     {
     	if (request->msg == DATA && request->dest_mid != this->moduleID)
     	{
+    		delete request;
     		return;
     	}
 
-    	fprintf(stderr,"*** SNOOP REQUEST -- ");
+    	sim_log ("*** SNOOP REQUEST -- ");
         request->print_msg (moduleID, NULL);
+        if (request->msg == DATA)
+            stats->data_received->inc ();
+        else
+            stats->snoops->inc ();
         entry = get_entry (request->addr);
         assert (entry);
+        perm = entry->protocol->get_permission ();
         entry->process_request_snoop (request);
+
+        if (Sim->bus->snoop_filter && entry->protocol->get_permission () != perm)
+            Sim->bus->snoop_filter->set_state (entry->tag, moduleID.nodeID,
+                                               entry->protocol->get_permission ());
+        if (Sim->bus->snoop_filter && entry->protocol->get_permission () == PERM_INVALID)
+        {
+            if (perm == PERM_INVALID && request->msg != DATA)
+                Sim->bus->snoop_filter->useless_deliveries->inc ();
+            if (entry->in_snoop_filter)
+            {
+                Sim->bus->snoop_filter->remove (entry->tag, moduleID.nodeID);
+                entry->in_snoop_filter = false;
+            }
+        }
+
+        /** Another core's write, or losing the line, breaks an LL link.  */
+        if (request->msg != DATA && (entry->protocol->get_permission () == PERM_INVALID
+            || ((request->msg == GETM || request->msg == BUSUPD)
+                && request->src_mid.nodeID != moduleID.nodeID)))
+            Sim->get_PR (moduleID.nodeID)->break_link (request->addr);
+
+        if (entry->prefetched && entry->protocol->get_permission () == PERM_INVALID)
+        {
+            entry->prefetched = false;
+            prefetch_stats->invalidated->inc ();
+            prefetch_stats->unused->value--;
+        }
+
+        /** The prefetch a demand reference was waiting on has filled.  */
+        if (replay_deferred)
+        {
+            Mreq *deferred = deferred_request;
+
+            replay_deferred = false;
+            deferred_request = NULL;
+            prefetch_stats->late_cycles->add (Global_Clock - deferred_time);
+            get_entry (deferred->addr)->process_request_processor (deferred);
+            delete deferred;
+        }
+        delete request;
     }
 }
 
+/** Parallel mode: serve a processor LOAD that hits a readable line.  This
+ *  touches nothing outside the node, so it runs concurrently with the
+ *  other L1s; everything else waits for the serial tick ().  */
+void Hash_table::tick_local_hit (void)
+{
+    MAP<paddr_t, Hash_entry*>::iterator it;
+    perm_t perm;
+
+    if (!proc_request || proc_request->msg != LOAD)
+        return;
+
+    it = my_entries.find (proc_request->addr);
+    if (it == my_entries.end ())
+        return;
+    perm = it->second->protocol->get_permission ();
+    if (perm != PERM_READ && perm != PERM_WRITE)
+        return;
+
+    sim_log ("** PROC REQUEST -- ");
+    proc_request->print_msg (moduleID, NULL);
+    local_accesses++;
+    stats->accesses->inc ();
+
+    it->second->process_request_processor (proc_request);
+    assert (Sim->get_PR (moduleID.nodeID)->inbound_request_buf);
+    stats->hits->inc ();
+
+    delete proc_request;
+    proc_request = NULL;
+}
+
+/** hit_fast_path: the line a msg for addr would hit, if there is no
+ *  queued bus request for it that could be snooped first, else NULL.  */
+Hash_entry *Hash_table::fast_hit_entry (message_t msg, paddr_t addr)
+{
+    MAP<paddr_t, Hash_entry*>::iterator it;
+    perm_t perm;
+
+    /** The profilers and the prefetcher watch every access.  */
+    if (prefetcher || Sim->analysis || Sim->sd_profiler || Sim->dueling)
+        return NULL;
+
+    addr &= ~((paddr_t)blocksize - 1);
+    it = my_entries.find (addr);
+    if (it == my_entries.end ())
+        return NULL;
+    perm = it->second->protocol->get_permission ();
+    if (perm != PERM_WRITE && (perm != PERM_READ || msg != LOAD))
+        return NULL;
+    if (Sim->bus->line_queued (addr))
+        return NULL;
+    return it->second;
+}
+
+/** hit_fast_path: serve a processor request at fetch time, a cycle early,
+ *  if fast_hit_entry () finds the line.  The line ends up in the same state,
+ *  with the same stats, as on the normal path; only the PROC REQUEST log
+ *  line is skipped.  Returns false, leaving request untouched, if it must
+ *  take the normal path.  */
+bool Hash_table::fast_hit (Mreq *request)
+{
+    Hash_entry *entry;
+    Processor *pr;
+
+    entry = fast_hit_entry (request->msg, request->addr);
+    if (!entry)
+        return false;
+
+    /** The parallel engine folds local_accesses in after the phase.  */
+    if (Sim->parallel)
+        local_accesses++;
+    else
+        Sim->cache_accesses++;
+    stats->accesses->inc ();
+    entry->process_request_processor (request);
+
+    pr = Sim->get_PR (moduleID.nodeID);
+    assert (pr->inbound_request_buf);
+    delete pr->inbound_request_buf;
+    pr->inbound_request_buf = NULL;
+    stats->hits->inc ();
+    return true;
+}
+
+/** Send a prefetch for addr through the line's protocol as if it were a
+ *  LOAD, so it leaves the line in whatever state a demand read would.  */
+void Hash_table::issue_prefetch (paddr_t addr)
+{
+    MAP<paddr_t, Hash_entry*>::iterator it;
+    Hash_entry *entry;
+    Mreq *request;
+
+    addr &= ~((paddr_t)blocksize - 1);
+    it = my_entries.find (addr);
+    if (it != my_entries.end () && it->second->protocol->get_permission () != PERM_INVALID)
+    {
+        prefetch_stats->filtered->inc ();
+        return;
+    }
+
+    if (prefetches_outstanding >= settings.prefetch_max_outstanding)
+    {
+        prefetch_stats->dropped->inc ();
+        return;
+    }
+
+    entry = get_entry (addr);
+    request = new Mreq (LOAD, addr, moduleID);
+    issuing_prefetch = true;
+    entry->process_request_processor (request);
+    issuing_prefetch = false;
+    delete request;
+
+    entry->prefetch_pending = true;
+    prefetches_outstanding++;
+    prefetch_stats->issued->inc ();
+}
+
+/** The bus gave up on the prefetch GETS for addr before granting it.
+ *  Nothing has snooped it, so the line goes back to invalid and the
+ *  outstanding slot is freed.  */
+void Hash_table::cancel_prefetch (paddr_t addr)
+{
+    Hash_entry *entry = get_entry (addr);
+
+    assert (entry->prefetch_pending);
+    assert (entry->protocol->get_permission () == PERM_PENDING);
+    delete entry->protocol;
+    entry->protocol = entry->create_protocol ();
+    entry->prefetch_pending = false;
+    prefetches_outstanding--;
+    prefetch_stats->cancelled->inc ();
+
+    if (Sim->bus->snoop_filter && entry->in_snoop_filter)
+    {
+        Sim->bus->snoop_filter->remove (entry->tag, moduleID.nodeID);
+        entry->in_snoop_filter = false;
+    }
+}
+
+/** The processor withdrew its store to addr, an SC that lost its link,
+ *  before the bus granted it: drop the request and roll the line back, so
+ *  the store neither happens nor takes the line from the core that won.
+ *  False if it has gone too far for that.  */
+bool Hash_table::withdraw_store (paddr_t addr)
+{
+    MAP<paddr_t, Hash_entry*>::iterator it;
+    Hash_entry *entry;
+
+    addr &= ~((paddr_t)blocksize - 1);
+    if (proc_request && proc_request->addr == addr)
+    {
+        delete proc_request;
+        proc_request = NULL;
+        return true;
+    }
+    if (deferred_request && deferred_request->addr == addr)
+    {
+        delete deferred_request;
+        deferred_request = NULL;
+        return true;
+    }
+
+    it = my_entries.find (addr);
+    if (it == my_entries.end () || !Sim->bus->cancel_request (addr, moduleID))
+        return false;
+    entry = it->second;
+    if (!entry->protocol->cancel_store ())
+        fatal_error ("%s: queued request for 0x%llx without a pending store\n",
+                     name, (unsigned long long int)addr);
+
+    if (Sim->bus->snoop_filter)
+    {
+        Sim->bus->snoop_filter->set_state (entry->tag, moduleID.nodeID,
+                                           entry->protocol->get_permission ());
+        if (entry->in_snoop_filter && entry->protocol->get_permission () == PERM_INVALID)
+        {
+            Sim->bus->snoop_filter->remove (entry->tag, moduleID.nodeID);
+            entry->in_snoop_filter = false;
+        }
+    }
+    return true;
+}
+
 /** Request sent from processor.  */
 void Hash_table::processor_request (Mreq *request)
 {
@@ -192,13 +541,74 @@ Hash_entry* Hash_table::get_entry (paddr_t addr)
     return my_entries[addr];
 }
 
+void Hash_table::checkpoint (Checkpoint *ckpt)
+{
+    MAP<paddr_t, Hash_entry*>::iterator it;
+    int num_entries = my_entries.size ();
+    paddr_t tag;
+
+    ckpt->io (num_entries);
+    if (ckpt->saving)
+    {
+        for (it = my_entries.begin (); it != my_entries.end (); it++)
+        {
+            tag = it->first;
+            ckpt->io (tag);
+            it->second->checkpoint (ckpt);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < num_entries; i++)
+        {
+            ckpt->io (tag);
+            get_entry (tag)->checkpoint (ckpt);
+        }
+    }
+
+    ckpt->io_mreq (proc_request);
+    ckpt->io_mreq (deferred_request);
+    ckpt->io (deferred_time);
+    ckpt->io (replay_deferred);
+    ckpt->io (prefetches_outstanding);
+    ckpt->io (issuing_prefetch);
+    ckpt->io (local_accesses);
+}
+
 bool Hash_table::write_to_proc (Mreq *mreq)
 {
 	Processor * pr = (Processor*)Sim->get_PR(moduleID.nodeID);
 	mreq->src_mid = moduleID;
 
+	if (prefetcher)
+	{
+		Hash_entry *entry = get_entry (mreq->addr);
+
+		/** Prefetch fill: keep it in the L1, unless a demand reference is
+		 *  waiting on it, in which case replay that once the state settles.  */
+		if (entry->prefetch_pending)
+		{
+			entry->prefetch_pending = false;
+			prefetches_outstanding--;
+			if (deferred_request && deferred_request->addr == mreq->addr)
+			{
+				replay_deferred = true;
+			}
+			else
+			{
+				entry->prefetched = true;
+				prefetch_stats->unused->inc ();
+			}
+			delete mreq;
+			return true;
+		}
+	}
+
 	assert (!pr->inbound_request_buf);
 
+	if (Sim->checker)
+		Sim->checker->processor_data (moduleID.nodeID, get_entry (mreq->addr), proc_op);
+
 	pr->inbound_request_buf = mreq;
 
 	return true;
@@ -207,6 +617,19 @@ bool Hash_table::write_to_proc (Mreq *mreq)
 bool Hash_table::write_to_bus (Mreq *mreq)
 {
 	mreq->src_mid = moduleID;
+
+	/** Requests (as opposed to DATA replies) always act on behalf of this
+	 *  node's one outstanding processor request, unless they are prefetches.  */
+	if (issuing_prefetch)
+	{
+		mreq->prefetch = true;
+	}
+	else if (mreq->msg != DATA)
+	{
+		mreq->preq = &Sim->get_PR (moduleID.nodeID)->preq;
+		mreq->preq->mark_first (PREQ_BUS_REQUEST);
+	}
+
 	return this->write_output_port(mreq);
 }
 
@@ -4,13 +4,17 @@
 #include <iostream>
 
 #include "module.h"
+#include "prefetcher.h"
 #include "mreq.h"
 #include "settings.h"
+#include "stat_engine.h"
 #include "types.h"
 #include "../protocols/protocol.h"
 
 using namespace std;
 
+class Checkpoint;
+
 /** Individual entry for a hardware hash-like structure. */
 class Hash_entry {
 public:
@@ -22,9 +26,25 @@ public:
 
     Protocol *protocol;
 
+    /** Prefetch GETS in flight / line filled by a prefetch and not yet
+     *  referenced.  */
+    bool prefetch_pending;
+    bool prefetched;
+
+    /** This line is recorded in the bus snoop filter.  */
+    bool in_snoop_filter;
+
+    /** coherence_check: the store number this copy holds, and whether the
+     *  line's BUSUPD has already numbered the processor's store.  */
+    unsigned int data_version;
+    bool update_pending;
+
+    Protocol *create_protocol (void);
     void process_request_snoop (Mreq *request);
     void process_request_processor (Mreq *request);
 
+    void checkpoint (Checkpoint *ckpt);
+
     /** Debug.  */
     void dump ();
 };
@@ -47,6 +67,26 @@ public:
     paddr_t index_mask;
 
     Mreq *proc_request;
+    /** The demand request last handed to a line, for coherence_check.  */
+    message_t proc_op;
+
+    /** Accesses served by tick_local_hit (), folded into
+     *  Sim->cache_accesses by the next serial tick ().  */
+    unsigned long int local_accesses;
+
+    Hash_table_stat_engine *stats;
+
+    /** Prefetching, NULL unless settings.prefetcher is set.  A demand
+     *  reference to a line whose prefetch is in flight is parked in
+     *  deferred_request and replayed when the DATA arrives.  */
+    Prefetcher *prefetcher;
+    Prefetch_stat_engine *prefetch_stats;
+    VECTOR<paddr_t> prefetch_candidates;
+    int prefetches_outstanding;
+    bool issuing_prefetch;
+    Mreq *deferred_request;
+    timestamp_t deferred_time;
+    bool replay_deferred;
 
     /** Table divided into sets which house the individual entries, indexed with index bits.  */
     MAP<paddr_t, Hash_entry*> my_entries;
@@ -54,6 +94,7 @@ public:
 
     /** Internal helper functions.  */
     Hash_entry* get_entry (paddr_t addr);
+    void issue_prefetch (paddr_t addr);
 
 public:
     Hash_table (ModuleID moduleID, const char *name,
@@ -63,12 +104,19 @@ public:
     ~Hash_table (void);
 
     void processor_request (Mreq *request);
+    void cancel_prefetch (paddr_t addr);
+    bool withdraw_store (paddr_t addr);
 
     bool write_to_proc (Mreq *mreq);
     bool write_to_bus (Mreq *mreq);
 
     void tick (void);
     void tock (void);
+    void tick_local_hit (void);
+    Hash_entry *fast_hit_entry (message_t msg, paddr_t addr);
+    bool fast_hit (Mreq *request);
+
+    void checkpoint (Checkpoint *ckpt);
 
     /** Debug.  */
     void print_config (void);
@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "line_state_table.h"
+
+/** Lines tracked before the row index first doubles.  */
+#define LST_LINES (1 << 12)
+
+Line_state_table::Line_state_table (int num_cores)
+    : rows (LST_LINES)
+{
+    assert (num_cores > 0);
+
+    this->num_cores = num_cores;
+    this->row_bytes = (num_cores + 31) & ~31;
+    this->mask_words = (row_bytes + 63) / 64;
+    this->scratch = new mask_t[mask_words];
+}
+
+Line_state_table::~Line_state_table ()
+{
+    delete [] scratch;
+}
+
+unsigned char *Line_state_table::lookup (paddr_t addr)
+{
+    unsigned int *row = rows.lookup (addr);
+
+    return row ? &states[*row] : NULL;
+}
+
+/** Rows start out PERM_INVALID (zero) for every core.  */
+unsigned char *Line_state_table::insert (paddr_t addr)
+{
+    unsigned int *row = rows.lookup (addr);
+
+    if (row)
+        return &states[*row];
+
+    if (rows.full ())
+        rows.resize (2 * rows.size ());
+    *rows.insert (addr) = states.size ();
+    states.resize (states.size () + row_bytes, PERM_INVALID);
+    return &states[states.size () - row_bytes];
+}
+
+perm_t Line_state_table::get (paddr_t addr, int core)
+{
+    unsigned char *row = lookup (addr);
+
+    assert (core < num_cores);
+    return row ? (perm_t)row[core] : PERM_INVALID;
+}
+
+void Line_state_table::set (paddr_t addr, int core, perm_t perm)
+{
+    assert (core < num_cores);
+
+    if (perm == PERM_INVALID)
+    {
+        unsigned char *row = lookup (addr);
+        if (row)
+            row[core] = PERM_INVALID;
+        return;
+    }
+    insert (addr)[core] = perm;
+}
+
+int Line_state_table::cores_in_state (paddr_t addr, perm_t perm, bool match, mask_t *mask)
+{
+    unsigned char *row = lookup (addr);
+    int count = 0;
+
+    memset (mask, 0, mask_words * sizeof (mask_t));
+    if (!row)
+    {
+        /** An untracked line is invalid everywhere.  */
+        if (match != (perm == PERM_INVALID))
+            return 0;
+        for (int c = 0; c < num_cores; c++)
+            mask[c / 64] |= 1ULL << (c % 64);
+        return num_cores;
+    }
+
+#if defined(__AVX2__)
+    __m256i value = _mm256_set1_epi8 ((char)perm);
+    for (int i = 0; i < row_bytes; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256 ((const __m256i *)&row[i]);
+        uint32_t bits = (uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, value));
+        if (!match)
+            bits = ~bits;
+        mask[i / 64] |= (mask_t)bits << (i % 64);
+    }
+#elif defined(__SSE2__)
+    __m128i value = _mm_set1_epi8 ((char)perm);
+    for (int i = 0; i < row_bytes; i += 16)
+    {
+        __m128i v = _mm_loadu_si128 ((const __m128i *)&row[i]);
+        uint32_t bits = (uint32_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (v, value)) & 0xffff;
+        if (!match)
+            bits = ~bits & 0xffff;
+        mask[i / 64] |= (mask_t)bits << (i % 64);
+    }
+#else
+    for (int i = 0; i < row_bytes; i++)
+        if ((row[i] == perm) == match)
+            mask[i / 64] |= 1ULL << (i % 64);
+#endif
+
+    /** Padding bytes are PERM_INVALID; drop them from the mask.  */
+    if (num_cores % 64)
+        mask[num_cores / 64] &= (1ULL << (num_cores % 64)) - 1;
+    for (int w = num_cores / 64 + (num_cores % 64 ? 1 : 0); w < mask_words; w++)
+        mask[w] = 0;
+
+    for (int w = 0; w < mask_words; w++)
+        count += __builtin_popcountll (mask[w]);
+    return count;
+}
+
+int Line_state_table::num_holders (paddr_t addr)
+{
+    return cores_in_state (addr, PERM_INVALID, false, scratch);
+}
+
+bool Line_state_table::any_owner (paddr_t addr)
+{
+    return cores_in_state (addr, PERM_WRITE, true, scratch) != 0;
+}
@@ -0,0 +1,52 @@
+#ifndef LINE_STATE_TABLE_H_
+#define LINE_STATE_TABLE_H_
+
+#include "line_table.h"
+#include "types.h"
+#include "../protocols/protocol.h"
+
+using namespace std;
+
+/**
+ * Global line state table in structure-of-arrays form: one row per line,
+ * each row a contiguous byte vector holding every core's perm_t for that
+ * line.  A row is padded to a multiple of 32 bytes so a whole-row query
+ * (which cores hold the line, how many share it, does anyone own it) is a
+ * handful of SIMD compares and popcounts rather than a walk over every
+ * core's Hash_table.  AVX2 and SSE2 paths are picked at compile time,
+ * with a scalar fallback.  Rows are found through an open-addressed
+ * Line_table that doubles when full, and are never freed.
+ */
+class Line_state_table {
+public:
+    Line_state_table (int num_cores);
+    ~Line_state_table ();
+
+    int num_cores;
+    int row_bytes;
+    int mask_words;
+
+    /** 64-bit words of a core mask; bit c of word c/64 is core c.  */
+    typedef uint64_t mask_t;
+
+    perm_t get (paddr_t addr, int core);
+    void set (paddr_t addr, int core, perm_t perm);
+
+    /** Cores whose state is perm (match) or is not perm (!match).
+     *  Returns the number of cores set in mask.  */
+    int cores_in_state (paddr_t addr, perm_t perm, bool match, mask_t *mask);
+
+    int num_holders (paddr_t addr);
+    bool any_owner (paddr_t addr);
+
+private:
+    /** Offset of each line's row in states.  */
+    Line_table<unsigned int> rows;
+    VECTOR<unsigned char> states;
+    mask_t *scratch;
+
+    unsigned char *lookup (paddr_t addr);
+    unsigned char *insert (paddr_t addr);
+};
+
+#endif // LINE_STATE_TABLE_H_
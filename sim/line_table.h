@@ -0,0 +1,135 @@
+#ifndef LINE_TABLE_H_
+#define LINE_TABLE_H_
+
+#include <assert.h>
+#include <string.h>
+
+#include "types.h"
+
+using namespace std;
+
+/**
+ * Compact open-addressed hash table keyed by (line) address.  Entries are
+ * stored inline in one array, so a lookup is a hash and a short linear
+ * probe with no pointer chasing or per-entry allocation.  The table only
+ * grows through resize(): once max_entries lines are tracked, new lines
+ * are refused and insert() returns NULL.  Entries are never removed.
+ */
+template <class T>
+class Line_table {
+public:
+    Line_table (unsigned int max_entries)
+    {
+        assert (max_entries > 0);
+
+        /** Keep the load factor at or below one half.  */
+        for (capacity = 16; capacity < 2 * max_entries; capacity <<= 1)
+            ;
+
+        this->max_entries = max_entries;
+        this->num_entries = 0;
+        this->tags = new paddr_t[capacity];
+        this->entries = new T[capacity];
+
+        for (unsigned int i = 0; i < capacity; i++)
+            tags[i] = EMPTY_TAG;
+    }
+
+    ~Line_table ()
+    {
+        delete [] tags;
+        delete [] entries;
+    }
+
+    unsigned int size (void) { return num_entries; }
+    bool full (void) { return num_entries >= max_entries; }
+
+    /** Returns the entry for addr, or NULL if it is not tracked.  */
+    T *lookup (paddr_t addr)
+    {
+        unsigned int slot = probe (addr);
+        return (tags[slot] == addr) ? &entries[slot] : NULL;
+    }
+
+    /** Returns the entry for addr, creating a value-initialised one if
+     *  needed.  Returns NULL when the table is full.  */
+    T *insert (paddr_t addr, bool *created = NULL)
+    {
+        unsigned int slot = probe (addr);
+
+        if (created)
+            *created = false;
+
+        if (tags[slot] == addr)
+            return &entries[slot];
+
+        if (full ())
+            return NULL;
+
+        tags[slot] = addr;
+        entries[slot] = T ();
+        num_entries++;
+
+        if (created)
+            *created = true;
+        return &entries[slot];
+    }
+
+    /** Room for max_entries lines, keeping every entry.  Pointers to
+     *  entries do not survive it.  */
+    void resize (unsigned int max_entries)
+    {
+        unsigned int old_capacity = capacity;
+        paddr_t *old_tags = tags;
+        T *old_entries = entries;
+
+        assert (max_entries >= num_entries);
+        for (capacity = 16; capacity < 2 * max_entries; capacity <<= 1)
+            ;
+
+        this->max_entries = max_entries;
+        this->tags = new paddr_t[capacity];
+        this->entries = new T[capacity];
+        for (unsigned int i = 0; i < capacity; i++)
+            tags[i] = EMPTY_TAG;
+
+        for (unsigned int i = 0; i < old_capacity; i++)
+            if (old_tags[i] != EMPTY_TAG)
+            {
+                unsigned int slot = probe (old_tags[i]);
+
+                tags[slot] = old_tags[i];
+                entries[slot] = old_entries[i];
+            }
+        delete [] old_tags;
+        delete [] old_entries;
+    }
+
+    /** Iteration over occupied slots: for (i = 0; i < slots (); i++) if (valid (i)) ... */
+    unsigned int slots (void) { return capacity; }
+    bool valid (unsigned int slot) { return tags[slot] != EMPTY_TAG; }
+    paddr_t tag (unsigned int slot) { return tags[slot]; }
+    T *entry (unsigned int slot) { return &entries[slot]; }
+
+private:
+    static const paddr_t EMPTY_TAG = ~(paddr_t)0;
+
+    unsigned int capacity;
+    unsigned int max_entries;
+    unsigned int num_entries;
+    paddr_t *tags;
+    T *entries;
+
+    unsigned int probe (paddr_t addr)
+    {
+        /** Fibonacci hashing spreads line-aligned addresses well.  */
+        unsigned int slot = (unsigned int)((addr * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+
+        assert (addr != EMPTY_TAG);
+        while (tags[slot] != EMPTY_TAG && tags[slot] != addr)
+            slot = (slot + 1) & (capacity - 1);
+        return slot;
+    }
+};
+
+#endif // LINE_TABLE_H_
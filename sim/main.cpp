@@ -5,6 +5,8 @@
 #include <strings.h>
 #include <unistd.h>
 
+#include "explorer.h"
+#include "regression.h"
 #include "sim.h"
 #include "settings.h"
 
@@ -18,8 +20,15 @@ extern int optind, optopt;
 void usage (void)
 {
     fprintf (stderr, "Usage:\n");
-    fprintf (stderr, "\t-p <protocol> (choices MI, MSI, MESI)\n");
-    fprintf (stderr, "\t-t <trace directory>\n\n");
+    fprintf (stderr, "\t-p <protocol> (choices MI, MSI, MESI, MOSI, MOESI, MOESIF, DRAGON, FIREFLY, HYBRID)\n");
+    fprintf (stderr, "\t-t <trace directory>\n");
+    fprintf (stderr, "\t-n <cores> (without -t, for generated references, e.g. -o ref_source=1 or 2, or -o explore=1)\n");
+    fprintf (stderr, "\t-s <stats file> (machine readable stats report)\n");
+    fprintf (stderr, "\t-f <format> (stats report format: csv, json, cout, cerr, none)\n");
+    fprintf (stderr, "\t-c <checkpoint file> (written at cycle checkpoint_cycle)\n");
+    fprintf (stderr, "\t-r <checkpoint file> (resume from a checkpoint)\n");
+    fprintf (stderr, "\t-v <reference log> (for regression_test, default <trace dir>/<protocol>_validation.txt)\n");
+    fprintf (stderr, "\t-o <name>=<value> (override a setting, may be repeated)\n\n");
 }
 
 int main (int argc, char *argv[])
@@ -27,6 +36,12 @@ int main (int argc, char *argv[])
     int num_nodes = 0;
     char *trace_dir = NULL;
     char *protocol = NULL;
+    char *stats_file = NULL;
+    char *checkpoint_file = NULL;
+    char *restore_file = NULL;
+    char *regression_file = NULL;
+    char *report_format = NULL;
+    VECTOR<char *> options;
     FILE *config_file = NULL;
     char config_path[1000];
     bool debug = false;
@@ -34,7 +49,7 @@ int main (int argc, char *argv[])
     /** Parse command line arguments.  */
     int c;
 
-    while ((c = getopt(argc, argv, "hP:p:t:")) != -1)
+    while ((c = getopt(argc, argv, "hP:p:t:n:s:f:o:c:r:v:")) != -1)
     {
         switch(c)
         {
@@ -51,6 +66,34 @@ int main (int argc, char *argv[])
             trace_dir = strdup (optarg);
             break;
 
+        case 'n':
+            num_nodes = atoi (optarg);
+            break;
+
+        case 's':
+            stats_file = strdup (optarg);
+            break;
+
+        case 'f':
+            report_format = strdup (optarg);
+            break;
+
+        case 'o':
+            options.push_back (strdup (optarg));
+            break;
+
+        case 'c':
+            checkpoint_file = strdup (optarg);
+            break;
+
+        case 'r':
+            restore_file = strdup (optarg);
+            break;
+
+        case 'v':
+            regression_file = strdup (optarg);
+            break;
+
         default:
             fprintf (stderr, "Invalid command line arguments - %c", c);
             usage ();
@@ -58,28 +101,67 @@ int main (int argc, char *argv[])
         }
     }
 
-    sprintf(config_path,"%s/config",trace_dir);
-    config_file = fopen (config_path,"r");
-    if (fscanf(config_file,"%d\n",&num_nodes) != 1)
+    /** The trace directory's config gives the core count; without one,
+     *  -n must.  */
+    if (trace_dir != NULL)
     {
-    	fatal_error("Config File should contain number of traces\n");
+        sprintf(config_path,"%s/config",trace_dir);
+        config_file = fopen (config_path,"r");
+        if (config_file == NULL)
+            fatal_error ("Error: unable to open %s\n", config_path);
+        if (fscanf(config_file,"%d\n",&num_nodes) != 1)
+        {
+            fatal_error("Config File should contain number of traces\n");
+        }
     }
+    else if (num_nodes == 0)
+        fatal_error ("Error: trace file directory not defined!\n");
 
-    if (num_nodes == 0)
+    if (num_nodes <= 0)
         fatal_error ("Error: number of processors is zero.\n");
 
     if (protocol == NULL)
         fatal_error ("Error: invalid protocol specified.\n");
 
-    if (trace_dir == NULL)
-        fatal_error ("Error: trace file directory not defined!\n");
-
 
 
-    /** Init settings.  */
+    /** Init settings: defaults, then the rest of the config file, then
+     *  command line overrides.  */
     settings.set_defaults ();
     settings.num_nodes = num_nodes;
     settings.trace_dir = trace_dir;
+    if (config_file)
+    {
+        settings.get_settings (config_file);
+        fclose (config_file);
+    }
+
+    for (unsigned int i = 0; i < options.size (); i++)
+    {
+        char *value = strchr (options[i], '=');
+        if (value == NULL)
+            fatal_error ("Error: -o expects name=value, got %s\n", options[i]);
+        *value++ = '\0';
+        settings.set_option (options[i], value);
+    }
+    settings.derive_settings ();
+    settings.stats_file = stats_file;
+    settings.checkpoint_file = checkpoint_file;
+    settings.restore_file = restore_file;
+    settings.regression_file = regression_file;
+
+    if (report_format == NULL || !strcmp (report_format, "csv"))
+        settings.report_output = OUTPUT_FMT_CSV;
+    else if (!strcmp (report_format, "json"))
+        settings.report_output = OUTPUT_FMT_JSON;
+    else if (!strcmp (report_format, "cout"))
+        settings.report_output = OUTPUT_FMT_COUT;
+    else if (!strcmp (report_format, "cerr"))
+        settings.report_output = OUTPUT_FMT_CERR;
+    else if (!strcmp (report_format, "none"))
+        settings.report_output = OUTPUT_FMT_NONE;
+    else
+        fatal_error ("Error: invalid stats format %s.\n", report_format);
 
     if (!strcmp(protocol,"MI"))
     {
@@ -105,14 +187,66 @@ int main (int argc, char *argv[])
     {
     	settings.protocol = MOESIF_PRO;
     }
+    else if (!strcmp(protocol,"DRAGON"))
+    {
+    	settings.protocol = DRAGON_PRO;
+    }
+    else if (!strcmp(protocol,"FIREFLY"))
+    {
+    	settings.protocol = FIREFLY_PRO;
+    }
+    else if (!strcmp(protocol,"HYBRID"))
+    {
+    	settings.protocol = HYBRID_PRO;
+    }
     else
     {
     	fatal_error ("Error: invalid protocol specified.\n");
     }
 
+    /** HYBRID always runs with a predictor: a threshold predictor per node
+     *  unless the options chose otherwise.  */
+    if (settings.protocol == HYBRID_PRO)
+    {
+        if (settings.sel_rep_pred == INVALID_PRED)
+            settings.sel_rep_pred = THRESHOLD_PRED;
+        if (settings.sel_rep_pred_scope == INVALID_SCOPE)
+            settings.sel_rep_pred_scope = NODE_SCOPE;
+    }
+
     //TODO: Add MI, MSI, MESI to config; Hardcoded for MI now    
 
+    /** Regression mode compares everything written to stderr from here
+     *  on against the reference log.  */
+    if (settings.regression_test)
+    {
+        if (settings.regression_file == NULL)
+        {
+            if (trace_dir == NULL)
+                fatal_error ("Error: regression_test needs -v or -t\n");
+            settings.regression_file = (char *)malloc (strlen (trace_dir) + strlen (protocol) + 32);
+            sprintf (settings.regression_file, "%s/%s_validation.txt", trace_dir, protocol);
+        }
+        regression_checker = new Regression_checker (settings.regression_file);
+        regression_checker->attach ();
+    }
+
     /** Build simulator.  */
     Sim = new Simulator ();
+    if (settings.restore_file)
+        Sim->restore_checkpoint (settings.restore_file);
     Sim->run ();
+
+    if (regression_checker)
+    {
+        bool passed = regression_checker->finish ();
+
+        delete regression_checker;
+        regression_checker = NULL;
+        return passed ? 0 : 1;
+    }
+
+    if (Sim->explorer && !Sim->explorer->passed ())
+        return 1;
+    return 0;
 }
@@ -1,3 +1,5 @@
+#include "checkpoint.h"
+#include "bus.h"
 #include "memory.h"
 #include "sim.h"
 
@@ -6,14 +8,18 @@ extern Simulator * Sim;
 Memory_controller::Memory_controller(ModuleID moduleID, int hit_time)
 	: Module (moduleID, "MC_")
 {
+	if (hit_time < 1)
+		fatal_error ("Memory_controller: hit time must be at least 1, got %d\n", hit_time);
 	this->hit_time = hit_time;
 	request_in_progress = false;
 	data_time = 0;
 	data_target = (ModuleID){-1,INVALID_M};
+	stats = new Memory_controller_stat_engine ("MC");
 }
 
 Memory_controller::~Memory_controller()
 {
+	delete stats;
 }
 
 void Memory_controller::tick()
@@ -22,26 +28,38 @@ void Memory_controller::tick()
 
     if ((request = read_input_port ()) != NULL)
     {
-		if (request->msg != DATA)
+		if (request->msg == BUSUPD)
+		{
+			/** Updates need no reply; the updating cache ends the
+			 *  transaction itself.  */
+		}
+		else if (request->msg != DATA)
 		{
 			assert (!request_in_progress);
 			request_in_progress = true;
 			data_addr = request->addr;
 			data_target = request->src_mid;
 			data_time = Global_Clock + hit_time;
+			stats->requests->inc ();
 		}
 		else
 		{
+			if (request_in_progress)
+				stats->cancelled->inc ();
 			request_in_progress = false;
 		}
+		delete request;
     }
 
-    if (request_in_progress && Global_Clock >= data_time)
+    /** A cache's reply still waiting for the data bus will cancel this
+     *  one when it is delivered.  */
+    if (request_in_progress && Global_Clock >= data_time && !Sim->bus->data_reply)
     {
     	Mreq * new_request;
     	new_request = new Mreq(DATA,data_addr,moduleID,data_target);
     	request_in_progress = false;
-    	fprintf(stderr,"**** DATA SEND MC -- Clock: %lld\n",Global_Clock);
+    	sim_log ("**** DATA SEND MC -- Clock: %lld\n",(long long int)Global_Clock);
+    	stats->data_sent->inc ();
     	this->write_output_port(new_request);
     }
 }
@@ -51,3 +69,11 @@ void Memory_controller::tock()
     fatal_error ("Memory controller tock should never be called!\n");
 }
 
+
+void Memory_controller::checkpoint (Checkpoint *ckpt)
+{
+	ckpt->io (request_in_progress);
+	ckpt->io (data_time);
+	ckpt->io (data_addr);
+	ckpt->io (data_target);
+}
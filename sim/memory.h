@@ -9,9 +9,12 @@
 #include "module.h"
 #include "mreq.h"
 #include "settings.h"
+#include "stat_engine.h"
 
 using namespace std;
 
+class Checkpoint;
+
 class Memory_controller : public Module
 {
 public:
@@ -25,8 +28,12 @@ public:
     paddr_t data_addr;
     ModuleID data_target;
 
+    Memory_controller_stat_engine *stats;
+
 	void tick();
 	void tock();
+
+	void checkpoint (Checkpoint *ckpt);
 };
 
 #endif /* MEM_MAIN_H_ */
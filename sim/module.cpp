@@ -55,13 +55,13 @@ bool Module::write_output_port (Mreq *mreq)
 void print_id (const char *str, ModuleID mid)
 {
     switch (mid.module_index) {
-    case NI_M: fprintf (stderr, "%4s:%3d/NI  ", str, mid.nodeID); break;
-    case PR_M: fprintf (stderr, "%4s:%3d/PR  ", str, mid.nodeID); break;
-    case L1_M: fprintf (stderr, "%4s:%3d/L1  ", str, mid.nodeID); break;
-    case L2_M: fprintf (stderr, "%4s:%3d/L2  ", str, mid.nodeID); break;
-    case L3_M: fprintf (stderr, "%4s:%3d/L3  ", str, mid.nodeID); break;
-    case MC_M: fprintf (stderr, "%4s:%3d/MC  ", str, mid.nodeID); break;
-    case INVALID_M:  fprintf (stderr, "%4s:  None ", str); break;
+    case NI_M: sim_log ("%4s:%3d/NI  ", str, mid.nodeID); break;
+    case PR_M: sim_log ("%4s:%3d/PR  ", str, mid.nodeID); break;
+    case L1_M: sim_log ("%4s:%3d/L1  ", str, mid.nodeID); break;
+    case L2_M: sim_log ("%4s:%3d/L2  ", str, mid.nodeID); break;
+    case L3_M: sim_log ("%4s:%3d/L3  ", str, mid.nodeID); break;
+    case MC_M: sim_log ("%4s:%3d/MC  ", str, mid.nodeID); break;
+    case INVALID_M:  sim_log ("%4s:  None ", str); break;
     }
 }
 
@@ -23,6 +23,7 @@ Mreq::Mreq (message_t msg, paddr_t addr, ModuleID src_mid, ModuleID dest_mid)
     this->INV_ACK_count = 0;
     this->req_time = Global_Clock;
     this->stalled = false;
+    this->prefetch = false;
     this->preq =NULL;
 }
 
@@ -33,11 +34,13 @@ Mreq::~Mreq(void)
 void Mreq::print_msg (ModuleID mid, const char *add_msg)
 {
     //TODO: convert fprintfs to c++-ishy output
+    if (sim_log_muted)
+        return;
     print_id ("node", mid);
     print_id ("src", src_mid);
     print_id ("dest", dest_mid);
-    fprintf (stderr, "tag: 0x%8llx clock: %8lld ", (long long int)addr>>settings.cache_line_size_log2, Global_Clock);
-    fprintf (stderr, " %8s\n", Mreq::message_t_str[msg]);
+    sim_log ("tag: 0x%8llx clock: %8lld ", (long long int)addr>>settings.cache_line_size_log2, (long long int)Global_Clock);
+    sim_log (" %8s\n", Mreq::message_t_str[msg]);
 }
 
 void Mreq::dump ()
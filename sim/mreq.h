@@ -32,6 +32,7 @@ public:
     int INV_ACK_count;
     timestamp_t req_time;
     bool stalled;
+    bool prefetch;
 
     static const char * message_t_str[MREQ_MESSAGE_NUM];
 
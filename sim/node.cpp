@@ -9,10 +9,16 @@ extern Simulator *Sim;
 
 Node::Node (int nodeID)
 {
+    char name[NAME_ID_CHAR_BUFF];
+
     this->nodeID = nodeID;
+    this->predictor = NULL;
     mod[L1_M] = NULL;
     mod[PR_M] = NULL;
     mod[MC_M] = NULL;
+
+    snprintf (name, sizeof (name), "node%d", nodeID);
+    stats = new Stat_engine (name);
 }
 
 Node::~Node ()
@@ -21,11 +27,14 @@ Node::~Node ()
     for (it = mod.begin (); it != mod.end (); it++)
         delete (it->second);
     mod.clear ();
+
+    delete stats;
 }
 
-void Node::build_processor (char *trace_file)
+void Node::build_processor (Ref_source *source)
 {
     Hash_table *cache;
+    Processor *pr;
 
     mod[L1_M] = cache = new Hash_table ((ModuleID){nodeID, L1_M}, "L1", 
                                         settings.l1_cache_size,
@@ -35,12 +44,19 @@ void Node::build_processor (char *trace_file)
                                         settings.l1_hit_time,
                                         settings.protocol);
 
-    mod[PR_M] = new Processor ((ModuleID){nodeID, PR_M}, cache, trace_file);
+    mod[PR_M] = pr = new Processor ((ModuleID){nodeID, PR_M}, cache, source);
+
+    stats->add_child (pr->stats);
+    stats->add_child (cache->stats);
 }
 
 void Node::build_memory_controller (void)
 {
-	mod[MC_M] = new Memory_controller ((ModuleID){nodeID, MC_M}, 100);
+    Memory_controller *mc;
+
+	mod[MC_M] = mc = new Memory_controller ((ModuleID){nodeID, MC_M}, settings.mem_hit_time);
+
+	stats->add_child (mc->stats);
 }
 
 void Node::tick_cache (void)
@@ -3,11 +3,13 @@
 
 #include "types.h"
 #include "module.h"
+#include "stat_engine.h"
 
 using namespace std;
 
 class Network_interface;
 class Predictor;
+class Ref_source;
 
 class Node
 {
@@ -19,8 +21,9 @@ public:
     ~Node ();
 
     Predictor *predictor;
+    Stat_engine *stats;
 
-    void build_processor (char *trace_file);
+    void build_processor (Ref_source *source);
     void build_memory_controller (void);
     
     void tick_cache (void);
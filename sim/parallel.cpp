@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "hash_table.h"
+#include "parallel.h"
+#include "processor.h"
+#include "settings.h"
+#include "sim.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+/********************************************************************************
+ * Log buffers.
+ ********************************************************************************/
+__thread Sim_log_buffer *sim_log_buffer = NULL;
+
+void Sim_log_buffer::append (const char *fmt, va_list ap)
+{
+    char line[256];
+    va_list copy;
+    int len;
+
+    va_copy (copy, ap);
+    len = vsnprintf (line, sizeof (line), fmt, copy);
+    va_end (copy);
+
+    if (len < (int)sizeof (line))
+    {
+        text.insert (text.end (), line, line + len);
+    }
+    else
+    {
+        size_t old_size = text.size ();
+
+        text.resize (old_size + len + 1);
+        vsnprintf (&text[old_size], len + 1, fmt, ap);
+        text.resize (old_size + len);
+    }
+}
+
+void Sim_log_buffer::flush (FILE *fp)
+{
+    if (text.empty ())
+        return;
+    fwrite (&text[0], 1, text.size (), fp);
+    text.clear ();
+}
+
+/********************************************************************************
+ * Phases.
+ ********************************************************************************/
+static void phase_local_hits (int node)
+{
+    Sim->parallel->l1s[node]->tick_local_hit ();
+}
+
+static void phase_tick_pr (int node)
+{
+    Sim->Nd[node]->tick_pr ();
+}
+
+static void *worker_main (void *arg)
+{
+    Parallel_engine *engine = Sim->parallel;
+    int thread = (int)(intptr_t)arg;
+
+    while (true)
+    {
+        pthread_barrier_wait (&engine->start);
+        if (!engine->phase)
+            break;
+        engine->run_partition (thread);
+        pthread_barrier_wait (&engine->finish);
+    }
+    return NULL;
+}
+
+/********************************************************************************
+ * Engine.
+ ********************************************************************************/
+Parallel_engine::Parallel_engine (int num_threads, int num_nodes)
+{
+    if (settings.sim_analysis_enabled || settings.stack_distance_enabled ||
+        settings.qsets_enabled || settings.sel_rep_pred != INVALID_PRED ||
+        settings.prefetcher != PREFETCH_NONE ||
+        settings.snoop_filter == SNOOP_FILTER_STATE_TABLE || settings.coherence_check)
+        fatal_error ("sim_threads > 1 does not support the analysis, set dueling, "
+                     "predictor, prefetcher, state table or coherence check options\n");
+
+    if (num_threads > num_nodes)
+        num_threads = num_nodes;
+
+    this->num_threads = num_threads;
+    this->num_nodes = num_nodes;
+    this->phase = NULL;
+    this->logs = new Sim_log_buffer[num_nodes + 1];
+    this->threads = new pthread_t[num_threads] ();
+    this->l1s = NULL;
+    this->prs = NULL;
+
+    pthread_barrier_init (&start, NULL, num_threads);
+    pthread_barrier_init (&finish, NULL, num_threads);
+    pthread_mutex_init (&stats_lock, NULL);
+}
+
+Parallel_engine::~Parallel_engine ()
+{
+    if (threads)
+    {
+        phase = NULL;
+        if (num_threads > 1 && threads[1])
+        {
+            pthread_barrier_wait (&start);
+            for (int t = 1; t < num_threads; t++)
+                pthread_join (threads[t], NULL);
+        }
+        delete [] threads;
+    }
+    pthread_barrier_destroy (&start);
+    pthread_barrier_destroy (&finish);
+    pthread_mutex_destroy (&stats_lock);
+    delete [] logs;
+    delete [] l1s;
+    delete [] prs;
+}
+
+void Parallel_engine::run_partition (int thread)
+{
+    for (int node = thread; node < num_nodes; node += num_threads)
+    {
+        sim_log_buffer = &logs[node];
+        phase (node);
+    }
+    sim_log_buffer = NULL;
+}
+
+void Parallel_engine::run_phase (void (*fn) (int node), bool spread)
+{
+    if (num_threads == 1 || !spread)
+    {
+        for (int node = 0; node < num_nodes; node++)
+        {
+            sim_log_buffer = &logs[node];
+            fn (node);
+        }
+        sim_log_buffer = NULL;
+        return;
+    }
+
+    /** Workers start on the first phase, once Sim is set.  */
+    if (!threads[1])
+        for (int t = 1; t < num_threads; t++)
+            if (pthread_create (&threads[t], NULL, worker_main, (void *)(intptr_t)t))
+                fatal_error ("Parallel_engine: unable to create thread %d\n", t);
+
+    phase = fn;
+    pthread_barrier_wait (&start);
+    run_partition (0);
+    pthread_barrier_wait (&finish);
+}
+
+void Parallel_engine::flush_logs (void)
+{
+    for (int i = 0; i <= num_nodes; i++)
+        logs[i].flush (stderr);
+}
+
+/** Fast hits in a phase count their accesses in the L1, see
+ *  Hash_table::fast_hit ().  */
+void Parallel_engine::fold_accesses (void)
+{
+    if (!settings.hit_fast_path)
+        return;
+    for (int i = 0; i < num_nodes; i++)
+    {
+        Sim->cache_accesses += l1s[i]->local_accesses;
+        l1s[i]->local_accesses = 0;
+    }
+}
+
+void Parallel_engine::bind_nodes (void)
+{
+    l1s = new Hash_table *[num_nodes];
+    prs = new Processor *[num_nodes];
+    for (int i = 0; i < num_nodes; i++)
+    {
+        l1s[i] = Sim->get_L1 (i);
+        prs[i] = Sim->get_PR (i);
+    }
+}
+
+void Parallel_engine::run_nodes (void (*fn) (int node), bool spread)
+{
+    if (!l1s)
+        bind_nodes ();
+    run_phase (fn, spread);
+    flush_logs ();
+    fold_accesses ();
+}
+
+void Parallel_engine::cycle (void)
+{
+    int hits = 0;
+    int fetches = 0;
+
+    if (!l1s)
+        bind_nodes ();
+    for (int i = 0; i < num_nodes; i++)
+    {
+        Hash_table *l1 = l1s[i];
+        Processor *pr = prs[i];
+
+        if (l1->proc_request && l1->proc_request->msg == LOAD)
+            hits++;
+        if (pr->inbound_request || (pr->fast_hit_pending && pr->fast_hit_time == Global_Clock) ||
+            (!pr->outstanding_request && !pr->end_of_trace && !pr->hold && !pr->sync_op))
+            fetches++;
+    }
+
+    if (hits)
+        run_phase (phase_local_hits, hits >= num_threads);
+
+    /** Misses and snoops, in node order, appending to each node's log
+     *  after its hit.  */
+    for (int i = 0; i <= num_nodes; i++)
+    {
+        sim_log_buffer = &logs[i];
+        Sim->Nd[i]->tick_cache ();
+    }
+    sim_log_buffer = NULL;
+    flush_logs ();
+
+    run_phase (phase_tick_pr, fetches >= num_threads);
+    flush_logs ();
+    fold_accesses ();
+
+    for (int i = 0; i <= num_nodes; i++)
+        Sim->Nd[i]->tick_mc ();
+
+    for (int i = 0; i <= num_nodes; i++)
+        Sim->Nd[i]->tock_pr ();
+}
@@ -0,0 +1,83 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <pthread.h>
+#include <stdarg.h>
+
+#include "types.h"
+
+using namespace std;
+
+class Hash_table;
+class Processor;
+
+/** Log text one node produced during a cycle phase.  Buffers are flushed
+ *  to stderr in node order, so the log is byte-identical to a
+ *  sequential run.  */
+class Sim_log_buffer {
+public:
+    VECTOR<char> text;
+
+    void append (const char *fmt, va_list ap);
+    void flush (FILE *fp);
+};
+
+/** Where sim_log () writes on this thread; NULL means straight to stderr.  */
+extern __thread Sim_log_buffer *sim_log_buffer;
+
+/**
+ * Conservative parallel engine (sim_threads > 1).  Processor nodes are
+ * dealt round-robin to worker threads.  Within a cycle, the node-local
+ * work runs in parallel: L1 LOAD hits on readable lines and the
+ * processors' trace fetches and completions.  Everything that touches the
+ * bus or another node (misses, snoops, the memory controller) stays
+ * serial and runs in node order, so the simulation is deterministic and
+ * matches sequential mode.  The main thread acts as worker 0.
+ *
+ * A phase costs two barriers, so a cycle's phase runs in parallel only
+ * when every thread has a node with work.  With hit_fast_path the bulk of
+ * the work is instead in the batches of hits each core serves up to the
+ * next cycle the bus could interact with it (Simulator::batch_hits ()),
+ * which span many cycles per phase.
+ */
+class Parallel_engine {
+public:
+    Parallel_engine (int num_threads, int num_nodes);
+    ~Parallel_engine ();
+
+    int num_threads;
+    int num_nodes;
+
+    pthread_t *threads;
+    pthread_barrier_t start;
+    pthread_barrier_t finish;
+    pthread_mutex_t stats_lock;
+
+    /** One per node, including the memory controller node.  */
+    Sim_log_buffer *logs;
+
+    /** Each node's L1 and processor, looked up once the nodes exist.  */
+    Hash_table **l1s;
+    Processor **prs;
+
+    /** Phase the workers run next, NULL to exit.  */
+    void (*phase) (int node);
+
+    /** One cycle after bus->tick ().  */
+    void cycle (void);
+    /** fn on every node outside the cycle, in parallel if spread.  */
+    void run_nodes (void (*fn) (int node), bool spread);
+
+    void lock_stats (void) { pthread_mutex_lock (&stats_lock); }
+    void unlock_stats (void) { pthread_mutex_unlock (&stats_lock); }
+
+    void run_partition (int thread);
+
+private:
+    void run_phase (void (*fn) (int node), bool spread);
+    void flush_logs (void);
+    void fold_accesses (void);
+    void bind_nodes (void);
+};
+
+#endif // PARALLEL_H_
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "node.h"
+#include "predictor.h"
+#include "settings.h"
+#include "sim.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+Predictor::Predictor (const char *name, int threshold, int entries)
+{
+    if (entries <= 0)
+        fatal_error ("Predictor: invalid sel_rep_pred_entries %d\n", entries);
+    if (threshold < 1 || threshold > PREDICTOR_MAX_COUNT)
+        fatal_error ("Predictor: sel_rep_pred_threshold %d is not in 1..%d\n",
+                     threshold, PREDICTOR_MAX_COUNT);
+
+    this->threshold = threshold;
+    this->entries = entries;
+    this->counters = new unsigned char[entries];
+    memset (counters, 0, entries);
+
+    stats = new Stat_engine (name);
+    update_predictions     = stats->add_counter ("update_predictions", "writes predicted to update other copies");
+    invalidate_predictions = stats->add_counter ("invalidate_predictions", "writes predicted to invalidate other copies");
+    trained_update         = stats->add_counter ("trained_update", "counter increments");
+    trained_invalidate     = stats->add_counter ("trained_invalidate", "counter decrements");
+    reread_misses          = stats->add_counter ("reread_misses", "misses on copies our GETMs invalidated");
+    useful_updates         = stats->add_counter ("useful_updates", "updated copies read again (misses avoided)");
+    useless_updates        = stats->add_counter ("useless_updates", "updated copies dropped unread");
+}
+
+Predictor::~Predictor ()
+{
+    delete [] counters;
+    delete stats;
+}
+
+unsigned char *Predictor::counter (paddr_t addr)
+{
+    return &counters[(addr >> settings.cache_line_size_log2) % entries];
+}
+
+bool Predictor::predict_update (paddr_t addr)
+{
+    if (*counter (addr) >= threshold)
+    {
+        update_predictions->inc ();
+        return true;
+    }
+
+    invalidate_predictions->inc ();
+    return false;
+}
+
+void Predictor::invalidation_missed (paddr_t addr)
+{
+    unsigned char *c = counter (addr);
+
+    reread_misses->inc ();
+    if (settings.train_on_loads && *c < PREDICTOR_MAX_COUNT)
+    {
+        (*c)++;
+        trained_update->inc ();
+    }
+}
+
+void Predictor::update_used (paddr_t addr)
+{
+    useful_updates->inc ();
+}
+
+void Predictor::update_dropped (paddr_t addr)
+{
+    unsigned char *c = counter (addr);
+
+    useless_updates->inc ();
+    if (settings.train_on_stores && *c > 0)
+    {
+        (*c)--;
+        trained_invalidate->inc ();
+    }
+}
+
+void Predictor::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->check (entries, "sel_rep_pred_entries");
+    ckpt->io (counters, entries);
+}
+
+void Predictor::build (Node **nodes, int num_nodes, Stat_engine *root,
+                       VECTOR<Predictor *> &predictors)
+{
+    char name[32];
+    int group_size;
+
+    switch (settings.sel_rep_pred) {
+    case INVALID_PRED:
+        return;
+    case THRESHOLD_PRED:
+        break;
+    default:
+        fatal_error ("Predictor: unknown sel_rep_pred %d\n", settings.sel_rep_pred);
+    }
+
+    switch (settings.sel_rep_pred_scope) {
+    case NODE_SCOPE:
+        group_size = 1;
+        break;
+    case NHOOD_SCOPE:
+        if (settings.num_nhoods <= 0 || num_nodes % settings.num_nhoods)
+            fatal_error ("Predictor: num_nhoods (%d) must divide num_nodes (%d)\n",
+                         settings.num_nhoods, num_nodes);
+        group_size = num_nodes / settings.num_nhoods;
+        break;
+    case GLOBAL_SCOPE:
+        group_size = num_nodes;
+        break;
+    default:
+        fatal_error ("Predictor: sel_rep_pred_scope must be node (1), nhood (2) or global (3)\n");
+    }
+
+    for (int node = 0; node < num_nodes; node++)
+    {
+        if (node % group_size == 0)
+        {
+            if (group_size == 1 || group_size == num_nodes)
+                snprintf (name, sizeof (name), "predictor");
+            else
+                snprintf (name, sizeof (name), "predictor_nhood%d", node / group_size);
+
+            predictors.push_back (new Predictor (name, settings.sel_rep_pred_threshold,
+                                                 settings.sel_rep_pred_entries));
+            if (group_size == 1)
+                nodes[node]->stats->add_child (predictors.back ()->stats);
+            else
+                root->add_child (predictors.back ()->stats);
+        }
+        nodes[node]->predictor = predictors.back ();
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef PREDICTOR_H_
+#define PREDICTOR_H_
+
+#include "enums.h"
+#include "types.h"
+#include "stat_engine.h"
+
+using namespace std;
+
+class Checkpoint;
+class Node;
+
+/** Counters saturate at this value (three bits).  */
+#define PREDICTOR_MAX_COUNT 7
+
+/**
+ * Selective replication predictor used by the HYBRID protocol to choose,
+ * per line, whether a write to a shared line should invalidate the other
+ * copies (GETM) or update them in place (BUSUPD).
+ *
+ * The table is untagged and indexed by line number, like a hardware
+ * predictor, so distinct lines may alias.  A line is predicted to want
+ * updates once its counter reaches sel_rep_pred_threshold.  Counters move
+ * up when a reader has to re-fetch a line this node invalidated
+ * (train_on_loads) and down when another cache drops a copy this node
+ * kept updating without ever reading it (train_on_stores).
+ *
+ * Depending on sel_rep_pred_scope a predictor belongs to one node, is
+ * shared by a neighborhood of num_nodes / num_nhoods nodes, or is shared
+ * by all nodes.
+ */
+class Predictor {
+public:
+    Predictor (const char *name, int threshold, int entries);
+    ~Predictor ();
+
+    int threshold;
+    int entries;
+    unsigned char *counters;
+
+    Stat_engine *stats;
+    Stat_counter *update_predictions;
+    Stat_counter *invalidate_predictions;
+    Stat_counter *trained_update;
+    Stat_counter *trained_invalidate;
+    /** Effects of this predictor's decisions on the other caches.  */
+    Stat_counter *reread_misses;
+    Stat_counter *useful_updates;
+    Stat_counter *useless_updates;
+
+    /** True if a write to the shared line addr should be broadcast.  */
+    bool predict_update (paddr_t addr);
+
+    /** A copy this predictor's node invalidated was read again.  */
+    void invalidation_missed (paddr_t addr);
+    /** A copy this predictor's node updated was read before the next update.  */
+    void update_used (paddr_t addr);
+    /** A copy this predictor's node updated was dropped unread.  */
+    void update_dropped (paddr_t addr);
+
+    void checkpoint (Checkpoint *ckpt);
+
+    /** Build the predictors for sel_rep_pred/sel_rep_pred_scope, point
+     *  every processor node at its own and hang their stats under the
+     *  node (node scope) or under root.  The caller frees predictors.  */
+    static void build (Node **nodes, int num_nodes, Stat_engine *root,
+                       VECTOR<Predictor *> &predictors);
+
+private:
+    unsigned char *counter (paddr_t addr);
+};
+
+#endif // PREDICTOR_H_
@@ -0,0 +1,156 @@
+#include <assert.h>
+
+#include "prefetcher.h"
+#include "settings.h"
+#include "sim.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+/********************************************************************************
+ * Prefetcher base.
+ ********************************************************************************/
+Prefetcher::Prefetcher (int degree)
+{
+    if (degree <= 0)
+        fatal_error ("Prefetcher: invalid prefetch_degree %d\n", degree);
+    this->degree = degree;
+}
+
+Prefetcher::~Prefetcher ()
+{
+}
+
+Prefetcher *Prefetcher::create (prefetcher_t type)
+{
+    switch (type) {
+    case PREFETCH_NONE:      return NULL;
+    case PREFETCH_NEXT_LINE: return new Next_line_prefetcher (settings.prefetch_degree);
+    case PREFETCH_STRIDE:    return new Stride_prefetcher (settings.prefetch_degree, settings.prefetch_table_size);
+    case PREFETCH_STREAM:    return new Stream_buffer_prefetcher (settings.prefetch_degree, settings.prefetch_table_size);
+    default:
+        fatal_error ("Prefetcher: unknown prefetcher %d\n", type);
+    }
+}
+
+/********************************************************************************
+ * Next-line prefetcher.
+ ********************************************************************************/
+Next_line_prefetcher::Next_line_prefetcher (int degree)
+    : Prefetcher (degree)
+{
+}
+
+void Next_line_prefetcher::observe (paddr_t addr, paddr_t pc, bool hit, VECTOR<paddr_t> &prefetches)
+{
+    if (hit)
+        return;
+
+    for (int i = 1; i <= degree; i++)
+        prefetches.push_back (addr + i * settings.cache_line_size);
+}
+
+/********************************************************************************
+ * Stride prefetcher.
+ ********************************************************************************/
+Stride_prefetcher::Stride_prefetcher (int degree, int table_size)
+    : Prefetcher (degree)
+{
+    if (table_size <= 0)
+        fatal_error ("Stride_prefetcher: invalid prefetch_table_size %d\n", table_size);
+    this->table_size = table_size;
+    this->table = new Stride_entry[table_size];
+}
+
+Stride_prefetcher::~Stride_prefetcher ()
+{
+    delete [] table;
+}
+
+void Stride_prefetcher::observe (paddr_t addr, paddr_t pc, bool hit, VECTOR<paddr_t> &prefetches)
+{
+    paddr_t tag = pc ? pc : (addr >> 12);
+    Stride_entry *entry = &table[tag % table_size];
+    int64_t stride;
+
+    if (entry->tag != tag)
+    {
+        entry->tag = tag;
+        entry->last_addr = addr;
+        entry->stride = 0;
+        entry->confidence = 0;
+        return;
+    }
+
+    stride = (int64_t)(addr - entry->last_addr);
+    if (stride == 0)
+        return;
+
+    if (stride == entry->stride)
+    {
+        if (entry->confidence < 3)
+            entry->confidence++;
+    }
+    else
+    {
+        entry->stride = stride;
+        entry->confidence = 0;
+    }
+    entry->last_addr = addr;
+
+    if (entry->confidence >= 1)
+        for (int i = 1; i <= degree; i++)
+            prefetches.push_back (addr + i * stride);
+}
+
+/********************************************************************************
+ * Stream buffer prefetcher.
+ ********************************************************************************/
+Stream_buffer_prefetcher::Stream_buffer_prefetcher (int degree, int num_buffers)
+    : Prefetcher (degree)
+{
+    if (num_buffers <= 0)
+        fatal_error ("Stream_buffer_prefetcher: invalid prefetch_table_size %d\n", num_buffers);
+    this->num_buffers = num_buffers;
+    this->buffers = new Stream_buffer[num_buffers];
+}
+
+Stream_buffer_prefetcher::~Stream_buffer_prefetcher ()
+{
+    delete [] buffers;
+}
+
+void Stream_buffer_prefetcher::observe (paddr_t addr, paddr_t pc, bool hit, VECTOR<paddr_t> &prefetches)
+{
+    Stream_buffer *victim;
+
+    /** A hit on a line the buffer brought in consumes it the same way a
+     *  head match would.  */
+    for (int i = 0; i < num_buffers; i++)
+    {
+        Stream_buffer *buf = &buffers[i];
+
+        if (addr == buf->next)
+        {
+            buf->next += settings.cache_line_size;
+            buf->tail += settings.cache_line_size;
+            buf->last_use = Global_Clock;
+            prefetches.push_back (buf->tail);
+            return;
+        }
+    }
+
+    if (hit)
+        return;
+
+    victim = &buffers[0];
+    for (int i = 1; i < num_buffers; i++)
+        if (buffers[i].last_use < victim->last_use)
+            victim = &buffers[i];
+
+    victim->next = addr + settings.cache_line_size;
+    victim->tail = addr + degree * settings.cache_line_size;
+    victim->last_use = Global_Clock;
+    for (int i = 1; i <= degree; i++)
+        prefetches.push_back (addr + i * settings.cache_line_size);
+}
@@ -0,0 +1,84 @@
+#ifndef PREFETCHER_H_
+#define PREFETCHER_H_
+
+#include "enums.h"
+#include "types.h"
+
+using namespace std;
+
+/**
+ * Base class for L1 prefetchers.  The Hash_table shows the prefetcher
+ * every demand reference and issues whatever line addresses it returns
+ * as low-priority GETS through the line's own protocol.
+ */
+class Prefetcher {
+public:
+    Prefetcher (int degree);
+    virtual ~Prefetcher ();
+
+    int degree;
+
+    /** addr is the line address of the reference, pc its PC (0 when the
+     *  trace has none).  Candidates are appended to prefetches.  */
+    virtual void observe (paddr_t addr, paddr_t pc, bool hit,
+                          VECTOR<paddr_t> &prefetches) =0;
+
+    static Prefetcher *create (prefetcher_t type);
+};
+
+/** Prefetch the next degree lines after every miss.  */
+class Next_line_prefetcher : public Prefetcher {
+public:
+    Next_line_prefetcher (int degree);
+
+    void observe (paddr_t addr, paddr_t pc, bool hit, VECTOR<paddr_t> &prefetches);
+};
+
+/** Stride detector indexed by PC, or by 4KB page when the trace carries
+ *  no PCs.  Prefetches once the same stride is seen twice in a row.  */
+class Stride_entry {
+public:
+    Stride_entry () : tag (~(paddr_t)0), last_addr (0), stride (0), confidence (0) {}
+
+    paddr_t tag;
+    paddr_t last_addr;
+    int64_t stride;
+    int confidence;
+};
+
+class Stride_prefetcher : public Prefetcher {
+public:
+    Stride_prefetcher (int degree, int table_size);
+    ~Stride_prefetcher ();
+
+    int table_size;
+    Stride_entry *table;
+
+    void observe (paddr_t addr, paddr_t pc, bool hit, VECTOR<paddr_t> &prefetches);
+};
+
+/** Sequential stream buffers.  A miss that matches the head of a buffer
+ *  advances it and fetches one more line; any other miss (re)allocates
+ *  the least recently used buffer and fetches degree lines ahead.  The
+ *  lines are filled into the L1 rather than held in the buffer.  */
+class Stream_buffer {
+public:
+    Stream_buffer () : next (~(paddr_t)0), tail (0), last_use (0) {}
+
+    paddr_t next;
+    paddr_t tail;
+    timestamp_t last_use;
+};
+
+class Stream_buffer_prefetcher : public Prefetcher {
+public:
+    Stream_buffer_prefetcher (int degree, int num_buffers);
+    ~Stream_buffer_prefetcher ();
+
+    int num_buffers;
+    Stream_buffer *buffers;
+
+    void observe (paddr_t addr, paddr_t pc, bool hit, VECTOR<paddr_t> &prefetches);
+};
+
+#endif // PREFETCHER_H_
@@ -0,0 +1,64 @@
+#ifndef PREQ_H_
+#define PREQ_H_
+
+#include "module.h"
+#include "types.h"
+#include "../protocols/messages.h"
+
+using namespace std;
+
+/** Points in the life of a processor request.  */
+typedef enum {
+    PREQ_ISSUE = 0,        // Processor hands the request to its L1
+    PREQ_BUS_REQUEST,      // L1 queues its first bus request
+    PREQ_BUS_GRANT,        // Bus first broadcasts that request
+    PREQ_SNOOP_RESPONSE,   // A cache or memory posts the DATA reply
+    PREQ_DATA_ARRIVAL,     // DATA reply is broadcast on the bus
+    PREQ_COMPLETE,         // Processor sees the DATA
+    PREQ_EVENT_NUM
+} preq_event_t;
+
+/** Where the cycles of a miss went.  */
+typedef enum {
+    PREQ_LAT_TOTAL = 0,    // ISSUE -> COMPLETE
+    PREQ_LAT_L1,           // ISSUE -> BUS_REQUEST plus DATA_ARRIVAL -> COMPLETE
+    PREQ_LAT_BUS_QUEUE,    // BUS_REQUEST -> BUS_GRANT
+    PREQ_LAT_RESPONSE,     // BUS_GRANT -> SNOOP_RESPONSE (memory or owning cache)
+    PREQ_LAT_TRANSFER,     // SNOOP_RESPONSE -> DATA_ARRIVAL
+    PREQ_LAT_NUM
+} preq_latency_t;
+
+/**
+ * Per-request lifecycle tracker.  Each processor owns one Preq and reuses
+ * it for every reference, so tracking costs a few stores per event and no
+ * allocation.
+ */
+class Preq {
+public:
+    Preq ();
+    ~Preq ();
+
+    ModuleID mid;
+    paddr_t pc;
+    paddr_t addr;
+    message_t msg;
+
+    timestamp_t times[PREQ_EVENT_NUM];
+    unsigned int marked;
+    bool data_from_memory;
+
+    timestamp_t latencies[PREQ_LAT_NUM];
+
+    void reset (ModuleID mid, paddr_t addr, message_t msg);
+    void mark (preq_event_t event);
+    void mark_first (preq_event_t event);
+    bool is_marked (preq_event_t event) { return (marked & (1 << event)) != 0; }
+    bool went_to_bus (void) { return is_marked (PREQ_BUS_GRANT); }
+
+    void calculate_latencies (void);
+
+    /** Debug.  */
+    void dump (void);
+};
+
+#endif // PREQ_H_
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "checkpoint.h"
 #include "hash_table.h"
 #include "processor.h"
 #include "settings.h"
@@ -9,21 +10,37 @@
 using namespace std;
 
 extern Simulator * Sim;
+extern Sim_settings settings;
 
-Processor::Processor (ModuleID moduleID, Hash_table *cache, char *trace_file)
+Processor::Processor (ModuleID moduleID, Hash_table *cache, Ref_source *source)
     : Module (moduleID, "Processor_")
 {
     this->moduleID = moduleID;
-    this->infile = fopen (trace_file, "r");
+    this->source = source;
     this->my_cache = cache;
     this->end_of_trace = false;
+    this->outstanding_request = false;
     this->inbound_request = NULL;
     this->inbound_request_buf = NULL;
+    this->issue_time = 0;
+    this->op = 'r';
+    this->linked = false;
+    this->link_line = 0;
+    this->sync_op = 0;
+    this->sync_addr = 0;
+    this->sync_time = 0;
+    this->sync_granted = false;
+    this->fast_hit_pending = false;
+    this->fast_hit_time = 0;
+    this->ahead_end = false;
+    this->hold = false;
+    this->stats = new Processor_stat_engine ("PR");
 }
 
 Processor::~Processor ()
 {
-    fclose (this->infile);
+    delete source;
+    delete stats;
 }
 
 /** Done once at end of trace and no outstanding requests.  */
@@ -37,37 +54,276 @@ void Processor::tick ()
     char c;
     paddr_t addr;
 
-    if (inbound_request)
+    if (inbound_request || (fast_hit_pending && Global_Clock == fast_hit_time))
     {
-    	fprintf(stderr,"* COMPLETE -- PR: %d -- Clock: %lld\n",moduleID.nodeID, Global_Clock);
-    	assert (inbound_request->msg == DATA);
-    	outstanding_request = false;
+    	assert (!inbound_request || inbound_request->msg == DATA);
+    	complete_request (Global_Clock);
         delete inbound_request;
     }
     inbound_request = NULL;
 
-    if (end_of_trace || outstanding_request)
+    /** A fast hit's stall was counted when it was served.  */
+    if (outstanding_request && !fast_hit_pending)
+        stats->stall_cycles->inc ();
+    if (sync_op)
+        stats->sync_wait_cycles->inc ();
+
+    if (end_of_trace || outstanding_request || hold || sync_op)
         return;
 
-    if (fscanf (infile, "%c 0x%llx\n", &c, (unsigned long long int*)&addr) == 2)
+    if (sync_granted || read_reference (&c, &addr))
     {
         Mreq *request;
 
-        fprintf (stderr,"* FETCH -- PR: %d -- Clock: %lld -- %c 0x%llx\n", moduleID.nodeID, Global_Clock, c, (unsigned long long int)addr);
+        if (sync_granted)
+        {
+            sync_granted = false;
+            c = 'a';
+            addr = sync_addr;
+        }
+
+        sim_log ("* FETCH -- PR: %d -- Clock: %lld -- %c 0x%llx\n", moduleID.nodeID, (long long int)Global_Clock, c, (unsigned long long int)addr);
+
+        /** Wait for Sync_tracker::end_cycle () to open the barrier or
+         *  grant the lock.  */
+        if (c == 'b' || c == 'k')
+        {
+            sync_op = c;
+            sync_addr = addr;
+            sync_time = Global_Clock;
+            return;
+        }
+
+        if (settings.sesc_disable_llsc && (c == 'l' || c == 's'))
+            c = (c == 'l') ? 'r' : 'w';
+        if (op_message (c) == LOAD)
+            stats->loads->inc ();
+        else
+            stats->stores->inc ();
 
+        op = c;
         switch (c) {
-        case 'r': request = new Mreq (LOAD, addr, moduleID); break;
-        case 'w': request = new Mreq (STORE, addr, moduleID); break;
-        default:
-            fatal_error ("Processor %d: unknown operation - %c", moduleID.nodeID, c);
+        case 'a': stats->atomics->inc (); break;
+        case 'l': stats->load_links->inc (); break;
+        case 's':
+            stats->store_conditionals->inc ();
+            /** Without its link an SC fails at once, with no bus traffic.  */
+            if (!linked || link_line != (addr & ~((paddr_t)settings.cache_line_size - 1)))
+            {
+                sim_log ("* SC FAIL -- PR: %d -- Clock: %lld\n", moduleID.nodeID, (long long int)Global_Clock);
+                stats->sc_failures->inc ();
+                linked = false;
+                return;
+            }
+            break;
         }
-        
-        my_cache->proc_request =  request;
+        request = new Mreq (op_message (c), addr, moduleID);
+
+        preq.reset (moduleID, addr, request->msg);
+        preq.mark (PREQ_ISSUE);
+        request->preq = &preq;
+
         outstanding_request = true;
+        issue_time = Global_Clock;
+
+        /** A hit normally reaches the L1 next cycle and its DATA the
+         *  processor the cycle after.  */
+        if (settings.hit_fast_path && my_cache->fast_hit (request))
+        {
+            delete request;
+            fast_hit_pending = true;
+            fast_hit_time = Global_Clock + 2;
+            stats->stall_cycles->inc ();
+        }
+        else
+            my_cache->proc_request =  request;
     }
-    else
+}
+
+void Processor::complete_request (timestamp_t now)
+{
+    sim_log ("* COMPLETE -- PR: %d -- Clock: %lld\n", moduleID.nodeID, (long long int)now);
+    outstanding_request = false;
+    fast_hit_pending = false;
+    stats->request_latency->add (now - issue_time);
+
+    preq.mark (PREQ_COMPLETE);
+    if (preq.went_to_bus ())
     {
-        end_of_trace = true;
+        if (Sim->parallel)
+            Sim->parallel->lock_stats ();
+        Sim->stat_manager->miss_latency->record (&preq);
+        if (Sim->parallel)
+            Sim->parallel->unlock_stats ();
+    }
+    /** A plain store can only be a lock release on a line this core has
+     *  synchronized on.  */
+    if (op == 'r' || (op == 'w' &&
+        !sync_lines.count (preq.addr & ~((paddr_t)settings.cache_line_size - 1))))
+        return;
+    complete_sync ();
+}
+
+message_t Processor::op_message (char op)
+{
+    switch (op) {
+    case 'r':
+    case 'l':
+        return LOAD;
+    case 'w':
+    case 'a':
+    case 's':
+    case 'k':
+    case 'u':
+        return STORE;
+    default:
+        fatal_error ("Processor: unknown operation - %c\n", op);
+    }
+}
+
+void Processor::break_link (paddr_t addr)
+{
+    if (!linked || link_line != (addr & ~((paddr_t)settings.cache_line_size - 1)))
+        return;
+    if (outstanding_request && op == 's')
+    {
+        /** An SC the L1 has served, or whose own bus transaction went
+         *  first, has already won.  */
+        if (fast_hit_pending || inbound_request || inbound_request_buf ||
+            preq.is_marked (PREQ_BUS_GRANT))
+            return;
+        linked = false;
+        /** Otherwise it fails now, without its store.  */
+        if (my_cache->withdraw_store (addr))
+            complete_request (Global_Clock);
+        return;
+    }
+    linked = false;
+}
+
+/** A completed LL sets the link and an SC uses it up; an SC that lost it
+ *  while waiting for the bus failed, without writing.  Other writes feed
+ *  the hand-off stats, and a lock release frees the lock.  */
+void Processor::complete_sync (void)
+{
+    paddr_t line = preq.addr & ~((paddr_t)settings.cache_line_size - 1);
+    bool atomic = (op == 'a' || op == 's');
+
+    sync_lines.insert (line);
+    if (op == 'l')
+    {
+        linked = true;
+        link_line = line;
+        return;
+    }
+    if (op == 's')
+    {
+        if (!linked)
+        {
+            stats->sc_failures->inc ();
+            return;
+        }
+        linked = false;
+    }
+
+    if (Sim->parallel)
+        Sim->parallel->lock_stats ();
+    Sim->sync_tracker->write (moduleID.nodeID, line, atomic);
+    if (op == 'u')
+        Sim->sync_tracker->unlock (moduleID.nodeID, preq.addr);
+    if (Sim->parallel)
+        Sim->parallel->unlock_stats ();
+}
+
+/** Next trace reference; false, and end_of_trace, once the trace is done.  */
+bool Processor::read_reference (char *c, paddr_t *addr)
+{
+    if (!ahead_ops.empty ())
+    {
+        *c = ahead_ops.front ();
+        *addr = ahead_addrs.front ();
+        ahead_ops.pop_front ();
+        ahead_addrs.pop_front ();
+        return true;
+    }
+    if (!ahead_end && source->next (c, addr))
+        return true;
+    end_of_trace = true;
+    return false;
+}
+
+/** Only r and w, with no sync operation due; the L1 state cannot change
+ *  under a run of hits, so each is checked against it as it is now.  */
+int Processor::hit_run (int limit)
+{
+    int run = 0;
+
+    if (sync_granted)
+        return 0;
+
+    for (run = 0; run < limit; run++)
+    {
+        char c;
+        paddr_t addr;
+
+        if (run == (int)ahead_ops.size ())
+        {
+            if (ahead_end)
+                break;
+            if (!source->next (&c, &addr))
+            {
+                ahead_end = true;
+                break;
+            }
+            ahead_ops.push_back (c);
+            ahead_addrs.push_back (addr);
+        }
+        c = ahead_ops[run];
+        if ((c != 'r' && c != 'w') ||
+            !my_cache->fast_hit_entry (op_message (c), ahead_addrs[run]))
+            break;
+    }
+    return run;
+}
+
+/** Each hit is accounted as the normal path would: fetched at t, a stall
+ *  cycle at t + 1 and completed at t + 2, when the next is fetched.  A fast
+ *  hit still pending completes at start.  */
+void Processor::retire_hits (timestamp_t start, int count)
+{
+    timestamp_t now = start;
+
+    for (int i = 0; i < count; i++, now += 2)
+    {
+        Mreq *request;
+        char c;
+        paddr_t addr;
+        bool hit;
+
+        if (fast_hit_pending)
+            complete_request (now);
+        read_reference (&c, &addr);
+        sim_log ("* FETCH -- PR: %d -- Clock: %lld -- %c 0x%llx\n", moduleID.nodeID, (long long int)now, c, (unsigned long long int)addr);
+
+        if (c == 'r')
+            stats->loads->inc ();
+        else
+            stats->stores->inc ();
+        op = c;
+        request = new Mreq (op_message (c), addr, moduleID);
+        preq.reset (moduleID, addr, request->msg);
+        preq.mark (PREQ_ISSUE);
+        request->preq = &preq;
+
+        hit = my_cache->fast_hit (request);
+        assert (hit);
+        delete request;
+
+        outstanding_request = true;
+        issue_time = now;
+        fast_hit_pending = true;
+        fast_hit_time = now + 2;
+        stats->stall_cycles->inc ();
     }
 }
 
@@ -80,3 +336,59 @@ void Processor::tock ()
 	}
 }
 
+static void checkpoint_lines (Checkpoint *ckpt, SET<paddr_t> &lines)
+{
+    SET<paddr_t>::iterator it;
+    int size = lines.size ();
+    paddr_t line;
+
+    ckpt->io (size);
+    if (ckpt->saving)
+        for (it = lines.begin (); it != lines.end (); it++)
+        {
+            line = *it;
+            ckpt->io (line);
+        }
+    else
+        for (int i = 0; i < size; i++)
+        {
+            ckpt->io (line);
+            lines.insert (line);
+        }
+}
+
+template <class T> static void checkpoint_ahead (Checkpoint *ckpt, DEQUE<T> &queue)
+{
+    int size = queue.size ();
+
+    ckpt->io (size);
+    if (!ckpt->saving)
+        queue.resize (size);
+    for (int i = 0; i < size; i++)
+        ckpt->io (queue[i]);
+}
+
+void Processor::checkpoint (Checkpoint *ckpt)
+{
+    source->checkpoint (ckpt);
+    ckpt->io (end_of_trace);
+    ckpt->io (outstanding_request);
+    ckpt->io_mreq (inbound_request);
+    ckpt->io_mreq (inbound_request_buf);
+    ckpt->io (issue_time);
+    /** Preq holds no pointers.  */
+    ckpt->io (preq);
+    ckpt->io (op);
+    ckpt->io (linked);
+    ckpt->io (link_line);
+    checkpoint_lines (ckpt, sync_lines);
+    ckpt->io (sync_op);
+    ckpt->io (sync_addr);
+    ckpt->io (sync_time);
+    ckpt->io (sync_granted);
+    ckpt->io (fast_hit_pending);
+    ckpt->io (fast_hit_time);
+    checkpoint_ahead (ckpt, ahead_ops);
+    checkpoint_ahead (ckpt, ahead_addrs);
+    ckpt->io (ahead_end);
+}
@@ -1,24 +1,29 @@
 #ifndef PROCESSOR_H
 #define PROCESSOR_H
 
+#include <deque>
 #include <fstream>
 #include <iostream>
 
 #include "module.h"
 #include "mreq.h"
+#include "preq.h"
+#include "ref_source.h"
 #include "settings.h"
+#include "stat_engine.h"
 #include "types.h"
 
 using namespace std;
 
+class Checkpoint;
 class Hash_table;
 
 class Processor : public Module {
 public:
-	Processor(ModuleID moduleID, Hash_table *cache, char *trace_file);
+	Processor(ModuleID moduleID, Hash_table *cache, Ref_source *source);
 	~Processor();
 
-    FILE *infile;
+    Ref_source *source;
     Hash_table *my_cache;
 
     bool end_of_trace;
@@ -27,10 +32,70 @@ public:
     Mreq * inbound_request;
     Mreq * inbound_request_buf;
 
+    timestamp_t issue_time;
+    Preq preq;
+    /** Trace operation of the last reference, one of TRACE_OPS.  */
+    char op;
+
+    /** Load-linked reservation on link_line, broken by an SC, a write by
+     *  another core or the loss of the line.  */
+    bool linked;
+    paddr_t link_line;
+
+    /** Lines this core has used for an atomic, LL/SC or lock.  Only a
+     *  plain store to one of them can be a lock release, so only those
+     *  reach the Sync_tracker.  */
+    SET<paddr_t> sync_lines;
+
+    /** Blocked at barrier ('b') or lock ('k') sync_addr since sync_time,
+     *  0 while running; see Sync_tracker.  A granted lock is taken with an
+     *  atomic before the trace goes on.  */
+    char sync_op;
+    paddr_t sync_addr;
+    timestamp_t sync_time;
+    bool sync_granted;
+
+    /** hit_fast_path: the L1 already served the outstanding request, which
+     *  completes at fast_hit_time as if its DATA had come back.  */
+    bool fast_hit_pending;
+    timestamp_t fast_hit_time;
+
+    /** hit_fast_path: references hit_run () has read ahead of the trace,
+     *  oldest first, which read_reference () hands out before the
+     *  source's own, and whether the trace ended after them.  */
+    DEQUE<char> ahead_ops;
+    DEQUE<paddr_t> ahead_addrs;
+    bool ahead_end;
+
+    /** Sampling: stop fetching so the pipeline drains.  */
+    bool hold;
+
+    Processor_stat_engine *stats;
+
     bool done ();
 
 	void tick ();
 	void tock ();
+
+    bool read_reference (char *c, paddr_t *addr);
+    /** The request completes at now, from its DATA or as a fast hit.  */
+    void complete_request (timestamp_t now);
+
+    /** The number, at most limit, of plain references next in the trace
+     *  that the L1 would serve as fast hits right now.  */
+    int hit_run (int limit);
+    /** Serve the next count references, found by hit_run (), one every two
+     *  cycles from start as the normal path would.  */
+    void retire_hits (timestamp_t start, int count);
+    /** The L1 request for a trace operation: LOAD for r and l, STORE for
+     *  w, a, s, k and u.  */
+    static message_t op_message (char op);
+
+    /** A write by another core, or a snoop that left the line invalid.  */
+    void break_link (paddr_t addr);
+    void complete_sync (void);
+
+	void checkpoint (Checkpoint *ckpt);
 };
 
 #endif // PROCESSOR_H
@@ -0,0 +1,279 @@
+#include <assert.h>
+
+#include "checkpoint.h"
+#include "ref_source.h"
+#include "settings.h"
+#include "sim.h"
+#include "trace_recorder.h"
+
+extern Sim_settings settings;
+
+/** First line of the stress address set.  */
+#define STRESS_BASE_ADDR 0x10000
+
+/** Synthetic workload layout: the shared lines, then one private region
+ *  per core, each SYNTH_REGION_SIZE bytes.  */
+#define SYNTH_SHARED_BASE 0x10000000ULL
+#define SYNTH_PRIVATE_BASE 0x20000000ULL
+#define SYNTH_REGION_SIZE 0x4000000ULL
+#define SYNTH_WORD_SIZE 8
+
+Ref_source *Ref_source::create (int node)
+{
+    char trace_file[1000];
+
+    /** The state explorer issues the references itself.  */
+    if (settings.explore)
+        return NULL;
+
+    switch (settings.ref_source) {
+    case REF_SOURCE_TRACE:
+        if (settings.trace_dir == NULL)
+            fatal_error ("Ref_source: trace references need a trace directory (-t)\n");
+        sprintf (trace_file, "%s/p%d.trace", settings.trace_dir, node);
+        return new Trace_ref_source (trace_file);
+    case REF_SOURCE_STRESS:
+        return new Stress_ref_source (node);
+    case REF_SOURCE_SYNTHETIC:
+        return new Synthetic_ref_source (node);
+    default:
+        fatal_error ("Ref_source: unknown reference source %d\n", settings.ref_source);
+    }
+}
+
+/********************************************************************************
+ * Trace files.
+ ********************************************************************************/
+Trace_ref_source::Trace_ref_source (const char *trace_file)
+{
+    char magic[TRACE_BINARY_MAGIC_SIZE];
+
+    infile = fopen (trace_file, "rb");
+    if (!infile)
+        fatal_error ("Ref_source: unable to open trace %s\n", trace_file);
+
+    binary = fread (magic, TRACE_BINARY_MAGIC_SIZE, 1, infile) == 1
+        && !memcmp (magic, TRACE_BINARY_MAGIC, TRACE_BINARY_MAGIC_SIZE);
+    if (!binary)
+        rewind (infile);
+}
+
+Trace_ref_source::~Trace_ref_source ()
+{
+    fclose (infile);
+}
+
+bool Trace_ref_source::next (char *op, paddr_t *addr)
+{
+    unsigned char record[TRACE_RECORD_SIZE];
+
+    if (binary)
+    {
+        if (fread (record, TRACE_RECORD_SIZE, 1, infile) != 1)
+            return false;
+        *addr = trace_record_decode (record, op);
+        return true;
+    }
+    return fscanf (infile, "%c 0x%llx\n", op, (unsigned long long int*)addr) == 2;
+}
+
+void Trace_ref_source::checkpoint (Checkpoint *ckpt)
+{
+    long offset = ftell (infile);
+
+    ckpt->io (offset);
+    if (!ckpt->saving && fseek (infile, offset, SEEK_SET))
+        fatal_error ("Ref_source: unable to seek trace to %ld\n", offset);
+}
+
+/********************************************************************************
+ * Random streams.
+ ********************************************************************************/
+/** splitmix64 of the seed, so nearby seeds give unrelated streams and the
+ *  state is never zero.  */
+Ref_rng::Ref_rng (uint64_t seed)
+{
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    state = (z ^ (z >> 31)) | 1;
+}
+
+Stress_ref_source::Stress_ref_source (int node)
+    : rng (((uint64_t)settings.stress_seed << 16) + node)
+{
+    if (settings.stress_lines <= 0 || settings.stress_store_pct < 0 || settings.stress_store_pct > 100)
+        fatal_error ("Ref_source: invalid stress_lines %d or stress_store_pct %d\n",
+                     settings.stress_lines, settings.stress_store_pct);
+    remaining = settings.stress_refs;
+}
+
+bool Stress_ref_source::next (char *op, paddr_t *addr)
+{
+    if (remaining <= 0)
+        return false;
+    remaining--;
+
+    *op = ((int)rng.below (100) < settings.stress_store_pct) ? 'w' : 'r';
+    *addr = STRESS_BASE_ADDR + (paddr_t)rng.below (settings.stress_lines) * settings.cache_line_size;
+    return true;
+}
+
+void Stress_ref_source::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (rng.state);
+    ckpt->io (remaining);
+}
+
+/********************************************************************************
+ * Synthetic workloads.
+ ********************************************************************************/
+Synthetic_ref_source::Synthetic_ref_source (int node)
+    : node (node), rng (((uint64_t)settings.synth_seed << 16) + node)
+{
+    /** Producer-consumer buffers take num_nodes regions' worth of shared
+     *  lines, private streaming two arrays, the lock one extra line.  */
+    unsigned long long int span = (unsigned long long int)(settings.synth_lines + 1)
+        * settings.cache_line_size * (settings.num_nodes > 2 ? settings.num_nodes : 2);
+
+    if (settings.synth_pattern < SYNTH_PRIVATE || settings.synth_pattern > SYNTH_FALSE_SHARING)
+        fatal_error ("Ref_source: unknown synth_pattern %d\n", settings.synth_pattern);
+    if (settings.synth_lines <= 0 || span > SYNTH_REGION_SIZE)
+        fatal_error ("Ref_source: synth_lines %d must be positive and fit %lld bytes\n",
+                     settings.synth_lines, (long long int)SYNTH_REGION_SIZE);
+    if (settings.synth_store_pct < 0 || settings.synth_store_pct > 100)
+        fatal_error ("Ref_source: invalid synth_store_pct %d\n", settings.synth_store_pct);
+
+    remaining = settings.synth_refs;
+    cursor = 0;
+    burst_size = 0;
+    burst_pos = 0;
+}
+
+paddr_t Synthetic_ref_source::shared (unsigned int line, unsigned int word)
+{
+    return SYNTH_SHARED_BASE + (paddr_t)line * settings.cache_line_size + word * SYNTH_WORD_SIZE;
+}
+
+paddr_t Synthetic_ref_source::priv (unsigned int line, unsigned int word)
+{
+    return SYNTH_PRIVATE_BASE + node * SYNTH_REGION_SIZE
+        + (paddr_t)line * settings.cache_line_size + word * SYNTH_WORD_SIZE;
+}
+
+void Synthetic_ref_source::add (char op, paddr_t addr)
+{
+    assert (burst_size < SYNTH_MAX_BURST);
+    burst_op[burst_size] = op;
+    burst_addr[burst_size] = addr;
+    burst_size++;
+}
+
+/** Generate the next step of the pattern.  */
+void Synthetic_ref_source::refill (void)
+{
+    unsigned int lines = settings.synth_lines;
+    unsigned int words = settings.cache_line_size / SYNTH_WORD_SIZE;
+    unsigned int line, word, n;
+
+    if (words == 0)
+        words = 1;
+
+    burst_size = 0;
+    burst_pos = 0;
+    switch (settings.synth_pattern) {
+    case SYNTH_PRIVATE:
+        /** dst[i] = src[i]; dst follows src in the region.  */
+        for (int i = 0; i < SYNTH_MAX_BURST / 2; i++, cursor++)
+        {
+            line = (cursor / words) % lines;
+            word = cursor % words;
+            add ('r', priv (line, word));
+            add ('w', priv (lines + line, word));
+        }
+        return;
+
+    case SYNTH_MIGRATORY:
+        line = rng.below (lines);
+        for (word = 0; word < 2 && word < words; word++)
+        {
+            add ('r', shared (line, word));
+            add ('w', shared (line, word));
+        }
+        break;
+
+    case SYNTH_PRODUCER_CONSUMER:
+        /** Buffer n holds lines n * lines to (n + 1) * lines - 1.  */
+        line = cursor % lines;
+        n = (node + settings.num_nodes - 1) % settings.num_nodes;
+        for (word = 0; word < words && word < SYNTH_MAX_BURST / 2; word++)
+            add ('w', shared (node * lines + line, word));
+        for (word = 0; word < words && word < SYNTH_MAX_BURST / 2; word++)
+            add ('r', shared (n * lines + line, word));
+        break;
+
+    case SYNTH_READ_MOSTLY:
+        for (int i = 0; i < SYNTH_MAX_BURST / 2; i++)
+            add (((int)rng.below (100) < settings.synth_store_pct) ? 'w' : 'r',
+                 shared (rng.below (lines), rng.below (words)));
+        break;
+
+    case SYNTH_LOCK:
+        /** Line 0 is the lock, lines 1 to lines the data it protects.  */
+        n = 1 + rng.below (4);
+        for (unsigned int i = 0; i < n; i++)
+            add ('r', shared (0, 0));
+        add ('a', shared (0, 0));
+        for (int i = 0; i < 2; i++)
+        {
+            line = 1 + rng.below (lines);
+            add ('r', shared (line, 0));
+            add ('w', shared (line, 0));
+        }
+        add ('w', shared (0, 0));
+        n = 1 + rng.below (4);
+        for (unsigned int i = 0; i < n; i++)
+            add ('r', priv (rng.below (lines), rng.below (words)));
+        break;
+
+    case SYNTH_FALSE_SHARING:
+        word = node % words;
+        for (int i = 0; i < SYNTH_MAX_BURST / 4; i++)
+        {
+            line = rng.below (lines);
+            add ('r', shared (line, word));
+            add ('w', shared (line, word));
+        }
+        break;
+
+    default:
+        fatal_error ("Ref_source: unknown synth_pattern %d\n", settings.synth_pattern);
+    }
+    cursor++;
+}
+
+bool Synthetic_ref_source::next (char *op, paddr_t *addr)
+{
+    if (remaining <= 0)
+        return false;
+    remaining--;
+
+    if (burst_pos == burst_size)
+        refill ();
+    *op = burst_op[burst_pos];
+    *addr = burst_addr[burst_pos];
+    burst_pos++;
+    return true;
+}
+
+void Synthetic_ref_source::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (rng.state);
+    ckpt->io (remaining);
+    ckpt->io (cursor);
+    ckpt->io (burst_size);
+    ckpt->io (burst_pos);
+    ckpt->io (burst_op, sizeof (burst_op));
+    ckpt->io (burst_addr, sizeof (burst_addr));
+}
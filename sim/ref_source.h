@@ -0,0 +1,138 @@
+#ifndef REF_SOURCE_H_
+#define REF_SOURCE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "enums.h"
+#include "types.h"
+
+using namespace std;
+
+class Checkpoint;
+
+/**
+ * Where a processor's references come from.  next () returns the trace
+ * operation character (one of TRACE_OPS, see trace_recorder.h) and the
+ * address, or false once the stream is done.  Sources must be
+ * deterministic so runs, and checkpoints, reproduce.
+ */
+class Ref_source {
+public:
+    virtual ~Ref_source () {}
+
+    virtual bool next (char *op, paddr_t *addr) =0;
+    virtual void checkpoint (Checkpoint *ckpt) =0;
+
+    /** The source settings.ref_source selects for node, NULL when the
+     *  state explorer (explore) drives the caches instead.  */
+    static Ref_source *create (int node);
+};
+
+/** <trace_dir>/p<node>.trace, one "<op> 0x..." per line, or the binary
+ *  records of trace_recorder.h.  */
+class Trace_ref_source : public Ref_source {
+public:
+    Trace_ref_source (const char *trace_file);
+    ~Trace_ref_source ();
+
+    FILE *infile;
+    bool binary;
+
+    bool next (char *op, paddr_t *addr);
+    /** The trace is saved as a file offset, so a restored run must read
+     *  the same trace files.  */
+    void checkpoint (Checkpoint *ckpt);
+};
+
+/** Small, fast, seedable generator (xorshift64*), so a seed replays the
+ *  same streams on any host.  */
+class Ref_rng {
+public:
+    Ref_rng (uint64_t seed = 1);
+
+    uint64_t state;
+
+    uint64_t next (void)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    /** Uniform in [0, n).  */
+    unsigned int below (unsigned int n) { return (unsigned int)((next () >> 32) * n >> 32); }
+};
+
+/**
+ * Stress test stream: stress_refs references to stress_lines lines
+ * shared by every core, stress_store_pct percent of them stores.  The
+ * tiny, contended address set keeps lines bouncing through the transient
+ * states.  Each core's stream depends only on stress_seed and the node.
+ */
+class Stress_ref_source : public Ref_source {
+public:
+    Stress_ref_source (int node);
+
+    Ref_rng rng;
+    long long int remaining;
+
+    bool next (char *op, paddr_t *addr);
+    void checkpoint (Checkpoint *ckpt);
+};
+
+/** Most references one step of a synthetic pattern produces.  */
+#define SYNTH_MAX_BURST 16
+
+/**
+ * Synthetic workload (ref_source=2): synth_refs references per core in
+ * one of the synth_pattern sharing patterns, generated on the fly so
+ * long runs need no trace files.  Each step of the pattern is a burst of
+ * references, returned one by one:
+ *
+ *  private streaming   copy between two private arrays of synth_lines
+ *                      lines, word by word
+ *  migratory           read then write two words of a random shared
+ *                      record, so records move from core to core
+ *  producer-consumer   write a line of the core's own buffer, then read
+ *                      the same line of the previous core's buffer
+ *  read-mostly         random words of synth_lines shared lines,
+ *                      synth_store_pct percent of them stores
+ *  lock contention     spin on a shared lock line, take it with an
+ *                      atomic, update two lines it protects, release it
+ *                      with a store, do private work
+ *  false sharing       read and write the core's own word of shared
+ *                      lines (cores beyond the words in a line share)
+ *
+ * Streams are deterministic in synth_seed and the node.  There is no
+ * synchronization: the lock is only a reference pattern, and consumers
+ * read whatever their producer has reached.
+ */
+class Synthetic_ref_source : public Ref_source {
+public:
+    Synthetic_ref_source (int node);
+
+    int node;
+    Ref_rng rng;
+    long long int remaining;
+    /** Steps taken, the position in the streaming and buffer patterns.  */
+    long long int cursor;
+
+    /** The current burst and the next reference of it to return.  */
+    int burst_size;
+    int burst_pos;
+    char burst_op[SYNTH_MAX_BURST];
+    paddr_t burst_addr[SYNTH_MAX_BURST];
+
+    bool next (char *op, paddr_t *addr);
+    void checkpoint (Checkpoint *ckpt);
+
+private:
+    paddr_t shared (unsigned int line, unsigned int word);
+    paddr_t priv (unsigned int line, unsigned int word);
+    void add (char op, paddr_t addr);
+    void refill (void);
+};
+
+#endif // REF_SOURCE_H_
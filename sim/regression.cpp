@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "regression.h"
+#include "sim.h"
+
+Regression_checker *regression_checker = NULL;
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/** Output buffered before it reaches the comparator.  */
+#define REGRESSION_STREAM_BUFFER (64 * 1024)
+
+static ssize_t regression_write (void *cookie, const char *data, size_t size)
+{
+    ((Regression_checker *)cookie)->feed (data, size);
+    return size;
+}
+
+Regression_checker::Regression_checker (const char *reference_file)
+{
+    this->reference_file = strdup (reference_file);
+    this->reference = fopen (reference_file, "r");
+    if (!reference)
+        fatal_error ("Regression: unable to open reference %s\n", reference_file);
+
+    real_stderr = NULL;
+    stream = NULL;
+    expected = NULL;
+    expected_size = 0;
+
+    hash = FNV_OFFSET_BASIS;
+    lines = 0;
+    last_clock = 0;
+
+    diverged_line = -1;
+    diverged_clock = 0;
+    diverged_expected = NULL;
+    diverged_output = NULL;
+}
+
+Regression_checker::~Regression_checker ()
+{
+    detach ();
+    fclose (reference);
+    free (reference_file);
+    free (expected);
+    free (diverged_expected);
+    free (diverged_output);
+}
+
+void Regression_checker::attach (void)
+{
+    cookie_io_functions_t io = {NULL, regression_write, NULL, NULL};
+
+    stream = fopencookie (this, "w", io);
+    if (!stream)
+        fatal_error ("Regression: unable to open the output stream\n");
+    setvbuf (stream, NULL, _IOFBF, REGRESSION_STREAM_BUFFER);
+
+    fflush (stderr);
+    real_stderr = stderr;
+    stderr = stream;
+}
+
+void Regression_checker::detach (void)
+{
+    if (!stream)
+        return;
+    stderr = real_stderr;
+    fclose (stream);
+    stream = NULL;
+}
+
+void Regression_checker::feed (const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * FNV_PRIME;
+        if (data[i] == '\n')
+            compare_line ();
+        else
+            pending.push_back (data[i]);
+    }
+}
+
+/** Next reference line into expected, without its newline.  */
+bool Regression_checker::next_expected (void)
+{
+    ssize_t len = getline (&expected, &expected_size, reference);
+
+    if (len < 0)
+        return false;
+    if (len > 0 && expected[len - 1] == '\n')
+        expected[len - 1] = '\0';
+    return true;
+}
+
+void Regression_checker::compare_line (void)
+{
+    const char *clock;
+
+    pending.push_back ('\0');
+    lines++;
+
+    if (diverged_line < 0)
+    {
+        if (!next_expected ())
+            diverge ("<end of reference>", &pending[0]);
+        else if (strcmp (expected, &pending[0]))
+            diverge (expected, &pending[0]);
+        else if ((clock = strstr (expected, "Clock: ")))
+            last_clock = atoll (clock + strlen ("Clock: "));
+    }
+    pending.clear ();
+}
+
+void Regression_checker::diverge (const char *expected, const char *output)
+{
+    diverged_line = lines;
+    diverged_clock = last_clock;
+    diverged_expected = strdup (expected);
+    diverged_output = strdup (output);
+}
+
+bool Regression_checker::finish (void)
+{
+    if (stream)
+        fflush (stream);
+    if (!pending.empty ())
+        compare_line ();
+    if (diverged_line < 0 && next_expected ())
+    {
+        lines++;
+        diverge (expected, "<end of output>");
+    }
+    detach ();
+
+    if (diverged_line < 0)
+    {
+        fprintf (stderr, "REGRESSION PASS: %s, %lld lines, hash 0x%016llx\n",
+                 reference_file, lines, (unsigned long long int)hash);
+        return true;
+    }
+
+    fprintf (stderr, "REGRESSION FAIL: %s, line %lld, last matching cycle %lld\n",
+             reference_file, diverged_line, diverged_clock);
+    fprintf (stderr, "  expected: %s\n", diverged_expected);
+    fprintf (stderr, "  output:   %s\n", diverged_output);
+    fprintf (stderr, "  output hash 0x%016llx over %lld lines\n",
+             (unsigned long long int)hash, lines);
+    return false;
+}
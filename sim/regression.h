@@ -0,0 +1,65 @@
+#ifndef REGRESSION_H_
+#define REGRESSION_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "types.h"
+
+using namespace std;
+
+/**
+ * Regression mode (regression_test).  Everything the simulator writes to
+ * stderr is streamed, a line at a time, against a reference log instead of
+ * being printed, so a validation run needs neither the output on disk nor a
+ * diff.  The first divergent line is reported with the cycle of the last
+ * matching event; a 64-bit FNV-1a hash of the whole output is reported
+ * either way as a fingerprint of the run.
+ */
+class Regression_checker {
+public:
+    Regression_checker (const char *reference_file);
+    ~Regression_checker ();
+
+    char *reference_file;
+    FILE *reference;
+
+    /** stderr before attach (), and the comparing stream that replaces it.  */
+    FILE *real_stderr;
+    FILE *stream;
+
+    /** Partial output line, until its newline arrives.  */
+    VECTOR<char> pending;
+    char *expected;
+    size_t expected_size;
+
+    uint64_t hash;
+    long long int lines;
+    long long int last_clock;
+
+    /** First divergence: output line number, -1 while still matching.  */
+    long long int diverged_line;
+    long long int diverged_clock;
+    char *diverged_expected;
+    char *diverged_output;
+
+    /** Redirect stderr into the comparator.  */
+    void attach (void);
+    /** Restore stderr, e.g. for a fatal error.  */
+    void detach (void);
+
+    void feed (const char *data, size_t size);
+
+    /** Check the reference is used up and report; true when it matched.  */
+    bool finish (void);
+
+private:
+    bool next_expected (void);
+    void compare_line (void);
+    void diverge (const char *expected, const char *output);
+};
+
+/** The checker while regression_test is running, else NULL.  */
+extern Regression_checker *regression_checker;
+
+#endif // REGRESSION_H_
@@ -0,0 +1,291 @@
+#include <math.h>
+
+#include "hash_table.h"
+#include "memory.h"
+#include "processor.h"
+#include "sampler.h"
+#include "settings.h"
+#include "sim.h"
+#include "stat_engine.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+/** Two-sided 95% Student-t quantiles for 1..30 degrees of freedom, then
+ *  the normal quantile.  The intervals are rough below SAMPLE_MIN_WINDOWS.  */
+static const double sample_t95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+#define SAMPLE_Z95 1.96
+#define SAMPLE_MIN_WINDOWS 30
+
+Sampler::Sampler ()
+{
+    if (settings.sample_interval < 0 || settings.sample_warmup < 0 || settings.sample_size <= 0)
+        fatal_error ("Sampler: invalid sample_interval %d, sample_warmup %d or sample_size %d\n",
+                     settings.sample_interval, settings.sample_warmup, settings.sample_size);
+    if (settings.checkpoint_file || settings.restore_file)
+        fatal_error ("Sampler: sampling state is not checkpointed\n");
+    if (settings.sim_threads > 1)
+        fatal_error ("Sampler: sampling needs sim_threads = 1\n");
+
+    interval = settings.sample_interval;
+    warmup = settings.sample_warmup;
+    size = settings.sample_size;
+
+    phase = SAMPLE_FUNCTIONAL;
+    phase_refs = 0;
+    window_clock = 0;
+    window_misses = 0;
+    window_accesses = 0;
+    functional_refs = 0;
+
+    windows = 0;
+    cpr_sum = 0.0;
+    cpr_sq_sum = 0.0;
+    miss_rate_sum = 0.0;
+    miss_rate_sq_sum = 0.0;
+
+    stats = new Stat_engine ("sampling");
+    windows_stat         = stats->add_counter ("windows", "measured windows");
+    functional_refs_stat = stats->add_counter ("functional_refs", "references fast-forwarded");
+    drain_cycles         = stats->add_counter ("drain_cycles", "detailed cycles spent emptying the pipeline");
+    cycles_per_ref       = stats->add_average ("cycles_per_ref", "cycles per reference, per window");
+    miss_rate            = stats->add_average ("miss_rate", "L1 miss rate, per window");
+}
+
+Sampler::~Sampler ()
+{
+    delete stats;
+}
+
+/** References fetched by the detailed model.  */
+counter_t Sampler::detailed_refs (void)
+{
+    counter_t refs = 0;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = Sim->get_PR (i);
+
+        refs += pr->stats->loads->value + pr->stats->stores->value;
+    }
+    return refs;
+}
+
+/** Nothing in flight anywhere, so fast-forward cannot meet a half-done
+ *  transaction.  */
+bool Sampler::quiescent (void)
+{
+    if (!Sim->bus->quiet () || Sim->bus->request_in_progress || Sim->bus->current_request ||
+        Sim->get_MC (settings.num_nodes)->request_in_progress)
+        return false;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = Sim->get_PR (i);
+        Hash_table *l1 = Sim->get_L1 (i);
+
+        if (pr->outstanding_request || pr->inbound_request || pr->inbound_request_buf ||
+            l1->proc_request || l1->deferred_request || l1->prefetches_outstanding)
+            return false;
+    }
+    return true;
+}
+
+void Sampler::set_hold (bool hold)
+{
+    for (int i = 0; i < settings.num_nodes; i++)
+        Sim->get_PR (i)->hold = hold;
+}
+
+/** One reference from node's trace, through its L1 and, on a miss, the bus
+ *  and the other L1s until everything is idle again.  */
+bool Sampler::functional_reference (int node)
+{
+    Processor *pr = Sim->get_PR (node);
+    Memory_controller *mc = Sim->get_MC (settings.num_nodes);
+    timestamp_t start = Sim->global_clock;
+    char c;
+    paddr_t addr;
+
+    if (pr->end_of_trace || pr->sync_op)
+        return false;
+    if (pr->sync_granted)
+    {
+        pr->sync_granted = false;
+        c = 'a';
+        addr = pr->sync_addr;
+    }
+    else if (!pr->read_reference (&c, &addr))
+        return false;
+
+    /** Barriers and locks block as in the detailed model, so the cores
+     *  stay in step; fast_forward () wakes them.  */
+    if (c == 'b' || c == 'k')
+    {
+        pr->sync_op = c;
+        pr->sync_addr = addr;
+        return true;
+    }
+
+    /** Functional warming keeps no LL links, so every SC is a store.  */
+    pr->my_cache->proc_request = new Mreq (Processor::op_message (c), addr, pr->moduleID);
+    pr->linked = false;
+
+    pr->my_cache->tick ();
+    while (!pr->inbound_request_buf || !Sim->bus->quiet () || Sim->bus->request_in_progress ||
+           Sim->bus->current_request || mc->request_in_progress)
+    {
+        if (Sim->global_clock - start >= (timestamp_t)settings.watchdog_stall_cycles)
+            fatal_error ("Sampler: PR %d %c 0x%llx not done after %d cycles\n", node, c,
+                         (unsigned long long int)addr, settings.watchdog_stall_cycles);
+        /** With nothing on the bus to snoop the L1s have no work; only
+         *  the memory controller counts down to its DATA.  */
+        Sim->bus->tick ();
+        if (Sim->bus->current_request)
+            for (int i = 0; i <= settings.num_nodes; i++)
+                Sim->Nd[i]->tick_cache ();
+        mc->tick ();
+        Sim->global_clock++;
+    }
+
+    delete pr->inbound_request_buf;
+    pr->inbound_request_buf = NULL;
+    if (c == 'u')
+        Sim->sync_tracker->unlock (node, addr);
+    return true;
+}
+
+void Sampler::fast_forward (void)
+{
+    Memory_controller *mc = Sim->get_MC (settings.num_nodes);
+    timestamp_t clock = Sim->global_clock;
+    int hit_time = mc->hit_time;
+    counter_t refs = 0;
+    bool progress = true;
+
+    assert (phase == SAMPLE_FUNCTIONAL && quiescent ());
+
+    /** The memory controller must still answer a cycle late, after any
+     *  owning cache, or both would reply.  */
+    sim_log_muted = true;
+    mc->hit_time = 1;
+    while (refs < (counter_t)interval && progress)
+    {
+        progress = false;
+        for (int i = 0; i < settings.num_nodes && refs < (counter_t)interval; i++)
+            if (functional_reference (i))
+            {
+                refs++;
+                progress = true;
+            }
+        if (!progress)
+            progress = Sim->sync_tracker->end_cycle (false);
+    }
+    mc->hit_time = hit_time;
+    Sim->global_clock = clock;
+    sim_log_muted = false;
+
+    /** Cores left blocked start waiting now.  */
+    for (int i = 0; i < settings.num_nodes; i++)
+        Sim->get_PR (i)->sync_time = clock;
+
+    functional_refs += refs;
+    functional_refs_stat->add (refs);
+
+    set_hold (false);
+    phase = SAMPLE_WARMUP;
+    phase_refs = detailed_refs ();
+}
+
+void Sampler::end_cycle (void)
+{
+    counter_t refs = detailed_refs ();
+    double cpr, rate;
+
+    switch (phase) {
+    case SAMPLE_WARMUP:
+        if (refs - phase_refs < (counter_t)warmup)
+            break;
+        phase = SAMPLE_MEASURE;
+        phase_refs = refs;
+        window_clock = Sim->global_clock;
+        window_misses = Sim->cache_misses;
+        window_accesses = Sim->cache_accesses;
+        break;
+
+    case SAMPLE_MEASURE:
+        if (refs - phase_refs < (counter_t)size)
+            break;
+        cpr = (double)(Sim->global_clock - window_clock) / (refs - phase_refs);
+        rate = 0.0;
+        if (Sim->cache_accesses > window_accesses)
+            rate = (double)(Sim->cache_misses - window_misses) /
+                   (Sim->cache_accesses - window_accesses);
+
+        windows++;
+        cpr_sum += cpr;
+        cpr_sq_sum += cpr * cpr;
+        miss_rate_sum += rate;
+        miss_rate_sq_sum += rate * rate;
+        windows_stat->inc ();
+        cycles_per_ref->add (cpr);
+        miss_rate->add (rate);
+
+        phase = SAMPLE_DRAIN;
+        set_hold (true);
+        break;
+
+    case SAMPLE_DRAIN:
+        drain_cycles->inc ();
+        if (quiescent ())
+            phase = SAMPLE_FUNCTIONAL;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/** Half width of the 95% confidence interval of the mean of n >= 2
+ *  samples.  */
+static double confidence (double sum, double sq_sum, int n)
+{
+    int df = n - 1;
+    double mean, var, t;
+
+    mean = sum / n;
+    var = (sq_sum - n * mean * mean) / df;
+    t = df <= (int)(sizeof (sample_t95) / sizeof (sample_t95[0])) ? sample_t95[df - 1] : SAMPLE_Z95;
+    return var > 0.0 ? t * sqrt (var / n) : 0.0;
+}
+
+void Sampler::report (FILE *fp)
+{
+    counter_t refs = functional_refs + detailed_refs ();
+    double cpr, rate;
+
+    fprintf (fp, "Sampled Windows:  %8d windows\n", windows);
+    if (!windows)
+        return;
+
+    cpr = cpr_sum / windows;
+    rate = miss_rate_sum / windows;
+    /** One window gives no spread to build an interval on.  */
+    if (windows < 2)
+    {
+        fprintf (fp, "Est. Run Time:    %8.0f cycles\n", refs * cpr);
+        fprintf (fp, "Est. Miss Rate:   %8.4f\n", rate);
+        return;
+    }
+    fprintf (fp, "Est. Run Time:    %8.0f cycles (+/- %.0f, 95%%)\n",
+             refs * cpr, refs * confidence (cpr_sum, cpr_sq_sum, windows));
+    fprintf (fp, "Est. Miss Rate:   %8.4f (+/- %.4f, 95%%)\n",
+             rate, confidence (miss_rate_sum, miss_rate_sq_sum, windows));
+    if (windows < SAMPLE_MIN_WINDOWS)
+        fprintf (fp, "Warning: only %d windows, the intervals are rough; lower sample_interval for more\n",
+                 windows);
+}
@@ -0,0 +1,84 @@
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#include <stdio.h>
+
+#include "types.h"
+
+using namespace std;
+
+class Stat_average;
+class Stat_counter;
+class Stat_engine;
+
+typedef enum {
+    SAMPLE_FUNCTIONAL = 0,   // Fast-forward: line states and trace position only
+    SAMPLE_WARMUP,           // Detailed, not measured
+    SAMPLE_MEASURE,          // Detailed, measured
+    SAMPLE_DRAIN             // Detailed, no new fetches until the pipeline is empty
+} sample_phase_t;
+
+/**
+ * SMARTS-style sampled simulation.  The run alternates functional
+ * fast-forward over sample_interval references with a detailed window:
+ * sample_warmup references to warm the bus and the in-flight state, then
+ * sample_size measured references.  Reference counts are totals over all
+ * processors; fast-forward interleaves the processors one reference at a
+ * time.
+ *
+ * Fast-forward pushes each reference through the real L1s, bus and memory
+ * controller, so every protocol keeps exact line states, but with no log,
+ * a one cycle memory and the clock put back afterwards.  The clock, and so
+ * Run Time, only counts detailed cycles; the per-window cycles per
+ * reference and miss rate give the estimates for the whole trace.
+ */
+class Sampler {
+public:
+    Sampler ();
+    ~Sampler ();
+
+    int interval;
+    int warmup;
+    int size;
+
+    sample_phase_t phase;
+    counter_t phase_refs;
+
+    /** Counters at the start of the measured part of the window.  */
+    timestamp_t window_clock;
+    unsigned long int window_misses;
+    unsigned long int window_accesses;
+
+    counter_t functional_refs;
+
+    /** Per-window samples as sums for the mean and variance.  */
+    int windows;
+    double cpr_sum;
+    double cpr_sq_sum;
+    double miss_rate_sum;
+    double miss_rate_sq_sum;
+
+    Stat_engine *stats;
+    Stat_counter *windows_stat;
+    Stat_counter *functional_refs_stat;
+    Stat_counter *drain_cycles;
+    Stat_average *cycles_per_ref;
+    Stat_average *miss_rate;
+
+    /** Run the functional part of the period; the pipeline must be empty.  */
+    void fast_forward (void);
+    /** After each detailed cycle.  */
+    void end_cycle (void);
+    /** Run node's next reference functionally; false if it has none.  Also
+     *  drives stress_functional runs.  */
+    static bool functional_reference (int node);
+
+    void report (FILE *fp);
+
+private:
+    counter_t detailed_refs (void);
+    bool quiescent (void);
+    void set_hold (bool hold);
+};
+
+#endif // SAMPLER_H_
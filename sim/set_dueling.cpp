@@ -0,0 +1,103 @@
+#include "checkpoint.h"
+#include "set_dueling.h"
+#include "settings.h"
+#include "sim.h"
+#include "stat_engine.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+Set_dueling::Set_dueling ()
+{
+    if (settings.protocol != MESI_PRO)
+        fatal_error ("Set_dueling: qsets_enabled is only implemented for MESI\n");
+    if (settings.qsets_interval <= 0)
+        fatal_error ("Set_dueling: invalid qsets_interval %d\n", settings.qsets_interval);
+
+    num_sets = settings.l1_cache_size / (settings.l1_cache_assoc * settings.cache_line_size);
+    if (num_sets < 2 * QSETS_LEADER_STRIDE)
+        fatal_error ("Set_dueling: need at least %d L1 sets, have %d\n",
+                     2 * QSETS_LEADER_STRIDE, num_sets);
+    interval = settings.qsets_interval;
+
+    followers_use_b = false;
+    accesses = 0;
+    misses_a = 0;
+    misses_b = 0;
+
+    stats = new Stat_engine ("set_dueling");
+    leader_a_misses = stats->add_counter ("leader_a_misses", "misses in policy A (shared) leader sets");
+    leader_b_misses = stats->add_counter ("leader_b_misses", "misses in policy B (migratory) leader sets");
+    intervals       = stats->add_counter ("intervals", "completed dueling intervals");
+    intervals_b     = stats->add_counter ("intervals_b", "intervals that left followers on policy B");
+    switches        = stats->add_counter ("switches", "follower policy changes");
+}
+
+Set_dueling::~Set_dueling ()
+{
+    delete stats;
+}
+
+qset_t Set_dueling::get_qset (paddr_t addr)
+{
+    int set = (addr >> settings.cache_line_size_log2) % num_sets;
+
+    switch (set % QSETS_LEADER_STRIDE) {
+    case 0:                       return QSET_1LVL;
+    case QSETS_LEADER_STRIDE - 1: return QSET_2LVL;
+    default:                      return QSET_FOLLOWER;
+    }
+}
+
+bool Set_dueling::use_policy_b (paddr_t addr)
+{
+    switch (get_qset (addr)) {
+    case QSET_1LVL: return false;
+    case QSET_2LVL: return true;
+    default:        return followers_use_b;
+    }
+}
+
+void Set_dueling::access (paddr_t addr, bool hit)
+{
+    if (!hit)
+    {
+        switch (get_qset (addr)) {
+        case QSET_1LVL:
+            misses_a++;
+            leader_a_misses->inc ();
+            break;
+        case QSET_2LVL:
+            misses_b++;
+            leader_b_misses->inc ();
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (++accesses < (counter_t)interval)
+        return;
+
+    /** Ties keep the current policy.  */
+    if (misses_a != misses_b && (misses_b < misses_a) != followers_use_b)
+    {
+        followers_use_b = !followers_use_b;
+        switches->inc ();
+    }
+    intervals->inc ();
+    if (followers_use_b)
+        intervals_b->inc ();
+
+    accesses = 0;
+    misses_a = 0;
+    misses_b = 0;
+}
+
+void Set_dueling::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (followers_use_b);
+    ckpt->io (accesses);
+    ckpt->io (misses_a);
+    ckpt->io (misses_b);
+}
@@ -0,0 +1,58 @@
+#ifndef SET_DUELING_H_
+#define SET_DUELING_H_
+
+#include "enums.h"
+#include "types.h"
+
+using namespace std;
+
+class Checkpoint;
+class Stat_counter;
+class Stat_engine;
+
+/** One leader set of each policy in every this many L1 sets.  */
+#define QSETS_LEADER_STRIDE 32
+
+/**
+ * Set dueling between two coherence policies.  Lines are grouped by the
+ * L1 set they would index (l1_cache_size / l1_cache_assoc / line size).
+ * QSET_1LVL leader sets always run policy A, QSET_2LVL leader sets always
+ * run policy B, and follower sets run whichever leader group took fewer
+ * demand misses over the previous qsets_interval L1 accesses.
+ *
+ * The dueled policy is migratory ownership in MESI: under policy A an M
+ * copy that snoops a GETS keeps a shared copy (plain MESI); under policy B
+ * it hands the reader the only copy, so the reader's expected write is a
+ * silent E->M upgrade rather than an upgrade miss.
+ */
+class Set_dueling {
+public:
+    Set_dueling ();
+    ~Set_dueling ();
+
+    int num_sets;
+    int interval;
+
+    /** Follower policy for the current interval.  */
+    bool followers_use_b;
+    counter_t accesses;
+    counter_t misses_a;
+    counter_t misses_b;
+
+    Stat_engine *stats;
+    Stat_counter *leader_a_misses;
+    Stat_counter *leader_b_misses;
+    Stat_counter *intervals;
+    Stat_counter *intervals_b;
+    Stat_counter *switches;
+
+    qset_t get_qset (paddr_t addr);
+    bool use_policy_b (paddr_t addr);
+
+    /** Every demand L1 access.  */
+    void access (paddr_t addr, bool hit);
+
+    void checkpoint (Checkpoint *ckpt);
+};
+
+#endif // SET_DUELING_H_
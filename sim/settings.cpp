@@ -1,5 +1,6 @@
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -21,133 +22,178 @@ extern Simulator Sim;
 // Possible identifiers for config file
 setts identifiers [] = {
     /** NOC.  */
-    {"network_x_dimension",     &(settings.network_x_dimension)   },
-    {"network_y_dimension",     &(settings.network_y_dimension)   },
+    {"network_x_dimension",     &(settings.network_x_dimension),   SETT_INT},
+    {"network_y_dimension",     &(settings.network_y_dimension),   SETT_INT},
 
     /** Neighborhoods.  */
-    {"num_nhoods",              &(settings.num_nhoods)            },
-    {"nhood_x_blocking_factor", &(settings.nhood_x_blocking_factor)},
-    {"nhood_y_blocking_factor", &(settings.nhood_y_blocking_factor)},
+    {"num_nhoods",              &(settings.num_nhoods),            SETT_INT},
+    {"nhood_x_blocking_factor", &(settings.nhood_x_blocking_factor), SETT_INT},
+    {"nhood_y_blocking_factor", &(settings.nhood_y_blocking_factor), SETT_INT},
 
     /** Memory controller.  */
-    {"num_mem_ctrls",           &(settings.num_mem_ctrls)         },
-    {"mem_ctrl_array",          &(settings.mem_ctrl_array)        },
-
-	{"heartrate",               &(settings.heartrate)             },
-	{"net_infinite_bw",		   	&(settings.net_infinite_bw)       },
-	{"sharer_forwarding",	   	&(settings.sharer_forwarding)     },
-	{"wait_on_inv_acks",	   	&(settings.wait_on_inv_acks)      },
-	{"livelock_check",		   	&(settings.livelock_check)        },
-	{"processor_affinity",		&(settings.processor_affinity)    },
-    {"mem_model_enabled",       &(settings.mem_model_enabled)     },
+    {"num_mem_ctrls",           &(settings.num_mem_ctrls),         SETT_INT},
+    {"mem_ctrl_array",          &(settings.mem_ctrl_array),        SETT_NONE},
+
+	{"heartrate",               &(settings.heartrate),             SETT_UINT},
+	{"net_infinite_bw",		   	&(settings.net_infinite_bw),       SETT_BOOL},
+	{"sharer_forwarding",	   	&(settings.sharer_forwarding),     SETT_BOOL},
+	{"wait_on_inv_acks",	   	&(settings.wait_on_inv_acks),      SETT_BOOL},
+	{"livelock_check",		   	&(settings.livelock_check),        SETT_BOOL},
+    {"watchdog_stall_cycles",   &(settings.watchdog_stall_cycles), SETT_INT},
+	{"processor_affinity",		&(settings.processor_affinity),    SETT_BOOL},
+    {"mem_model_enabled",       &(settings.mem_model_enabled),     SETT_BOOL},
 
     /** Is this a regression run?  */
-    {"regression_test",         &(settings.regression_test)       },
+    {"regression_test",         &(settings.regression_test),       SETT_BOOL},
 
     /** SESC specific.  */
-	{"sesc_rabbit",			   	&(settings.sesc_rabbit)           },
-    {"sesc_nsim_per_core",      &(settings.sesc_nsim_per_core)    },
-    {"sesc_disable_llsc",       &(settings.sesc_disable_llsc)     },
-	{"warmup_time_per_core",	&(settings.warmup_time_per_core)  },
+	{"sesc_rabbit",			   	&(settings.sesc_rabbit),           SETT_LLONG},
+    {"sesc_nsim_per_core",      &(settings.sesc_nsim_per_core),    SETT_LLONG},
+    {"sesc_disable_llsc",       &(settings.sesc_disable_llsc),     SETT_BOOL},
+	{"warmup_time_per_core",	&(settings.warmup_time_per_core),  SETT_LLONG},
 
     /** General cache.  */
-	{"cache_line_size_log2",   	&(settings.cache_line_size_log2)  },
-	{"cache_line_size",		   	&(settings.cache_line_size)       },
+	{"cache_line_size_log2",   	&(settings.cache_line_size_log2),  SETT_UINT},
+	{"cache_line_size",		   	&(settings.cache_line_size),       SETT_UINT},
 
 	/** Processor.  */
-    {"LSQ_dependence",          &(settings.LSQ_dependence)         },
-    {"mshrs_per_processor",     &(settings.mshrs_per_processor)    },
-    {"threads_per_processor",   &(settings.threads_per_processor)  },
-    {"thread_map_policy",       &(settings.thread_map_policy)      },
+    {"LSQ_dependence",          &(settings.LSQ_dependence),         SETT_BOOL},
+    {"mshrs_per_processor",     &(settings.mshrs_per_processor),    SETT_INT},
+    {"threads_per_processor",   &(settings.threads_per_processor),  SETT_INT},
+    {"thread_map_policy",       &(settings.thread_map_policy),      SETT_ENUM},
 
     /** Simple processor.  */
-    {"simple_issue_width",      &(settings.simple_issue_width)     },
+    {"simple_issue_width",      &(settings.simple_issue_width),     SETT_INT},
 
     /** Inorder processor.  */
-    {"inorder_fetch_width",     &(settings.inorder_fetch_width)    },
-    {"inorder_issue_width",     &(settings.inorder_issue_width)    },
-    {"inorder_commit_width",    &(settings.inorder_commit_width)   },
+    {"inorder_fetch_width",     &(settings.inorder_fetch_width),    SETT_INT},
+    {"inorder_issue_width",     &(settings.inorder_issue_width),    SETT_INT},
+    {"inorder_commit_width",    &(settings.inorder_commit_width),   SETT_INT},
 
     /** L1 cache.  */
-    {"l1_cache_type",           &(settings.l1_cache_type)         },
-	{"l1_cache_size",		   	&(settings.l1_cache_size)         },
-	{"l1_cache_assoc",		   	&(settings.l1_cache_assoc)        },
-	{"l1_hit_time",			   	&(settings.l1_hit_time)           },
-	{"l1_mshrs",			   	&(settings.l1_mshrs)              },
-	{"l1_replacement_policy",  	&(settings.l1_replacement_policy) },
-	{"l1_lookup_time",		   	&(settings.l1_lookup_time)        },
-	{"l1_infinite",		   	    &(settings.l1_infinite)           },
+    {"l1_cache_type",           &(settings.l1_cache_type),         SETT_ENUM},
+	{"l1_cache_size",		   	&(settings.l1_cache_size),         SETT_INT},
+	{"l1_cache_assoc",		   	&(settings.l1_cache_assoc),        SETT_INT},
+	{"l1_hit_time",			   	&(settings.l1_hit_time),           SETT_INT},
+    {"mem_hit_time",            &(settings.mem_hit_time),          SETT_INT},
+	{"l1_mshrs",			   	&(settings.l1_mshrs),              SETT_INT},
+	{"l1_replacement_policy",  	&(settings.l1_replacement_policy), SETT_ENUM},
+	{"l1_lookup_time",		   	&(settings.l1_lookup_time),        SETT_INT},
+	{"l1_infinite",		   	    &(settings.l1_infinite),           SETT_BOOL},
 
     /** L2 cache.  */
-    {"l2_cache_type",           &(settings.l2_cache_type)         },
-	{"l2_cache_size",		   	&(settings.l2_cache_size)         },
-	{"l2_cache_assoc",		   	&(settings.l2_cache_assoc)        },
-	{"l2_hit_time",			   	&(settings.l2_hit_time)           },
-	{"l2_mshrs",			   	&(settings.l2_mshrs)              },
-	{"l2_replacement_policy",  	&(settings.l2_replacement_policy) },
-	{"l2_lookup_time",		 	&(settings.l2_lookup_time)        },
-	{"l2_infinite",		   	    &(settings.l2_infinite)           },
+    {"l2_cache_type",           &(settings.l2_cache_type),         SETT_ENUM},
+	{"l2_cache_size",		   	&(settings.l2_cache_size),         SETT_INT},
+	{"l2_cache_assoc",		   	&(settings.l2_cache_assoc),        SETT_INT},
+	{"l2_hit_time",			   	&(settings.l2_hit_time),           SETT_INT},
+	{"l2_mshrs",			   	&(settings.l2_mshrs),              SETT_INT},
+	{"l2_replacement_policy",  	&(settings.l2_replacement_policy), SETT_ENUM},
+	{"l2_lookup_time",		 	&(settings.l2_lookup_time),        SETT_INT},
+	{"l2_infinite",		   	    &(settings.l2_infinite),           SETT_BOOL},
 
     /** L3 cache.  */
-    {"l3_cache_type",           &(settings.l3_cache_type)         },
-	{"l3_cache_size",		   	&(settings.l3_cache_size)         },
-	{"l3_cache_assoc",		   	&(settings.l3_cache_assoc)        },
-	{"l3_hit_time",			   	&(settings.l3_hit_time)           },
-	{"l3_mshrs",			   	&(settings.l3_mshrs)              },
-	{"l3_replacement_policy",  	&(settings.l3_replacement_policy) },
-	{"l3_lookup_time",		 	&(settings.l3_lookup_time)        },
-	{"l3_infinite",		   	    &(settings.l3_infinite)           },
+    {"l3_cache_type",           &(settings.l3_cache_type),         SETT_ENUM},
+	{"l3_cache_size",		   	&(settings.l3_cache_size),         SETT_INT},
+	{"l3_cache_assoc",		   	&(settings.l3_cache_assoc),        SETT_INT},
+	{"l3_hit_time",			   	&(settings.l3_hit_time),           SETT_INT},
+	{"l3_mshrs",			   	&(settings.l3_mshrs),              SETT_INT},
+	{"l3_replacement_policy",  	&(settings.l3_replacement_policy), SETT_ENUM},
+	{"l3_lookup_time",		 	&(settings.l3_lookup_time),        SETT_INT},
+	{"l3_infinite",		   	    &(settings.l3_infinite),           SETT_BOOL},
 
     /** Directory.  */
-	{"dir_tiers",			    &(settings.dir_tiers)             },
-	{"dir_coherence_policy",	&(settings.dir_coherence_policy)  },
-    {"dir_mode",                &(settings.dir_mode)              },
+	{"dir_tiers",			    &(settings.dir_tiers),             SETT_INT},
+	{"dir_coherence_policy",	&(settings.dir_coherence_policy),  SETT_NONE},
+    {"dir_mode",                &(settings.dir_mode),              SETT_ENUM},
     
     /** Make sure home bits don't overlap with index bits.  */
-    {"dir_addr_per_node_log2",  &(settings.dir_addr_per_node_log2)},
+    {"dir_addr_per_node_log2",  &(settings.dir_addr_per_node_log2), SETT_INT},
 
     /** Set index and directory home node swizzle.  */
-	{"cache_index_swizzle",	    &(settings.cache_index_swizzle)   },
-	{"dir_home_swizzle",	    &(settings.dir_home_swizzle)      },
+	{"cache_index_swizzle",	    &(settings.cache_index_swizzle),   SETT_ADDR},
+	{"dir_home_swizzle",	    &(settings.dir_home_swizzle),      SETT_ADDR},
 
     /** Dynamic home node remapping.  */
-    {"qsets_enabled",           &(settings.qsets_enabled)         },
-    {"qsets_interval",          &(settings.qsets_interval)        },
-    {"remap_table_size",        &(settings.remap_table_size)      },
+    {"qsets_enabled",           &(settings.qsets_enabled),         SETT_BOOL},
+    {"qsets_interval",          &(settings.qsets_interval),        SETT_INT},
+    {"remap_table_size",        &(settings.remap_table_size),      SETT_INT},
 
     /** Selective Replication predictor.  */
-    {"sel_rep_pred",            &(settings.sel_rep_pred)          },
-    {"sel_rep_pred_scope",      &(settings.sel_rep_pred_scope)    },
-    {"train_on_loads",          &(settings.train_on_loads)        },
-    {"train_on_stores",         &(settings.train_on_stores)       },
-    {"sel_rep_pred_threshold",  &(settings.sel_rep_pred_threshold)},
+    {"sel_rep_pred",            &(settings.sel_rep_pred),          SETT_ENUM},
+    {"sel_rep_pred_scope",      &(settings.sel_rep_pred_scope),    SETT_ENUM},
+    {"train_on_loads",          &(settings.train_on_loads),        SETT_BOOL},
+    {"train_on_stores",         &(settings.train_on_stores),       SETT_BOOL},
+    {"sel_rep_pred_threshold",  &(settings.sel_rep_pred_threshold), SETT_INT},
+    {"sel_rep_pred_entries",    &(settings.sel_rep_pred_entries),  SETT_INT},
 
     /** Sim Analysis flags.  */
-    {"sim_analysis_enabled",    &(settings.sim_analysis_enabled)  },
-    {"ro_tracker_gran",         &(settings.ro_tracker_gran)       },
-    {"ro_tracker_entries",      &(settings.ro_tracker_entries)    },
-	{"data_graph",				&(settings.data_graph)			  },
+    {"sim_analysis_enabled",    &(settings.sim_analysis_enabled),  SETT_BOOL},
+    {"ro_tracker_gran",         &(settings.ro_tracker_gran),       SETT_UINT},
+    {"ro_tracker_entries",      &(settings.ro_tracker_entries),    SETT_UINT},
+    {"ref_stream_entries",      &(settings.ref_stream_entries),    SETT_UINT},
+    {"fs_word_size",            &(settings.fs_word_size),          SETT_UINT},
+    {"fs_report_lines",         &(settings.fs_report_lines),       SETT_UINT},
+    {"stack_distance_enabled",  &(settings.stack_distance_enabled), SETT_BOOL},
+    {"sd_max_sets_log2",        &(settings.sd_max_sets_log2),      SETT_UINT},
+    {"sd_max_assoc",            &(settings.sd_max_assoc),          SETT_UINT},
+    {"prefetcher",              &(settings.prefetcher),            SETT_ENUM},
+    {"prefetch_degree",         &(settings.prefetch_degree),       SETT_INT},
+    {"prefetch_max_outstanding", &(settings.prefetch_max_outstanding), SETT_INT},
+    {"prefetch_table_size",     &(settings.prefetch_table_size),   SETT_INT},
+    {"prefetch_max_wait",       &(settings.prefetch_max_wait),     SETT_INT},
+    {"bus_width",               &(settings.bus_width),             SETT_INT},
+    {"bus_addr_cycles",         &(settings.bus_addr_cycles),       SETT_INT},
+    {"c2c_latency",             &(settings.c2c_latency),           SETT_INT},
+    {"snoop_filter",            &(settings.snoop_filter),          SETT_ENUM},
+    {"snoop_filter_entries",    &(settings.snoop_filter_entries),  SETT_INT},
+    {"sim_threads",             &(settings.sim_threads),           SETT_INT},
+    {"hit_fast_path",           &(settings.hit_fast_path),         SETT_BOOL},
+    {"checkpoint_cycle",        &(settings.checkpoint_cycle),      SETT_LLONG},
+    {"checkpoint_exit",         &(settings.checkpoint_exit),       SETT_BOOL},
+    {"restore_clear_stats",     &(settings.restore_clear_stats),   SETT_BOOL},
+    {"ref_source",              &(settings.ref_source),            SETT_ENUM},
+    {"stress_refs",             &(settings.stress_refs),           SETT_LLONG},
+    {"stress_lines",            &(settings.stress_lines),          SETT_INT},
+    {"stress_store_pct",        &(settings.stress_store_pct),      SETT_INT},
+    {"stress_seed",             &(settings.stress_seed),           SETT_INT},
+    {"stress_functional",       &(settings.stress_functional),     SETT_BOOL},
+    {"synth_pattern",           &(settings.synth_pattern),         SETT_ENUM},
+    {"synth_refs",              &(settings.synth_refs),            SETT_LLONG},
+    {"synth_lines",             &(settings.synth_lines),           SETT_INT},
+    {"synth_store_pct",         &(settings.synth_store_pct),       SETT_INT},
+    {"synth_seed",              &(settings.synth_seed),            SETT_INT},
+    {"explore",                 &(settings.explore),               SETT_BOOL},
+    {"explore_lines",           &(settings.explore_lines),         SETT_INT},
+    {"explore_max_states",      &(settings.explore_max_states),    SETT_INT},
+    {"explore_max_errors",      &(settings.explore_max_errors),    SETT_INT},
+    {"coherence_check",         &(settings.coherence_check),       SETT_BOOL},
+    {"coherence_check_entries", &(settings.coherence_check_entries), SETT_INT},
+    {"sampling_enabled",        &(settings.sampling_enabled),      SETT_BOOL},
+    {"sample_interval",         &(settings.sample_interval),       SETT_INT},
+    {"sample_warmup",           &(settings.sample_warmup),         SETT_INT},
+    {"sample_size",             &(settings.sample_size),           SETT_INT},
+	{"data_graph",				&(settings.data_graph),			  SETT_BOOL},
 
 
 	/** Express Link and VC Stuff */
-    {"network_topology",        &(settings.network_topology)      },
-	{"express_link_len",		&(settings.express_link_len)	  },
-	{"express_link_active",		&(settings.express_link_active)	  },
+    {"network_topology",        &(settings.network_topology),      SETT_ENUM},
+	{"express_link_len",		&(settings.express_link_len),	  SETT_INT},
+	{"express_link_active",		&(settings.express_link_active),	  SETT_BOOL},
 
 	/** DO NOT SET IN CONFIG FILE: These are set automagically by net_infinite_bw **/
-	{"num_virtual_channels",	&(settings.num_virtual_channels)  },
-	{"buffer_entries_per_vc",	&(settings.buffer_entries_per_vc) },
-	{"debug_addr",	            &(settings.debug_addr)            },
-    {"test_addr",               &(settings.test_addr)            },
+	{"num_virtual_channels",	&(settings.num_virtual_channels),  SETT_INT},
+	{"buffer_entries_per_vc",	&(settings.buffer_entries_per_vc), SETT_INT},
+	{"debug_addr",	            &(settings.debug_addr),            SETT_ADDR},
+    {"test_addr",               &(settings.test_addr),            SETT_ADDR},
 
 	/** report generation, tell simulator to output to cerr, cout, or null for no output **/
-	{"report_output",           &(settings.report_output)         },
+	{"report_output",           &(settings.report_output),         SETT_ENUM},
 
 	/** Sampling Rate for statistics that are collected in intervals (i.e. avg sharer stat **/
-	{"sampling_interval",		&(settings.sampling_interval)	  },
+	{"sampling_interval",		&(settings.sampling_interval),	  SETT_LLONG},
 
     /** Invalid.  */
-    {"end",						NULL                                  }
+    {"end",						NULL,                             SETT_NONE}
 };
 
 Sim_settings::Sim_settings (void)
@@ -183,10 +229,12 @@ void Sim_settings::print_settings (void)
 	fprintf (stderr, " sharer_forwarding:     %16s\n", sharer_forwarding == true ? "true" : "false");
 	fprintf (stderr, " wait_on_inv_acks:      %16s\n", wait_on_inv_acks == true ? "true" : "false");
 	fprintf (stderr, " livelock_check:        %16s\n", livelock_check == true ? "true" : "false");
+    fprintf (stderr, " watchdog_stall_cycles  %16d\n", watchdog_stall_cycles);
     fprintf (stderr, " heartrate              %16d\n", heartrate);
 	fprintf (stderr, " processor_affinity:    %16s\n", processor_affinity == true ? "true" : "false");
     fprintf (stderr, " mem_model_enabled:     %16s\n", mem_model_enabled == true ? "true" : "false");
 	fprintf (stderr, " regression_test:       %16s\n", regression_test == true ? "true" : "false");
+    fprintf (stderr, " regression_file:       %16s\n", regression_file ? regression_file : "default");
 
 	fprintf (stderr, " sesc_rabbit:           %16lld\n", sesc_rabbit);
 	fprintf (stderr, " sesc_nsim:             %16lld\n", sesc_nsim);
@@ -216,6 +264,7 @@ void Sim_settings::print_settings (void)
 	fprintf (stderr, " l1_cache_size:         %16d\n", l1_cache_size);
 	fprintf (stderr, " l1_cache_assoc:        %16d\n", l1_cache_assoc);
 	fprintf (stderr, " l1_hit_time:           %16d\n", l1_hit_time);
+    fprintf (stderr, " mem_hit_time:          %16d\n", mem_hit_time);
 	fprintf (stderr, " l1_mshrs:              %16d\n", l1_mshrs);
 	fprintf (stderr, " l1_replacement_policy: %16d\n", l1_replacement_policy);
 	fprintf (stderr, " l1_coherence_policy:   %16d\n", l1_coherence_policy);
@@ -257,15 +306,60 @@ void Sim_settings::print_settings (void)
     fprintf (stderr, " qsets_interval:        %16d\n", qsets_interval);
     fprintf (stderr, " remap_table_size:      %16d\n", remap_table_size);
 
-    //TODO: sel_rep_pred
-    //TODO: sel_rep_pred_scope
-    //TODO: train_on_loads
-    //TODO: train_on_stores
-    //TODO: sel_rep_pred_threshold
+    fprintf (stderr, " sel_rep_pred:          %16d\n", sel_rep_pred);
+    fprintf (stderr, " sel_rep_pred_scope:    %16d\n", sel_rep_pred_scope);
+    fprintf (stderr, " train_on_loads:        %16s\n", train_on_loads == true ? "true" : "false");
+    fprintf (stderr, " train_on_stores:       %16s\n", train_on_stores == true ? "true" : "false");
+    fprintf (stderr, " sel_rep_pred_threshold:%16d\n", sel_rep_pred_threshold);
+    fprintf (stderr, " sel_rep_pred_entries:  %16d\n", sel_rep_pred_entries);
 
     fprintf (stderr, " sim_analysis_enabled   %16s\n", sim_analysis_enabled == true ? "true" : "false");
     fprintf (stderr, " ro_tracker_gran        %16d bytes\n", ro_tracker_gran);
-    fprintf (stderr, " ro_tracker_entries     %16d bytes\n", ro_tracker_entries);
+    fprintf (stderr, " ro_tracker_entries     %16d\n", ro_tracker_entries);
+    fprintf (stderr, " ref_stream_entries     %16d\n", ref_stream_entries);
+    fprintf (stderr, " fs_word_size           %16d bytes\n", fs_word_size);
+    fprintf (stderr, " fs_report_lines        %16d\n", fs_report_lines);
+    fprintf (stderr, " stack_distance_enabled %16s\n", stack_distance_enabled == true ? "true" : "false");
+    fprintf (stderr, " sd_max_sets_log2       %16d\n", sd_max_sets_log2);
+    fprintf (stderr, " sd_max_assoc           %16d\n", sd_max_assoc);
+    fprintf (stderr, " prefetcher             %16d\n", prefetcher);
+    fprintf (stderr, " prefetch_degree        %16d\n", prefetch_degree);
+    fprintf (stderr, " prefetch_max_outstanding %14d\n", prefetch_max_outstanding);
+    fprintf (stderr, " prefetch_table_size    %16d\n", prefetch_table_size);
+    fprintf (stderr, " prefetch_max_wait      %16d cycles\n", prefetch_max_wait);
+    fprintf (stderr, " bus_width              %16d bytes\n", bus_width);
+    fprintf (stderr, " bus_addr_cycles        %16d\n", bus_addr_cycles);
+    fprintf (stderr, " c2c_latency            %16d\n", c2c_latency);
+    fprintf (stderr, " snoop_filter           %16d\n", snoop_filter);
+    fprintf (stderr, " snoop_filter_entries   %16d\n", snoop_filter_entries);
+    fprintf (stderr, " sim_threads            %16d\n", sim_threads);
+    fprintf (stderr, " hit_fast_path          %16s\n", hit_fast_path == true ? "true" : "false");
+    fprintf (stderr, " checkpoint_file        %16s\n", checkpoint_file ? checkpoint_file : "none");
+    fprintf (stderr, " restore_file           %16s\n", restore_file ? restore_file : "none");
+    fprintf (stderr, " checkpoint_cycle       %16lld\n", checkpoint_cycle);
+    fprintf (stderr, " checkpoint_exit        %16s\n", checkpoint_exit == true ? "true" : "false");
+    fprintf (stderr, " restore_clear_stats    %16s\n", restore_clear_stats == true ? "true" : "false");
+    fprintf (stderr, " ref_source             %16d\n", ref_source);
+    fprintf (stderr, " stress_refs            %16lld\n", stress_refs);
+    fprintf (stderr, " stress_lines           %16d\n", stress_lines);
+    fprintf (stderr, " stress_store_pct       %16d\n", stress_store_pct);
+    fprintf (stderr, " stress_seed            %16d\n", stress_seed);
+    fprintf (stderr, " stress_functional      %16s\n", stress_functional == true ? "true" : "false");
+    fprintf (stderr, " synth_pattern          %16d\n", synth_pattern);
+    fprintf (stderr, " synth_refs             %16lld\n", synth_refs);
+    fprintf (stderr, " synth_lines            %16d\n", synth_lines);
+    fprintf (stderr, " synth_store_pct        %16d\n", synth_store_pct);
+    fprintf (stderr, " synth_seed             %16d\n", synth_seed);
+    fprintf (stderr, " explore                %16s\n", explore == true ? "true" : "false");
+    fprintf (stderr, " explore_lines          %16d\n", explore_lines);
+    fprintf (stderr, " explore_max_states     %16d\n", explore_max_states);
+    fprintf (stderr, " explore_max_errors     %16d\n", explore_max_errors);
+    fprintf (stderr, " coherence_check        %16s\n", coherence_check == true ? "true" : "false");
+    fprintf (stderr, " coherence_check_entries %15d\n", coherence_check_entries);
+    fprintf (stderr, " sampling_enabled       %16s\n", sampling_enabled == true ? "true" : "false");
+    fprintf (stderr, " sample_interval        %16d\n", sample_interval);
+    fprintf (stderr, " sample_warmup          %16d\n", sample_warmup);
+    fprintf (stderr, " sample_size            %16d\n", sample_size);
 
     /* TODO
 		unsigned int pcm_sets;
@@ -292,6 +386,8 @@ void Sim_settings::print_settings (void)
     fprintf (stderr, " test_addr:             0x%14llx\n", (unsigned long long int) test_addr);
 
 	fprintf (stderr, " sampling_interval:     %lld\n", sampling_interval);
+	fprintf (stderr, " report_output:         %16d\n", report_output);
+	fprintf (stderr, " stats_file:            %16s\n", stats_file ? stats_file : "none");
 }
 
 void Sim_settings::set_defaults (void)
@@ -315,6 +411,7 @@ void Sim_settings::set_defaults (void)
     mem_ctrl_array[3]       = 36;
 
     heartrate               = (1 << 16);
+    watchdog_stall_cycles   = 100000;
     net_infinite_bw			= false;
     sharer_forwarding		= true;
     wait_on_inv_acks	    = true;
@@ -322,6 +419,7 @@ void Sim_settings::set_defaults (void)
     processor_affinity		= true;
     mem_model_enabled       = false;
     regression_test         = false;
+    regression_file         = NULL;
     sesc_rabbit				= 1000000000;
     sesc_nsim               = 0;
     sesc_nsim_per_core      = 10000000;
@@ -348,6 +446,7 @@ void Sim_settings::set_defaults (void)
     l1_cache_size           = 32768;
     l1_cache_assoc          = 4;
     l1_hit_time             = 2;
+    mem_hit_time            = 100;
     l1_mshrs                = 2;
     l1_replacement_policy	= RP_LRU;
     l1_coherence_policy		= MESI;
@@ -390,15 +489,60 @@ void Sim_settings::set_defaults (void)
     remap_table_size        = 1024;
     sel_rep_pred            = INVALID_PRED;
     sel_rep_pred_scope      = INVALID_SCOPE;
-    train_on_loads          = false;
-    train_on_stores         = false;
-    sel_rep_pred_threshold  = 0;
+    train_on_loads          = true;
+    train_on_stores         = true;
+    sel_rep_pred_threshold  = 2;
+    sel_rep_pred_entries    = 4096;
 
     debug = false;
 
     sim_analysis_enabled    = false;
-    ro_tracker_gran         = cache_line_size;
+    ro_tracker_gran         = 0;
     ro_tracker_entries      = (1 << 14);
+    ref_stream_entries      = 1024;
+    fs_word_size            = 4;
+    fs_report_lines         = 10;
+    stack_distance_enabled  = false;
+    sd_max_sets_log2        = 10;
+    sd_max_assoc            = 16;
+    prefetcher              = PREFETCH_NONE;
+    prefetch_degree         = 2;
+    prefetch_max_outstanding = 4;
+    prefetch_table_size     = 64;
+    prefetch_max_wait       = 256;
+    bus_width               = 0;
+    bus_addr_cycles         = 1;
+    c2c_latency             = 0;
+    snoop_filter            = SNOOP_FILTER_NONE;
+    snoop_filter_entries    = 4096;
+    sim_threads             = 1;
+    hit_fast_path           = false;
+    checkpoint_file         = NULL;
+    restore_file            = NULL;
+    checkpoint_cycle        = 0;
+    checkpoint_exit         = false;
+    restore_clear_stats     = false;
+    ref_source              = REF_SOURCE_TRACE;
+    stress_refs             = 1000000;
+    stress_lines            = 4;
+    stress_store_pct        = 30;
+    stress_seed             = 1;
+    stress_functional       = false;
+    synth_pattern           = SYNTH_PRIVATE;
+    synth_refs              = 1000000;
+    synth_lines             = 1024;
+    synth_store_pct         = 5;
+    synth_seed              = 1;
+    explore                 = false;
+    explore_lines           = 1;
+    explore_max_states      = 1 << 24;
+    explore_max_errors      = 10;
+    coherence_check         = false;
+    coherence_check_entries = 1 << 20;
+    sampling_enabled        = false;
+    sample_interval         = 100000;
+    sample_warmup           = 2000;
+    sample_size             = 1000;
 
     network_topology        = MESH;
 	express_link_len		= 4;
@@ -414,7 +558,86 @@ void Sim_settings::set_defaults (void)
 	data_graph = false;
 
     report_output           = OUTPUT_FMT_CSV;
+    stats_file              = NULL;
 
     trace_dir               = NULL;
 }
 
+/** Sets a single identifier from its textual value.  Used for the
+ *  "name value" lines of the config file and -o name=value overrides.  */
+void Sim_settings::set_option (const char *name, const char *value)
+{
+    setts *sett;
+    char *end;
+
+    for (sett = identifiers; sett->pointer != NULL; sett++)
+        if (!strcmp (sett->name, name))
+            break;
+
+    if (sett->pointer == NULL || sett->type == SETT_NONE)
+        fatal_error ("Settings: unknown or read-only setting %s\n", name);
+
+    if (sett->type == SETT_BOOL)
+    {
+        if (!strcmp (value, "true") || !strcmp (value, "1"))
+            *(bool *)sett->pointer = true;
+        else if (!strcmp (value, "false") || !strcmp (value, "0"))
+            *(bool *)sett->pointer = false;
+        else
+            fatal_error ("Settings: %s expects true/false, got %s\n", name, value);
+        return;
+    }
+
+    unsigned long long val = strtoull (value, &end, 0);
+    if (*value == '\0' || *end != '\0')
+        fatal_error ("Settings: %s expects a number, got %s\n", name, value);
+
+    switch (sett->type) {
+    case SETT_INT:   *(int *)sett->pointer = (int)val; break;
+    case SETT_UINT:  *(unsigned int *)sett->pointer = (unsigned int)val; break;
+    case SETT_LLONG: *(long long int *)sett->pointer = (long long int)val; break;
+    case SETT_ADDR:  *(paddr_t *)sett->pointer = (paddr_t)val; break;
+    case SETT_ENUM:  *(int *)sett->pointer = (int)val; break;
+    default:
+        fatal_error ("Settings: bad type for %s\n", name);
+    }
+
+    /** Keep the two line size settings in step.  */
+    if (!strcmp (name, "cache_line_size_log2"))
+        cache_line_size = 1 << cache_line_size_log2;
+    else if (!strcmp (name, "cache_line_size"))
+    {
+        if (!ISPOW2 (cache_line_size))
+            fatal_error ("Settings: cache_line_size must be a power of 2\n");
+        for (cache_line_size_log2 = 0; (1U << cache_line_size_log2) < cache_line_size; cache_line_size_log2++)
+            ;
+    }
+}
+
+/** Settings that default from others, once the config file and -o
+ *  overrides are in.  */
+void Sim_settings::derive_settings (void)
+{
+    if (ro_tracker_gran == 0)
+        ro_tracker_gran = cache_line_size;
+}
+
+/** Reads "name value" pairs following the node count in the config file.
+ *  Blank lines and lines starting with '#' are skipped.  */
+void Sim_settings::get_settings (FILE *config_file)
+{
+    char line[256];
+    char name[64];
+    char value[128];
+
+    while (fgets (line, sizeof (line), config_file))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        if (sscanf (line, "%63s %127s", name, value) != 2)
+            fatal_error ("Settings: malformed config line - %s", line);
+
+        set_option (name, value);
+    }
+}
@@ -4,9 +4,21 @@
 #include "enums.h"
 #include "types.h"
 
+/** How the value behind a setts pointer is stored.  */
+typedef enum {
+	SETT_NONE = 0,		// Not settable by name (arrays)
+	SETT_BOOL,
+	SETT_INT,
+	SETT_UINT,
+	SETT_LLONG,
+	SETT_ADDR,
+	SETT_ENUM
+} sett_type_t;
+
 typedef struct setts {
 	char name[50];
 	void *pointer;
+	sett_type_t type;
 } setts;
 
 /**
@@ -26,15 +38,20 @@ public:
     int                  num_mem_ctrls;
     int*                 mem_ctrl_array;
 
+    // Throughput report every heartrate cycles (0: never)
     unsigned int         heartrate;
 
 	bool 				 net_infinite_bw;
 	bool 				 sharer_forwarding;
 	bool  				 wait_on_inv_acks;
+	// Abort once a processor request waits watchdog_stall_cycles
 	bool 				 livelock_check;
+	int                  watchdog_stall_cycles;
     bool                 processor_affinity;
     bool                 mem_model_enabled;
     bool                 regression_test;
+    // Reference log for regression_test (-v), else <trace_dir>/<protocol>_validation.txt
+    char                 *regression_file;
 
     // SESC specific
 	signed long long int sesc_rabbit;
@@ -70,6 +87,8 @@ public:
 	int	                 l1_cache_size;
 	int	   	             l1_cache_assoc;
 	int                  l1_hit_time;
+	// Memory controller latency; at least 1 so an owning cache answers first
+	int                  mem_hit_time;
     int                  l1_mshrs;
 	replacement_policy_t l1_replacement_policy;
 	coherence_policy_t	 l1_coherence_policy;
@@ -123,11 +142,87 @@ public:
     bool                 train_on_loads;
     bool                 train_on_stores;
     int                  sel_rep_pred_threshold;
+    int                  sel_rep_pred_entries;
 
     // Sim analysis tools
     bool                 sim_analysis_enabled;
+    // 0 tracks read-only data at line granularity
     unsigned int         ro_tracker_gran;
     unsigned int         ro_tracker_entries;
+    unsigned int         ref_stream_entries;
+    unsigned int         fs_word_size;
+    unsigned int         fs_report_lines;
+    bool                 stack_distance_enabled;
+    unsigned int         sd_max_sets_log2;
+    unsigned int         sd_max_assoc;
+
+    // L1 prefetcher (0 none, 1 next-line, 2 stride, 3 stream buffer)
+    prefetcher_t         prefetcher;
+    int                  prefetch_degree;
+    int                  prefetch_max_outstanding;
+    int                  prefetch_table_size;
+    // Cycles a prefetch may wait for the bus before it is cancelled
+    // (0 never cancels)
+    int                  prefetch_max_wait;
+
+    // Bus bandwidth: bytes per data cycle (0 moves a line in one cycle),
+    // address phase cycles, and extra cycles for a cache-to-cache reply
+    int                  bus_width;
+    int                  bus_addr_cycles;
+    int                  c2c_latency;
+
+    // Bus snoop filter (0 none, 1 exact, 2 counting Bloom, 3 line state table)
+    snoop_filter_t       snoop_filter;
+    int                  snoop_filter_entries;
+
+    // Worker threads for the conservative parallel engine (1 is sequential)
+    int                  sim_threads;
+
+    // Serve runs of L1 hits at fetch time and skip the idle cycles they leave
+    bool                 hit_fast_path;
+
+    // Checkpoints (-c writes one at checkpoint_cycle, -r resumes from one)
+    char                 *checkpoint_file;
+    char                 *restore_file;
+    long long int        checkpoint_cycle;
+    bool                 checkpoint_exit;
+    bool                 restore_clear_stats;
+
+    // Online SWMR and load-value checking, over at most coherence_check_entries lines
+    bool                 coherence_check;
+    int                  coherence_check_entries;
+
+    // Processor references: 0 trace files, 1 random stress streams,
+    // 2 synthetic workload
+    ref_source_t         ref_source;
+    // Stress streams: per-core length, shared line count, store share, seed
+    long long int        stress_refs;
+    int                  stress_lines;
+    int                  stress_store_pct;
+    int                  stress_seed;
+    // Stress streams one reference at a time, stepping the bus directly
+    bool                 stress_functional;
+    // Synthetic workload: pattern, per-core length, lines per region,
+    // read-mostly store share, seed
+    synth_pattern_t      synth_pattern;
+    long long int        synth_refs;
+    int                  synth_lines;
+    int                  synth_store_pct;
+    int                  synth_seed;
+
+    // Exhaustive protocol state-space exploration over explore_lines lines
+    // (cores from -n), stopping after explore_max_errors distinct errors
+    bool                 explore;
+    int                  explore_lines;
+    int                  explore_max_states;
+    int                  explore_max_errors;
+
+    // Sampled simulation: fast-forward sample_interval references, then a
+    // detailed window of sample_warmup + sample_size (all cores together)
+    bool                 sampling_enabled;
+    int                  sample_interval;
+    int                  sample_warmup;
+    int                  sample_size;
 	bool				 data_graph;
 
 	// Network
@@ -141,6 +236,7 @@ public:
 	long long int		 sampling_interval;
 
 	sim_output_mode_t    report_output;
+	char                 *stats_file;
 
 	paddr_t              debug_addr;
     paddr_t              test_addr;
@@ -154,7 +250,9 @@ public:
     ~Sim_settings (void);
 
     void set_defaults (void);  
-  	void get_settings (void);
+  	void get_settings (FILE *config_file);
+    void set_option (const char *name, const char *value);
+    void derive_settings (void);
     void get_topology (void);
     void print_settings (void);
 };
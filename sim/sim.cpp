@@ -2,23 +2,50 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <strings.h>
+#include <sys/time.h>
 
+#include "checkpoint.h"
+#include "explorer.h"
 #include "hash_table.h"
 #include "processor.h"
 #include "memory.h"
 #include "module.h"
 #include "mreq.h"
+#include "predictor.h"
+#include "ref_source.h"
+#include "regression.h"
 #include "settings.h"
 #include "sim.h"
 #include "types.h"
+#include "watchdog.h"
 
+extern Simulator *Sim;
 extern Sim_settings settings;
 
+/** Most references batch_hits () reads ahead of one core's trace.  */
+#define HIT_BATCH_MAX 256
+
+bool fatal_error_throws = false;
+
 /** Fatal Error.  */
 void fatal_error (const char *fmt, ...)
 {
     va_list ap;
 
+    if (fatal_error_throws)
+    {
+        Sim_error error;
+
+        va_start (ap, fmt);
+        vsnprintf (error.message, sizeof (error.message), fmt, ap);
+        va_end (ap);
+        throw error;
+    }
+
+    /** The error must not vanish into the regression comparator.  */
+    if (regression_checker)
+        regression_checker->detach ();
+
     va_start (ap, fmt);
     vfprintf (stderr, fmt, ap);
     va_end (ap);
@@ -28,6 +55,22 @@ void fatal_error (const char *fmt, ...)
     exit (-1);
 }
 
+bool sim_log_muted = false;
+
+void sim_log (const char *fmt, ...)
+{
+    va_list ap;
+
+    if (sim_log_muted)
+        return;
+    va_start (ap, fmt);
+    if (sim_log_buffer)
+        sim_log_buffer->append (fmt, ap);
+    else
+        vfprintf (stderr, fmt, ap);
+    va_end (ap);
+}
+
 Simulator::Simulator ()
 {
     /** Seed random number generator.  */
@@ -36,25 +79,81 @@ Simulator::Simulator ()
     /** Set global_clock to cycle zero.  */
     global_clock = 0;
 
+    /** Stats hierarchy: sim.bus, sim.node<N>.{PR,L1,MC}.  */
+    stat_manager = new Sim_stat_manager ();
+
     /** Allocate bus.  */
     bus = new Bus ();
     assert (bus && "Sim error: Unable to alloc bus.");
+    stat_manager->root->add_child (bus->stats);
 
     Nd = new Node*[settings.num_nodes+1];
 
     /** Allocate processors.  */
     for (int node = 0; node < settings.num_nodes; node++)
     {
-        char trace_file[100];
-        sprintf (trace_file, "%s/p%d.trace", settings.trace_dir, node);
-
         Nd[node] = new Node (node);
-        Nd[node]->build_processor (trace_file);
+        Nd[node]->build_processor (Ref_source::create (node));
+        stat_manager->root->add_child (Nd[node]->stats);
     }
 
     /** Allocate memory controllers.  */
     Nd[settings.num_nodes] = new Node (settings.num_nodes);
     Nd[settings.num_nodes]->build_memory_controller ();
+    stat_manager->root->add_child (Nd[settings.num_nodes]->stats);
+
+    dueling = NULL;
+    if (settings.qsets_enabled)
+    {
+        dueling = new Set_dueling ();
+        stat_manager->root->add_child (dueling->stats);
+    }
+
+    /** Selective replication predictors, for the HYBRID protocol.  */
+    Predictor::build (Nd, settings.num_nodes, stat_manager->root, predictors);
+
+    analysis = NULL;
+    if (settings.sim_analysis_enabled)
+    {
+        analysis = new Sim_analysis ();
+        stat_manager->root->add_child (analysis->stats);
+    }
+
+    sd_profiler = NULL;
+    if (settings.stack_distance_enabled)
+    {
+        sd_profiler = new Stack_distance_profiler ();
+        stat_manager->root->add_child (sd_profiler->stats);
+    }
+
+    checker = NULL;
+    if (settings.coherence_check)
+    {
+        checker = new Coherence_checker (settings.num_nodes, settings.coherence_check_entries);
+        stat_manager->root->add_child (checker->stats);
+    }
+
+    parallel = NULL;
+    if (settings.sim_threads > 1)
+        parallel = new Parallel_engine (settings.sim_threads, settings.num_nodes);
+
+    sampler = NULL;
+    if (settings.sampling_enabled)
+    {
+        sampler = new Sampler ();
+        stat_manager->root->add_child (sampler->stats);
+    }
+
+    explorer = NULL;
+    if (settings.explore)
+        explorer = new Explorer ();
+
+    watchdog = NULL;
+    if (settings.livelock_check || settings.heartrate)
+        watchdog = new Watchdog ();
+
+    sync_tracker = new Sync_tracker ();
+    stat_manager->root->add_child (sync_tracker->stats);
 
     cache_misses = 0;
     silent_upgrades = 0;
@@ -64,10 +163,31 @@ Simulator::Simulator ()
 
 Simulator::~Simulator ()
 {
-    for (int i = 0; i < settings.num_nodes; i++)
+    if (parallel)
+        delete parallel;
+    if (sampler)
+        delete sampler;
+    if (explorer)
+        delete explorer;
+    if (watchdog)
+        delete watchdog;
+    delete sync_tracker;
+    if (checker)
+        delete checker;
+    for (int i = 0; i <= settings.num_nodes; i++)
         delete Nd[i];
 
     delete [] Nd;    
+    delete bus;
+    if (analysis)
+        delete analysis;
+    if (sd_profiler)
+        delete sd_profiler;
+    if (dueling)
+        delete dueling;
+    for (unsigned int i = 0; i < predictors.size (); i++)
+        delete predictors[i];
+    delete stat_manager;
 }
 
 void Simulator::dump_stats ()
@@ -81,41 +201,136 @@ void Simulator::dump_stats ()
     fprintf(stderr,"Cache Accesses:   %8ld accesses\n",cache_accesses);
     fprintf(stderr,"Silent Upgrades:  %8ld upgrades\n",silent_upgrades);
     fprintf(stderr,"$-to-$ Transfers: %8ld transfers\n",cache_to_cache_transfers);
+    bus->report (stderr);
+    if (sampler)
+        sampler->report (stderr);
+    sync_tracker->report (stderr);
+
+    /** The protocols bump the global counters directly; copy them into the
+     *  stats tree before it is emitted.  */
+    stat_manager->root->run_time->value = global_clock;
+    stat_manager->root->cache_misses->value = cache_misses;
+    stat_manager->root->cache_accesses->value = cache_accesses;
+    stat_manager->root->silent_upgrades->value = silent_upgrades;
+    stat_manager->root->cache_to_cache_transfers->value = cache_to_cache_transfers;
+
+    if (analysis)
+    {
+        analysis->finish ();
+        analysis->dump ();
+    }
+
+    if (sd_profiler)
+    {
+        sd_profiler->finish ();
+        sd_profiler->dump ();
+    }
+
+    stat_manager->dump (settings.report_output, settings.stats_file);
 }
 
 void Simulator::run ()
 {
     int sched;
     bool done;
+    bool checkpointed;
+    bool stress = (settings.ref_source == REF_SOURCE_STRESS);
+    bool synthetic = (settings.ref_source == REF_SOURCE_SYNTHETIC);
+    long long int refs = 0;
+    struct timeval start, end;
+    double seconds;
 
     /** This must match what's in enums.h.  */
-    const char *cp_str[9] = {"CACHE_PRO","MI_PRO","MSI_PRO","MESI_PRO",
-							 "MOESI_PRO","MOSI_PRO","MOESIF_PRO","NULL_PRO","MEM_PRO"};
+    const char *cp_str[12] = {"CACHE_PRO","MI_PRO","MSI_PRO","MESI_PRO",
+							 "MOESI_PRO","MOSI_PRO","MOESIF_PRO","DRAGON_PRO",
+							 "FIREFLY_PRO","HYBRID_PRO","NULL_PRO","MEM_PRO"};
 
     fprintf (stderr, "CSX290 Sim - Begins  ");
     fprintf (stderr, " Cores: %d", settings.num_nodes);
     fprintf (stderr, " Protocol: %s\n", cp_str[settings.protocol]);
 
+    /** The explorer drives the L1s itself; nothing is simulated.  */
+    if (explorer)
+    {
+        explorer->run ();
+        return;
+    }
+
+    /** Stress and synthetic runs are about throughput and the checkers,
+     *  not the log.  */
+    if (stress)
+    {
+        fprintf (stderr, "Stress test -- seed %d -- %lld references per core to %d lines, %d%% stores\n",
+                 settings.stress_seed, settings.stress_refs, settings.stress_lines,
+                 settings.stress_store_pct);
+        refs = settings.stress_refs * settings.num_nodes;
+    }
+    if (synthetic)
+    {
+        const char *pattern_str[6] = {"private streaming", "migratory", "producer-consumer",
+                                      "read-mostly", "lock contention", "false sharing"};
+
+        fprintf (stderr, "Synthetic workload -- %s, seed %d -- %lld references per core, %d lines\n",
+                 pattern_str[settings.synth_pattern], settings.synth_seed, settings.synth_refs,
+                 settings.synth_lines);
+        refs = settings.synth_refs * settings.num_nodes;
+    }
+    if (stress || synthetic)
+    {
+        sim_log_muted = true;
+        gettimeofday (&start, NULL);
+    }
+
+    if (watchdog)
+        watchdog->start ();
+
     /** Main run loop.  */
     sched = 0;
     done = false;
+    checkpointed = (settings.checkpoint_file == NULL);
+    if (stress && settings.stress_functional)
+    {
+        run_functional ();
+        done = true;
+    }
     while (!done)
     {
+        if (!checkpointed && global_clock >= (timestamp_t)settings.checkpoint_cycle)
+        {
+            save_checkpoint (settings.checkpoint_file);
+            checkpointed = true;
+            if (settings.checkpoint_exit)
+                break;
+        }
+
+        if (sampler && sampler->phase == SAMPLE_FUNCTIONAL)
+            sampler->fast_forward ();
+
         bus->tick ();
 
-        for (int i = 0; i <= settings.num_nodes; i++)
-            Nd[i]->tick_cache ();
+        if (parallel)
+            parallel->cycle ();
+        else
+        {
+            for (int i = 0; i <= settings.num_nodes; i++)
+                Nd[i]->tick_cache ();
 
-        for (int i = 0; i <= settings.num_nodes; i++)
-            Nd[i]->tick_pr ();
+            for (int i = 0; i <= settings.num_nodes; i++)
+                Nd[i]->tick_pr ();
 
-        for (int i = 0; i <= settings.num_nodes; i++)
-            Nd[i]->tick_mc ();
-        
-        for (int i = 0; i <= settings.num_nodes; i++)
-			Nd[i]->tock_pr ();
+            for (int i = 0; i <= settings.num_nodes; i++)
+                Nd[i]->tick_mc ();
+
+            for (int i = 0; i <= settings.num_nodes; i++)
+                Nd[i]->tock_pr ();
+        }
 
         global_clock++;
+        sync_tracker->end_cycle ();
+        if (settings.hit_fast_path)
+            skip_idle_cycles ();
+        if (sampler)
+            sampler->end_cycle ();
 
         done = true;
         for (int i = 0; i < settings.num_nodes; i++)
@@ -124,12 +339,263 @@ void Simulator::run ()
                 done = false;
                 break;        
             }
+
+        if (watchdog && global_clock >= watchdog->next_check)
+            watchdog->check ();
+    }
+
+    if (stress || synthetic)
+    {
+        gettimeofday (&end, NULL);
+        seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+        sim_log_muted = false;
+        fprintf (stderr, "%s -- %lld references, %lld cycles in %.2f s (%.2f M references/s)\n",
+                 stress ? "Stress test" : "Synthetic workload", refs, (long long int)global_clock, seconds,
+                 seconds > 0 ? refs / seconds / 1e6 : 0.0);
     }
 
     fprintf(stderr,"\n\nSimulation Finished\n");
     dump_stats();
 }
 
+/** stress_functional: a random core at a time runs its next reference to
+ *  completion, with the L1s, bus and memory controller stepped directly as
+ *  in sampling's fast-forward.  There is no processor timing, so requests
+ *  from different cores never overlap; the detailed runs cover those
+ *  races.  Every transaction still goes through the coherence checker.  */
+void Simulator::run_functional (void)
+{
+    Ref_rng rng (((uint64_t)settings.stress_seed << 16) + settings.num_nodes);
+    int live = settings.num_nodes;
+
+    /** Memory latency only stretches the idle cycles of each miss.  */
+    get_MC (settings.num_nodes)->hit_time = 1;
+
+    while (live)
+    {
+        int node = rng.below (settings.num_nodes);
+        Processor *pr = get_PR (node);
+
+        if (pr->end_of_trace)
+            continue;
+        if (!Sampler::functional_reference (node))
+            live--;
+    }
+}
+
+/** Everything the run loop carries from one cycle to the next.  The
+ *  profilers and the prefetcher keep large private tables that are not
+ *  saved, so they cannot be checkpointed.  */
+void Simulator::checkpoint (Checkpoint *ckpt)
+{
+    if (analysis || sd_profiler || checker || settings.prefetcher != PREFETCH_NONE)
+        fatal_error ("Checkpoint: not supported with the analysis, stack distance, "
+                     "coherence check or prefetcher options\n");
+
+    ckpt->check (settings.num_nodes, "num_nodes");
+    ckpt->check (settings.protocol, "protocol");
+    ckpt->check (settings.cache_line_size_log2, "cache_line_size_log2");
+    ckpt->check (settings.snoop_filter, "snoop_filter");
+
+    ckpt->io (global_clock);
+    ckpt->io (cache_misses);
+    ckpt->io (cache_accesses);
+    ckpt->io (silent_upgrades);
+    ckpt->io (cache_to_cache_transfers);
+
+    bus->checkpoint (ckpt);
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        get_PR (i)->checkpoint (ckpt);
+        get_L1 (i)->checkpoint (ckpt);
+    }
+    get_MC (settings.num_nodes)->checkpoint (ckpt);
+
+    ckpt->check (predictors.size (), "selective replication predictors");
+    for (unsigned int i = 0; i < predictors.size (); i++)
+        predictors[i]->checkpoint (ckpt);
+    ckpt->check (dueling != NULL, "qsets_enabled");
+    if (dueling)
+        dueling->checkpoint (ckpt);
+    sync_tracker->checkpoint (ckpt);
+
+    stat_manager->root->checkpoint (ckpt);
+}
+
+void Simulator::save_checkpoint (const char *file)
+{
+    Checkpoint ckpt (file, true);
+
+    checkpoint (&ckpt);
+    fprintf (stderr, "Checkpoint written to %s at cycle %lld\n", file, (long long int)global_clock);
+}
+
+/** Must be called on a freshly built Simulator.  */
+void Simulator::restore_checkpoint (const char *file)
+{
+    Checkpoint ckpt (file, false);
+
+    checkpoint (&ckpt);
+    if (fgetc (ckpt.fp) != EOF)
+        fatal_error ("Checkpoint: %s has trailing data\n", file);
+
+    if (settings.restore_clear_stats)
+    {
+        stat_manager->root->clear ();
+        cache_misses = 0;
+        cache_accesses = 0;
+        silent_upgrades = 0;
+        cache_to_cache_transfers = 0;
+    }
+    fprintf (stderr, "Checkpoint restored from %s at cycle %lld\n", file, (long long int)global_clock);
+}
+
+/** hit_fast_path: if the next bus tick can neither grant nor deliver
+ *  anything, and no L1 has work, first let batch_hits () retire the runs
+ *  of hits the cores can serve on their own.  Then nothing happens until a
+ *  fast hit completes or the memory controller's DATA is due.  Jump the
+ *  clock to the earliest of those, charging the skipped cycles to the
+ *  per-cycle stats.  */
+void Simulator::skip_idle_cycles (void)
+{
+    Memory_controller *mc = get_MC (settings.num_nodes);
+    timestamp_t wake = 0;
+    timestamp_t skipped;
+    bool waiting = false;
+
+    if (!bus->quiet ())
+        return;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = get_PR (i);
+        Hash_table *l1 = get_L1 (i);
+
+        if (l1->proc_request || l1->deferred_request || l1->local_accesses ||
+            pr->inbound_request || pr->inbound_request_buf)
+            return;
+    }
+    batch_hits ();
+
+    if (mc->request_in_progress)
+    {
+        wake = mc->data_time;
+        waiting = true;
+    }
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = get_PR (i);
+
+        if (!pr->outstanding_request && !pr->end_of_trace)
+            return;
+        if (!pr->fast_hit_pending)
+            continue;
+        if (!waiting || pr->fast_hit_time < wake)
+            wake = pr->fast_hit_time;
+        waiting = true;
+    }
+    if (!waiting || wake <= global_clock)
+        return;
+
+    skipped = wake - global_clock;
+    if (bus->current_request)
+    {
+        if (checker)
+            checker->check_swmr (bus->current_request->addr);
+        delete bus->current_request;
+        bus->current_request = NULL;
+    }
+    for (timestamp_t t = 0; t < skipped; t++)
+        bus->stats->queue_depth->add (bus->pending_requests.size () + bus->prefetch_requests.size ());
+    for (int i = 0; i < settings.num_nodes; i++)
+        if (get_PR (i)->outstanding_request && !get_PR (i)->fast_hit_pending)
+            get_PR (i)->stats->stall_cycles->add (skipped);
+
+    global_clock = wake;
+}
+
+/** Called with the bus quiet and the L1s idle.  A hit changes nothing
+ *  another core can see, so each core that is about to fetch may serve its
+ *  next run of hits now, as long as each is served before the first cycle
+ *  the bus could deliver a snoop.  That horizon is the memory controller's
+ *  DATA, if one is due, or a grant two cycles after the earliest fetch
+ *  that is not a hit, on any core.  Cores stalled on a miss only fetch
+ *  after its DATA, and blocked ones after another core's sync operation,
+ *  so neither can come sooner.  */
+void Simulator::batch_hits (void)
+{
+    Memory_controller *mc = get_MC (settings.num_nodes);
+    timestamp_t horizon = ~(timestamp_t)0;
+    int busy = 0;
+
+    batch_start.resize (settings.num_nodes);
+    batch_run.assign (settings.num_nodes, -1);
+
+    if (bus->request_in_progress)
+    {
+        if (!mc->request_in_progress)
+            return;
+        horizon = mc->data_time + 1;
+    }
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = get_PR (i);
+
+        if (pr->hold)
+            return;
+        if (pr->fast_hit_pending)
+            batch_start[i] = pr->fast_hit_time;
+        else if (!pr->outstanding_request && !pr->end_of_trace && !pr->sync_op)
+            batch_start[i] = global_clock;
+        else
+            continue;
+        batch_run[i] = 0;
+        busy++;
+    }
+
+    if (parallel)
+        parallel->run_nodes (batch_scan, busy > 1);
+    else
+        for (int i = 0; i < settings.num_nodes; i++)
+            batch_scan (i);
+
+    busy = 0;
+    for (int i = 0; i < settings.num_nodes; i++)
+        if (batch_run[i] >= 0 && batch_start[i] + 2 * batch_run[i] + 2 < horizon)
+            horizon = batch_start[i] + 2 * batch_run[i] + 2;
+
+    /** The k-th hit reaches the L1 at start + 2k + 1.  */
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        if (batch_run[i] <= 0 || horizon < batch_start[i] + 2)
+            batch_run[i] = 0;
+        else if ((timestamp_t)batch_run[i] > (horizon - batch_start[i]) / 2)
+            batch_run[i] = (horizon - batch_start[i]) / 2;
+        if (batch_run[i])
+            busy++;
+    }
+
+    if (parallel)
+        parallel->run_nodes (batch_retire, busy > 1);
+    else
+        for (int i = 0; i < settings.num_nodes; i++)
+            batch_retire (i);
+}
+
+void Simulator::batch_scan (int node)
+{
+    if (Sim->batch_run[node] >= 0)
+        Sim->batch_run[node] = Sim->get_PR (node)->hit_run (HIT_BATCH_MAX);
+}
+
+void Simulator::batch_retire (int node)
+{
+    if (Sim->batch_run[node] > 0)
+        Sim->get_PR (node)->retire_hits (Sim->batch_start[node], Sim->batch_run[node]);
+}
+
 Processor* Simulator::get_PR (int node)
 {
     return (Processor *)(Nd[node]->mod[PR_M]);
@@ -153,9 +619,45 @@ void Simulator::dump_processors (void)
     }
 }
 
+/** nodeID's processor request, if any: how far it got, where it waits,
+ *  and its line in every cache.  */
 void Simulator::dump_outstanding_requests (int nodeID)
 {
-    assert (nodeID < settings.num_nodes);   
+    Processor *pr;
+    Hash_table *l1;
+    LIST<Mreq *>::iterator it;
+
+    assert (nodeID < settings.num_nodes);
+    pr = get_PR (nodeID);
+    l1 = get_L1 (nodeID);
+
+    if (!pr->outstanding_request)
+    {
+        fprintf (stderr, "PR %d: nothing outstanding%s\n", nodeID, pr->done () ? " (done)" : "");
+        return;
+    }
+
+    fprintf (stderr, "PR %d: waiting %lld cycles -- ", nodeID, (long long int)(global_clock - pr->issue_time));
+    pr->preq.dump ();
+    if (l1->proc_request)
+        fprintf (stderr, "  not yet taken by the L1\n");
+    if (l1->deferred_request)
+        fprintf (stderr, "  L1 waiting on a prefetch of the line\n");
+    for (it = bus->pending_requests.begin (); it != bus->pending_requests.end (); it++)
+        if ((*it)->src_mid == l1->moduleID)
+            fprintf (stderr, "  queued on the bus: %s 0x%llx\n",
+                     Mreq::message_t_str[(*it)->msg], (unsigned long long int)(*it)->addr);
+    for (it = bus->prefetch_requests.begin (); it != bus->prefetch_requests.end (); it++)
+        if ((*it)->src_mid == l1->moduleID)
+            fprintf (stderr, "  prefetch queued on the bus: 0x%llx\n", (unsigned long long int)(*it)->addr);
+    if (bus->request_in_progress && bus->granted_preq == &pr->preq)
+        fprintf (stderr, "  holds the bus, %s\n", bus->data_reply ? "DATA reply posted" : "no DATA reply yet");
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        fprintf (stderr, "  Cache %d: ", i);
+        dump_cache_block (i, pr->preq.addr);
+    }
 }
 
 void Simulator::dump_cache_block (int nodeID, paddr_t addr)
@@ -2,20 +2,44 @@
 #define SIM_H
 
 #include "bus.h"
+#include "coherence_checker.h"
 #include "enums.h"
 #include "node.h"
+#include "parallel.h"
+#include "sampler.h"
+#include "set_dueling.h"
 #include "settings.h"
+#include "sim_analysis.h"
+#include "stack_distance.h"
+#include "stat_engine.h"
+#include "sync.h"
 #include "types.h"
 
 #define Global_Clock Sim->global_clock
 
+class Checkpoint;
+class Explorer;
 class Node;
+class Predictor;
 class Processor;
+class Watchdog;
 class Hash_table;
 class L1_cache;
 class Memory_controller;
 
 void fatal_error (const char *fmt, ...) __attribute__ ((noreturn));
+/** While set, fatal_error () throws a Sim_error with the message instead
+ *  of exiting, so the state explorer can report the error and go on.  */
+extern bool fatal_error_throws;
+class Sim_error {
+public:
+    char message[256];
+};
+/** Simulation log line: stderr, or this thread's node buffer in a
+ *  parallel phase.  */
+void sim_log (const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
+/** Drops sim_log lines, for sampling's functional fast-forward.  */
+extern bool sim_log_muted;
 
 class Simulator {
 public:
@@ -27,9 +51,58 @@ public:
     Node **Nd;
     Bus *bus;
 
+    Sim_stat_manager *stat_manager;
+
+    /** Sharing pattern profiler, NULL unless sim_analysis_enabled.  */
+    Sim_analysis *analysis;
+
+    /** Miss-rate curves, NULL unless stack_distance_enabled.  */
+    Stack_distance_profiler *sd_profiler;
+
+    /** Coherence policy set dueling, NULL unless qsets_enabled.  */
+    Set_dueling *dueling;
+
+    /** Selective replication predictors (shared between nodes unless
+     *  sel_rep_pred_scope is node), empty unless sel_rep_pred is set.  */
+    VECTOR<Predictor *> predictors;
+
+    /** Parallel engine, NULL unless sim_threads > 1.  */
+    Parallel_engine *parallel;
+
+    /** Coherence invariant checker, NULL unless coherence_check.  */
+    Coherence_checker *checker;
+
+    /** Sampled simulation, NULL unless sampling_enabled.  */
+    Sampler *sampler;
+
+    /** Protocol state-space explorer, NULL unless explore.  */
+    Explorer *explorer;
+
+    /** Stall watchdog and heartbeat, NULL unless livelock_check or
+     *  heartrate.  */
+    Watchdog *watchdog;
+
+    /** Atomic and lock hand-off stats.  */
+    Sync_tracker *sync_tracker;
+
     /** Run/Fini for simulator.  */
     void run (void);
+    void run_functional (void);
     void dump_stats (void);
+    void skip_idle_cycles (void);
+    /** hit_fast_path: each core's next fetch time and run of hits to
+     *  serve in the batch batch_hits () is retiring, -1 if it sits the
+     *  batch out.  The per-node steps can run on the parallel engine.  */
+    VECTOR<timestamp_t> batch_start;
+    VECTOR<int> batch_run;
+    void batch_hits (void);
+    static void batch_scan (int node);
+    static void batch_retire (int node);
+
+    /** Checkpoints of the whole simulator state.  */
+    void save_checkpoint (const char *file);
+    void restore_checkpoint (const char *file);
+    void checkpoint (Checkpoint *ckpt);
 
     /** Accessor functions */
     Processor *get_PR (int node);
@@ -44,8 +117,7 @@ public:
     unsigned long int cache_misses;
     unsigned long int cache_accesses;
     unsigned long int silent_upgrades;
-    unsigned long int cache_to_cache_transfers;
-};
+    unsigned long int cache_to_cache_transfers;};
 
 #endif
 
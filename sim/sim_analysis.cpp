@@ -1,141 +1,499 @@
+#include <assert.h>
+#include <stdio.h>
+
 #include "mreq.h"
+#include "preq.h"
+#include "settings.h"
 #include "sim.h"
 #include "sim_analysis.h"
+#include "stat_engine.h"
 
-extern Simulator Sim;
+extern Simulator *Sim;
+extern Sim_settings settings;
 
 /********************************************************************************
- * Reference stream tracker.  
+ * Reference stream tracker.
  ********************************************************************************/
-Ref_stream_entry::Ref_stream_entry (message_t msg, paddr_t addr, ModuleID mid)
-{
-    this->msg = msg;
-    this->addr = addr;
-    this->mid = mid;
-}
-
-Ref_stream_entry::~Ref_stream_entry ()
-{
-}
-
 Reference_stream_tracker::Reference_stream_tracker (paddr_t ref_stream_addr, int ref_stream_max)
 {
-    this->ref_stream_addr = ref_stream_addr;
+    assert (ref_stream_max > 0);
+
+    this->ref_stream_addr = ref_stream_addr & ~((paddr_t)settings.cache_line_size - 1);
     this->ref_stream_max = ref_stream_max;
-    ref_stream.clear ();
+    this->ref_stream_cnt = 0;
+    this->dropped = 0;
+    this->ref_stream = new Ref_stream_entry[ref_stream_max];
 }
 
 Reference_stream_tracker::~Reference_stream_tracker ()
 {
+    delete [] ref_stream;
 }
 
-void Reference_stream_tracker::update (Mreq *request)
+void Reference_stream_tracker::update (int nodeID, message_t msg, paddr_t addr)
 {
-    if (ref_stream.size () >= ref_stream_max)
+    if (addr != ref_stream_addr)
+        return;
+
+    if (ref_stream_cnt >= ref_stream_max)
+    {
+        dropped++;
         return;
+    }
 
-    ref_stream.push_back (new Ref_stream_entry (request->msg, request->addr, request->src_mid));
+    ref_stream[ref_stream_cnt].time = Global_Clock;
+    ref_stream[ref_stream_cnt].nodeID = nodeID;
+    ref_stream[ref_stream_cnt].msg = msg;
+    ref_stream_cnt++;
 }
 
 void Reference_stream_tracker::dump ()
 {
-    LIST<Ref_stream_entry*>::iterator it;
-
     fprintf (stderr, "Reference Stream Tracker:\n");
-    fprintf (stderr, "Addr: 0x%llx\n", (unsigned long long)ref_stream_addr);
+    fprintf (stderr, "Addr: 0x%llx  References: %u  Dropped: %llu\n",
+             (unsigned long long)ref_stream_addr, ref_stream_cnt, dropped);
 
-    for (it = ref_stream.begin (); it != ref_stream.end (); it++)
-    {
-        //fprintf (stderr, "Msg: %s Node: %d", Mreq::message_t_str[it->second->msg], it->second->mid.NodeID);
-    }
+    for (unsigned int i = 0; i < ref_stream_cnt; i++)
+        fprintf (stderr, "  %10llu  node %3d  %s\n", (unsigned long long)ref_stream[i].time,
+                 ref_stream[i].nodeID, Mreq::message_t_str[ref_stream[i].msg]);
 }
 
 /********************************************************************************
- * Read-only data tracker.  
+ * Read-only data tracker.
  ********************************************************************************/
 Read_only_tracker::Read_only_tracker (int granularity, int max_entries)
+    : table (max_entries)
 {
-    assert ((unsigned int)granularity >= Sim.settings.cache_line_size);
-    assert (max_entries > 0);
+    assert ((unsigned int)granularity >= settings.cache_line_size);
+    assert (ISPOW2 (granularity));
 
     /** Calculate granularity mask.  */
     this->addr_mask = ~0x0;
     for ( ;granularity > 1; granularity /= 2)
         this->addr_mask <<= 1;
-
-    this->max_entries = max_entries;
-    this->read_only_map.clear ();
 }
 
 Read_only_tracker::~Read_only_tracker ()
 {
-    this->read_only_map.clear ();
 }
 
-void Read_only_tracker::update (Mreq *request)
+/** Returns false if the region could not be tracked.  */
+bool Read_only_tracker::update (message_t msg, paddr_t addr)
 {
-    paddr_t addr;
-    MAP<paddr_t, bool>::iterator it;
-
-    addr = request->addr & addr_mask;
+    Read_only_entry *entry;
 
-    it = read_only_map.find (addr);
+    entry = table.insert (addr & addr_mask);
+    if (entry == NULL)
+        return false;
 
-    /** Not found.  */
-    if (it == read_only_map.end ())
-    {
-        if (read_only_map.size () < max_entries)
-            read_only_map[addr] = (request->msg == C_GETIS) ? true : false;
-    }
-    else
-    {
-        if (request->msg == C_GETIM || request->msg == C_GETSM)
-            it->second = false;
-    }        
+    if (msg == STORE)
+        entry->read_only = false;
+    return true;
 }
 
 int Read_only_tracker::get_nentries (void)
 {
-    return read_only_map.size ();
+    return table.size ();
 }
 
 int Read_only_tracker::get_ro_cnt (void)
 {
     unsigned int ro_cnt;
-    MAP<paddr_t, bool>::iterator it;
 
     ro_cnt = 0;
-    for (it = read_only_map.begin (); it != read_only_map.end (); it++)
-        if (it->second == true)
+    for (unsigned int i = 0; i < table.slots (); i++)
+        if (table.valid (i) && table.entry (i)->read_only)
             ro_cnt++;
-    
+
     return ro_cnt;
 }
 
 int Read_only_tracker::get_write_cnt (void)
 {
-    unsigned int write_cnt;
-    MAP<paddr_t, bool>::iterator it;
+    return get_nentries () - get_ro_cnt ();
+}
 
-    write_cnt = 0;
-    for (it = read_only_map.begin (); it != read_only_map.end (); it++)
-        if (it->second == false)
-            write_cnt++;
+/********************************************************************************
+ * Sharing pattern tracker.
+ ********************************************************************************/
+Sharing_entry::Sharing_entry ()
+{
+    reader_mask = 0;
+    writer_mask = 0;
+    last_accessor = -1;
+    last_writer = -1;
+    handoff_read = false;
+    accesses = 0;
+    writes = 0;
+    bus_transactions = 0;
+    handoffs = 0;
+    migratory_handoffs = 0;
+    writer_changes = 0;
+}
 
-    return write_cnt;
+Sharing_pattern_tracker::Sharing_pattern_tracker (int max_entries)
+    : table (max_entries)
+{
 }
 
-void Read_only_tracker::dump (void)
+Sharing_pattern_tracker::~Sharing_pattern_tracker ()
 {
-    unsigned int ro_cnt;
-    unsigned int write_cnt;
-    MAP<paddr_t, bool>::iterator it;
+}
 
-    ro_cnt = 0;
-    write_cnt = 0;
-    for (it = read_only_map.begin (); it != read_only_map.end (); it++)
-        if (it->second)
-            ro_cnt++;
-        else
-            write_cnt++;
+/** Returns false if the line could not be tracked.  */
+bool Sharing_pattern_tracker::update (int nodeID, message_t msg, paddr_t addr)
+{
+    Sharing_entry *entry;
+    uint64_t bit;
+
+    entry = table.insert (addr);
+    if (entry == NULL)
+        return false;
+
+    /** More than 64 cores fold onto the same bit.  */
+    bit = 1ULL << (nodeID & 63);
+    entry->accesses++;
+
+    if (entry->last_accessor != -1 && entry->last_accessor != nodeID)
+    {
+        entry->handoffs++;
+        entry->handoff_read = (msg == LOAD);
+    }
+    else if (msg == STORE && entry->handoff_read)
+    {
+        /** Read then write by the core that just took the line over.  */
+        entry->migratory_handoffs++;
+        entry->handoff_read = false;
+    }
+
+    if (msg == STORE)
+    {
+        entry->writes++;
+        entry->writer_mask |= bit;
+        if (entry->last_writer != -1 && entry->last_writer != nodeID)
+            entry->writer_changes++;
+        entry->last_writer = nodeID;
+    }
+    else
+    {
+        entry->reader_mask |= bit;
+    }
+
+    entry->last_accessor = nodeID;
+    return true;
+}
+
+bool Sharing_pattern_tracker::bus_transaction (paddr_t addr)
+{
+    Sharing_entry *entry;
+
+    entry = table.lookup (addr);
+    if (entry == NULL)
+        return false;
+
+    entry->bus_transactions++;
+    return true;
+}
+
+sharing_class_t Sharing_pattern_tracker::classify (Sharing_entry *entry)
+{
+    int sharers;
+    int writers;
+    int widely_shared;
+
+    sharers = __builtin_popcountll (entry->reader_mask | entry->writer_mask);
+    writers = __builtin_popcountll (entry->writer_mask);
+    widely_shared = (settings.num_nodes / 2 > 3) ? settings.num_nodes / 2 : 3;
+
+    if (sharers <= 1)
+        return SHARING_PRIVATE;
+    if (writers == 0)
+        return SHARING_READ_ONLY;
+
+    /** Most handoffs are a read followed by a write from the new core.  */
+    if (writers >= 2 && entry->handoffs > 0 &&
+        2 * entry->migratory_handoffs >= entry->handoffs)
+        return SHARING_MIGRATORY;
+
+    if (writers == 1)
+        return SHARING_PRODUCER_CONSUMER;
+    if (sharers >= widely_shared)
+        return SHARING_WIDELY_SHARED;
+
+    return SHARING_OTHER;
+}
+
+/********************************************************************************
+ * False sharing tracker.
+ ********************************************************************************/
+False_sharing_tracker::False_sharing_tracker (int word_size, int max_entries)
+    : table (max_entries)
+{
+    if (word_size <= 0 || !ISPOW2 (word_size) || (unsigned int)word_size > settings.cache_line_size)
+        fatal_error ("False_sharing_tracker: invalid fs_word_size %d\n", word_size);
+
+    word_size_log2 = 0;
+    for ( ;word_size > 1; word_size /= 2)
+        word_size_log2++;
+
+    stats = new False_sharing_stat_engine ("false_sharing");
+}
+
+False_sharing_tracker::~False_sharing_tracker ()
+{
+    delete stats;
+}
+
+/** Lines with more than 64 words fold onto the same bit.  */
+uint64_t False_sharing_tracker::word_bit (paddr_t byte_addr)
+{
+    paddr_t offset = byte_addr & ((paddr_t)settings.cache_line_size - 1);
+    return 1ULL << ((offset >> word_size_log2) & 63);
+}
+
+/** Called for every processor reference, before the cache sees it.  */
+bool False_sharing_tracker::update (int nodeID, message_t msg, paddr_t byte_addr)
+{
+    False_sharing_entry *entry;
+    False_sharing_core *core;
+    bool created;
+    uint64_t bit;
+
+    entry = table.insert (byte_addr & ~((paddr_t)settings.cache_line_size - 1), &created);
+    if (entry == NULL)
+        return false;
+
+    if (created)
+    {
+        entry->first_core = cores.size ();
+        cores.resize (cores.size () + settings.num_nodes);
+    }
+
+    bit = word_bit (byte_addr);
+    core = &cores[entry->first_core + nodeID];
+
+    if (!core->has_copy)
+    {
+        /** The copy is (re)fetched; has_copy is set when the bus grants
+         *  the request.  */
+        if (core->invalidated)
+        {
+            entry->coherence_misses++;
+            stats->coherence_misses->inc ();
+
+            if (core->modified & bit)
+            {
+                stats->true_sharing_misses->inc ();
+            }
+            else
+            {
+                entry->false_sharing_misses++;
+                stats->false_sharing_misses->inc ();
+            }
+            core->invalidated = false;
+        }
+        core->touched = 0;
+    }
+    core->touched |= bit;
+
+    if (msg == STORE)
+        for (int i = 0; i < settings.num_nodes; i++)
+            if (cores[entry->first_core + i].invalidated)
+                cores[entry->first_core + i].modified |= bit;
+
+    return true;
+}
+
+/** A GETS or GETM from nodeID was granted the bus; a GETM takes every
+ *  other copy away.  */
+void False_sharing_tracker::invalidate (int nodeID, message_t msg, paddr_t byte_addr)
+{
+    False_sharing_entry *entry;
+    False_sharing_core *core;
+    uint64_t bit;
+
+    entry = table.lookup (byte_addr & ~((paddr_t)settings.cache_line_size - 1));
+    if (entry == NULL)
+        return;
+
+    cores[entry->first_core + nodeID].has_copy = true;
+    if (msg != GETM)
+        return;
+
+    bit = word_bit (byte_addr);
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        core = &cores[entry->first_core + i];
+        if (i == nodeID || !core->has_copy)
+            continue;
+
+        entry->invalidations++;
+        stats->invalidations->inc ();
+        if (!(core->touched & bit))
+        {
+            entry->false_invalidations++;
+            stats->false_invalidations->inc ();
+        }
+
+        core->has_copy = false;
+        core->invalidated = true;
+        core->modified = bit;
+    }
+}
+
+/** Print the lines with the most avoidable misses.  */
+void False_sharing_tracker::dump (unsigned int num_lines)
+{
+    VECTOR<pair<unsigned long long, unsigned int> > offenders;
+    False_sharing_entry *entry;
+
+    fprintf (stderr, "\nFalse Sharing (%d byte words):\n", 1 << word_size_log2);
+    fprintf (stderr, "  Invalidations:        %10llu (%llu with disjoint words)\n",
+             (unsigned long long)stats->invalidations->value,
+             (unsigned long long)stats->false_invalidations->value);
+    fprintf (stderr, "  Coherence misses:     %10llu\n", (unsigned long long)stats->coherence_misses->value);
+    fprintf (stderr, "  True sharing misses:  %10llu\n", (unsigned long long)stats->true_sharing_misses->value);
+    fprintf (stderr, "  Avoidable misses:     %10llu\n", (unsigned long long)stats->false_sharing_misses->value);
+
+    for (unsigned int i = 0; i < table.slots (); i++)
+        if (table.valid (i) && table.entry (i)->false_sharing_misses)
+            offenders.push_back (make_pair (table.entry (i)->false_sharing_misses, i));
+
+    if (offenders.empty ())
+        return;
+
+    sort (offenders.rbegin (), offenders.rend ());
+
+    fprintf (stderr, "  %-18s %10s %10s %10s %10s\n",
+             "line", "avoidable", "coherence", "invals", "disjoint");
+    for (unsigned int i = 0; i < offenders.size () && i < num_lines; i++)
+    {
+        entry = table.entry (offenders[i].second);
+        fprintf (stderr, "  0x%-16llx %10llu %10llu %10llu %10llu\n",
+                 (unsigned long long)table.tag (offenders[i].second),
+                 entry->false_sharing_misses, entry->coherence_misses,
+                 entry->invalidations, entry->false_invalidations);
+    }
+}
+
+/********************************************************************************
+ * Sim analysis profiler.
+ ********************************************************************************/
+Sim_analysis::Sim_analysis ()
+{
+    ro_tracker = new Read_only_tracker (settings.ro_tracker_gran, settings.ro_tracker_entries);
+    sharing_tracker = new Sharing_pattern_tracker (settings.ro_tracker_entries);
+    false_sharing_tracker = new False_sharing_tracker (settings.fs_word_size, settings.ro_tracker_entries);
+
+    ref_stream_tracker = NULL;
+    if (settings.debug_addr)
+        ref_stream_tracker = new Reference_stream_tracker (settings.debug_addr,
+                                                           settings.ref_stream_entries);
+
+    stats = new Sharing_stat_engine ("analysis");
+    stats->add_child (false_sharing_tracker->stats);
+}
+
+Sim_analysis::~Sim_analysis ()
+{
+    delete ro_tracker;
+    delete sharing_tracker;
+    delete false_sharing_tracker;
+    if (ref_stream_tracker)
+        delete ref_stream_tracker;
+    delete stats;
+}
+
+void Sim_analysis::processor_access (int nodeID, message_t msg, paddr_t byte_addr)
+{
+    paddr_t addr;
+    bool tracked;
+
+    addr = byte_addr & ~((paddr_t)settings.cache_line_size - 1);
+    tracked = ro_tracker->update (msg, addr);
+    tracked = sharing_tracker->update (nodeID, msg, addr) && tracked;
+    tracked = false_sharing_tracker->update (nodeID, msg, byte_addr) && tracked;
+    if (!tracked)
+        stats->untracked_accesses->inc ();
+
+    if (ref_stream_tracker)
+        ref_stream_tracker->update (nodeID, msg, addr);
+}
+
+void Sim_analysis::bus_transaction (Mreq *request)
+{
+    if (request->msg == DATA)
+        return;
+
+    sharing_tracker->bus_transaction (request->addr);
+
+    /** Requests carry the byte address of the reference behind them.  */
+    if (request->src_mid.module_index == L1_M && (request->msg == GETS || request->msg == GETM))
+        false_sharing_tracker->invalidate (request->src_mid.nodeID, request->msg,
+                                           request->preq ? request->preq->addr : request->addr);
+}
+
+/** Classify every tracked line and fill in the stats.  */
+void Sim_analysis::finish (void)
+{
+    Line_table<Sharing_entry> *table = &sharing_tracker->table;
+    Sharing_entry *entry;
+    sharing_class_t cls;
+
+    for (int i = 0; i < SHARING_CLASS_NUM; i++)
+    {
+        stats->lines[i]->value = 0;
+        stats->accesses[i]->value = 0;
+        stats->bus_transactions[i]->value = 0;
+    }
+
+    for (unsigned int i = 0; i < table->slots (); i++)
+    {
+        if (!table->valid (i))
+            continue;
+
+        entry = table->entry (i);
+        cls = sharing_tracker->classify (entry);
+        stats->lines[cls]->inc ();
+        stats->accesses[cls]->add (entry->accesses);
+        stats->bus_transactions[cls]->add (entry->bus_transactions);
+    }
+
+    stats->read_only_lines->value = ro_tracker->get_ro_cnt ();
+    stats->written_lines->value = ro_tracker->get_write_cnt ();
+}
+
+void Sim_analysis::dump (void)
+{
+    counter_t total_lines = 0;
+    counter_t total_bus = 0;
+
+    for (int i = 0; i < SHARING_CLASS_NUM; i++)
+    {
+        total_lines += stats->lines[i]->value;
+        total_bus += stats->bus_transactions[i]->value;
+    }
+
+    fprintf (stderr, "\nSharing Patterns:\n");
+    fprintf (stderr, "  %-18s %10s %7s %12s %12s %7s\n",
+             "pattern", "lines", "%", "accesses", "bus_reqs", "%");
+    for (int i = 0; i < SHARING_CLASS_NUM; i++)
+        fprintf (stderr, "  %-18s %10llu %6.1f%% %12llu %12llu %6.1f%%\n",
+                 Sharing_stat_engine::sharing_class_str[i],
+                 (unsigned long long)stats->lines[i]->value,
+                 total_lines ? 100.0 * stats->lines[i]->value / total_lines : 0.0,
+                 (unsigned long long)stats->accesses[i]->value,
+                 (unsigned long long)stats->bus_transactions[i]->value,
+                 total_bus ? 100.0 * stats->bus_transactions[i]->value / total_bus : 0.0);
+
+    fprintf (stderr, "Read-only regions: %d of %d (%d bytes each)\n",
+             ro_tracker->get_ro_cnt (), ro_tracker->get_nentries (), settings.ro_tracker_gran);
+    if (stats->untracked_accesses->value)
+        fprintf (stderr, "Untracked accesses: %llu (raise ro_tracker_entries)\n",
+                 (unsigned long long)stats->untracked_accesses->value);
+
+    false_sharing_tracker->dump (settings.fs_report_lines);
+
+    if (ref_stream_tracker)
+        ref_stream_tracker->dump ();
 }
@@ -1,25 +1,27 @@
 #ifndef SIM_ANALYSIS_H
 #define SIM_ANALYSIS_H
 
+#include "enums.h"
+#include "line_table.h"
 #include "module.h"
 #include "types.h"
+#include "../protocols/messages.h"
 
 using namespace std;
 
+class False_sharing_stat_engine;
 class Mreq;
-class ModuleID;
+class Sharing_stat_engine;
 
-/** 
- * Reference stream tracker.
+/**
+ * Reference stream tracker.  Records the processor references to one
+ * line (settings.debug_addr) into a preallocated buffer.
  */
 class Ref_stream_entry {
 public:
-    Ref_stream_entry (message_t msg, paddr_t addr, ModuleID mid);
-    ~Ref_stream_entry ();
-
-    paddr_t addr;
-    ModuleID mid;
-    message_t msg;   
+    timestamp_t time;
+    int nodeID;
+    message_t msg;
 };
 
 class Reference_stream_tracker {
@@ -28,30 +30,154 @@ public:
     ~Reference_stream_tracker ();
 
     unsigned int ref_stream_max;
+    unsigned int ref_stream_cnt;
+    unsigned long long dropped;
     paddr_t ref_stream_addr;
-    LIST<Ref_stream_entry*> ref_stream;
+    Ref_stream_entry *ref_stream;
 
-    void update (Mreq *request);
+    void update (int nodeID, message_t msg, paddr_t addr);
     void dump ();
 };
 
-/** 
- * Read-only data tracker.
+/**
+ * Read-only data tracker.  Tracks, at ro_tracker_gran granularity,
+ * whether a region has ever been written.
  */
+class Read_only_entry {
+public:
+    Read_only_entry () : read_only (true) {}
+    bool read_only;
+};
+
 class Read_only_tracker {
 public:
     Read_only_tracker (int granularity, int max_entries);
     ~Read_only_tracker ();
 
     paddr_t addr_mask;
-    unsigned int max_entries;
-    MAP<paddr_t, bool> read_only_map;
+    Line_table<Read_only_entry> table;
 
-    void update (Mreq *request);
+    bool update (message_t msg, paddr_t addr);
     int get_nentries (void);
     int get_ro_cnt (void);
     int get_write_cnt (void);
-    void dump ();
+};
+
+/**
+ * Sharing pattern tracker.  Per line it keeps which cores read and wrote
+ * it (folded into 64 bits), who touched it last, and how often it changed
+ * hands, which is enough to classify it at the end of the run.
+ */
+class Sharing_entry {
+public:
+    Sharing_entry ();
+
+    uint64_t reader_mask;
+    uint64_t writer_mask;
+    int last_accessor;
+    int last_writer;
+
+    /** Set when a core other than last_accessor reads the line; a store
+     *  by the same core next makes the handoff migratory.  */
+    bool handoff_read;
+
+    unsigned long long accesses;
+    unsigned long long writes;
+    unsigned long long bus_transactions;
+    unsigned long long handoffs;
+    unsigned long long migratory_handoffs;
+    unsigned long long writer_changes;
+};
+
+class Sharing_pattern_tracker {
+public:
+    Sharing_pattern_tracker (int max_entries);
+    ~Sharing_pattern_tracker ();
+
+    Line_table<Sharing_entry> table;
+
+    bool update (int nodeID, message_t msg, paddr_t addr);
+    bool bus_transaction (paddr_t addr);
+    sharing_class_t classify (Sharing_entry *entry);
+};
+
+/**
+ * False sharing tracker.  Per line and core it records which words the
+ * core touched since it last obtained a copy.  A GETM from another core
+ * invalidates the copy; it is a false invalidation if the writer's word
+ * is not one the victim touched.  The victim's next reference is a
+ * coherence miss, which is avoidable (false sharing) unless it touches a
+ * word some other core wrote after the invalidation.  Caches are infinite,
+ * so copies are only ever lost to invalidations.
+ */
+class False_sharing_core {
+public:
+    False_sharing_core ()
+        : touched (0), modified (0), has_copy (false), invalidated (false) {}
+
+    uint64_t touched;       // Words referenced while holding the copy
+    uint64_t modified;      // Words written by others since invalidation
+    bool has_copy;
+    bool invalidated;
+};
+
+class False_sharing_entry {
+public:
+    False_sharing_entry ()
+        : first_core (0), invalidations (0), false_invalidations (0),
+          coherence_misses (0), false_sharing_misses (0) {}
+
+    /** Index of this line's num_nodes cores in False_sharing_tracker::cores.  */
+    unsigned int first_core;
+
+    unsigned long long invalidations;
+    unsigned long long false_invalidations;
+    unsigned long long coherence_misses;
+    unsigned long long false_sharing_misses;
+};
+
+class False_sharing_tracker {
+public:
+    False_sharing_tracker (int word_size, int max_entries);
+    ~False_sharing_tracker ();
+
+    int word_size_log2;
+    Line_table<False_sharing_entry> table;
+    VECTOR<False_sharing_core> cores;
+
+    False_sharing_stat_engine *stats;
+
+    bool update (int nodeID, message_t msg, paddr_t byte_addr);
+    void invalidate (int nodeID, message_t msg, paddr_t byte_addr);
+    void dump (unsigned int num_lines);
+
+private:
+    uint64_t word_bit (paddr_t byte_addr);
+};
+
+/**
+ * Sim analysis profiler.  Built only when sim_analysis_enabled is set;
+ * the processor and bus hooks feed the trackers above, and finish ()
+ * folds them into the "analysis" stats group.
+ */
+class Sim_analysis {
+public:
+    Sim_analysis ();
+    ~Sim_analysis ();
+
+    Read_only_tracker *ro_tracker;
+    Reference_stream_tracker *ref_stream_tracker;
+    Sharing_pattern_tracker *sharing_tracker;
+    False_sharing_tracker *false_sharing_tracker;
+
+    Sharing_stat_engine *stats;
+
+    /** Hooks.  */
+    void processor_access (int nodeID, message_t msg, paddr_t byte_addr);
+    void bus_transaction (Mreq *request);
+
+    void finish (void);
+    void dump (void);
 };
 
 #endif // SIM_ANALYSIS_H
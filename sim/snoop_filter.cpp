@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <string.h>
+
+#include "settings.h"
+#include "sim.h"
+#include "snoop_filter.h"
+#include "stat_engine.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+/********************************************************************************
+ * Snoop filter base.
+ ********************************************************************************/
+Snoop_filter::Snoop_filter ()
+{
+    stats = new Stat_engine ("snoop_filter");
+    lookups            = stats->add_counter ("lookups", "snoops checked against the filter");
+    filtered           = stats->add_counter ("filtered", "snoop lookups saved in the L1s");
+    useless_deliveries = stats->add_counter ("useless_deliveries", "delivered snoops that found the line invalid");
+}
+
+Snoop_filter::~Snoop_filter ()
+{
+    delete stats;
+}
+
+Snoop_filter *Snoop_filter::create (snoop_filter_t type)
+{
+    switch (type) {
+    case SNOOP_FILTER_NONE:  return NULL;
+    case SNOOP_FILTER_EXACT: return new Exact_snoop_filter ();
+    case SNOOP_FILTER_BLOOM: return new Bloom_snoop_filter (settings.snoop_filter_entries);
+    case SNOOP_FILTER_STATE_TABLE: return new State_table_snoop_filter ();
+    default:
+        fatal_error ("Snoop_filter: unknown snoop_filter %d\n", type);
+    }
+}
+
+/********************************************************************************
+ * Exact snoop filter.
+ ********************************************************************************/
+Exact_snoop_filter::Exact_snoop_filter ()
+{
+    if (settings.num_nodes > 64)
+        fatal_error ("Exact_snoop_filter: at most 64 nodes\n");
+}
+
+void Exact_snoop_filter::insert (paddr_t addr, int nodeID)
+{
+    presence[addr] |= 1ULL << nodeID;
+}
+
+void Exact_snoop_filter::remove (paddr_t addr, int nodeID)
+{
+    MAP<paddr_t, uint64_t>::iterator it = presence.find (addr);
+
+    assert (it != presence.end ());
+    it->second &= ~(1ULL << nodeID);
+    if (!it->second)
+        presence.erase (it);
+}
+
+bool Exact_snoop_filter::may_hold (paddr_t addr, int nodeID)
+{
+    MAP<paddr_t, uint64_t>::iterator it = presence.find (addr);
+
+    return it != presence.end () && (it->second & (1ULL << nodeID));
+}
+
+/********************************************************************************
+ * Counting Bloom snoop filter.
+ ********************************************************************************/
+Bloom_snoop_filter::Bloom_snoop_filter (int entries)
+{
+    if (entries <= 0)
+        fatal_error ("Bloom_snoop_filter: invalid snoop_filter_entries %d\n", entries);
+
+    this->entries = entries;
+    this->counters = new unsigned short[entries * settings.num_nodes];
+    memset (counters, 0, entries * settings.num_nodes * sizeof (unsigned short));
+}
+
+Bloom_snoop_filter::~Bloom_snoop_filter ()
+{
+    delete [] counters;
+}
+
+unsigned int Bloom_snoop_filter::hash (paddr_t addr, int i)
+{
+    paddr_t line = addr >> settings.cache_line_size_log2;
+
+    if (i == 0)
+        return line % entries;
+    return ((line * 0x9E3779B97F4A7C15ULL) >> 32) % entries;
+}
+
+void Bloom_snoop_filter::insert (paddr_t addr, int nodeID)
+{
+    unsigned short *node_counters = &counters[nodeID * entries];
+
+    for (int i = 0; i < 2; i++)
+    {
+        assert (node_counters[hash (addr, i)] < 0xffff);
+        node_counters[hash (addr, i)]++;
+    }
+}
+
+void Bloom_snoop_filter::remove (paddr_t addr, int nodeID)
+{
+    unsigned short *node_counters = &counters[nodeID * entries];
+
+    for (int i = 0; i < 2; i++)
+    {
+        assert (node_counters[hash (addr, i)] > 0);
+        node_counters[hash (addr, i)]--;
+    }
+}
+
+bool Bloom_snoop_filter::may_hold (paddr_t addr, int nodeID)
+{
+    unsigned short *node_counters = &counters[nodeID * entries];
+
+    return node_counters[hash (addr, 0)] && node_counters[hash (addr, 1)];
+}
+
+/********************************************************************************
+ * Line state table snoop filter.
+ ********************************************************************************/
+State_table_snoop_filter::State_table_snoop_filter ()
+{
+    table = new Line_state_table (settings.num_nodes);
+    mask = new Line_state_table::mask_t[table->mask_words];
+    mask_addr = 0;
+    mask_valid = false;
+
+    holders = stats->add_average ("holders", "L1s holding the line per bus transaction");
+    owned   = stats->add_counter ("owned", "bus transactions for a line some L1 can write");
+}
+
+State_table_snoop_filter::~State_table_snoop_filter ()
+{
+    delete [] mask;
+    delete table;
+}
+
+/** A request from an L1 that does not hold the line yet: it must see
+ *  its own transaction and anything else for the line until it does.  */
+void State_table_snoop_filter::insert (paddr_t addr, int nodeID)
+{
+    if (table->get (addr, nodeID) == PERM_INVALID)
+        set_state (addr, nodeID, PERM_PENDING);
+}
+
+void State_table_snoop_filter::remove (paddr_t addr, int nodeID)
+{
+    set_state (addr, nodeID, PERM_INVALID);
+}
+
+void State_table_snoop_filter::set_state (paddr_t addr, int nodeID, perm_t perm)
+{
+    table->set (addr, nodeID, perm);
+    if (addr == mask_addr)
+        mask_valid = false;
+}
+
+bool State_table_snoop_filter::may_hold (paddr_t addr, int nodeID)
+{
+    if (!mask_valid || addr != mask_addr)
+    {
+        table->cores_in_state (addr, PERM_INVALID, false, mask);
+        mask_addr = addr;
+        mask_valid = true;
+    }
+    return (mask[nodeID / 64] >> (nodeID % 64)) & 1;
+}
+
+void State_table_snoop_filter::transaction (paddr_t addr)
+{
+    holders->add (table->num_holders (addr));
+    if (table->any_owner (addr))
+        owned->inc ();
+}
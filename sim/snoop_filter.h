@@ -0,0 +1,100 @@
+#ifndef SNOOP_FILTER_H_
+#define SNOOP_FILTER_H_
+
+#include "enums.h"
+#include "line_state_table.h"
+#include "types.h"
+
+using namespace std;
+
+class Stat_average;
+class Stat_counter;
+class Stat_engine;
+
+/**
+ * Base class for bus snoop filters.  The filter is inclusive of every L1
+ * line that is valid or has a transaction in flight: an L1 adds a line
+ * when its processor (or prefetcher) first uses it and removes it when a
+ * snoop leaves the line invalid.  The bus only delivers a request to the
+ * L1s the filter says may hold the line, plus the requester; DATA goes
+ * only to its destination.  The memory controllers see everything.
+ */
+class Snoop_filter {
+public:
+    Snoop_filter ();
+    virtual ~Snoop_filter ();
+
+    Stat_engine *stats;
+    Stat_counter *lookups;
+    Stat_counter *filtered;
+    Stat_counter *useless_deliveries;
+
+    virtual void insert (paddr_t addr, int nodeID) =0;
+    virtual void remove (paddr_t addr, int nodeID) =0;
+    virtual bool may_hold (paddr_t addr, int nodeID) =0;
+
+    /** The L1 nodeID's permission for addr after a processor request or
+     *  a snoop.  Only filters that keep full state need it.  */
+    virtual void set_state (paddr_t addr, int nodeID, perm_t perm) {}
+    /** A bus transaction for addr was granted.  */
+    virtual void transaction (paddr_t addr) {}
+
+    static Snoop_filter *create (snoop_filter_t type);
+};
+
+/** Exact presence vector per tracked line.  */
+class Exact_snoop_filter : public Snoop_filter {
+public:
+    Exact_snoop_filter ();
+
+    MAP<paddr_t, uint64_t> presence;
+
+    void insert (paddr_t addr, int nodeID);
+    void remove (paddr_t addr, int nodeID);
+    bool may_hold (paddr_t addr, int nodeID);
+};
+
+/** Per-node counting Bloom filter with two hash functions.  Removal is
+ *  exact because each L1 inserts a line at most once, so false positives
+ *  only come from aliasing.  */
+class Bloom_snoop_filter : public Snoop_filter {
+public:
+    Bloom_snoop_filter (int entries);
+    ~Bloom_snoop_filter ();
+
+    int entries;
+    unsigned short *counters;
+
+    void insert (paddr_t addr, int nodeID);
+    void remove (paddr_t addr, int nodeID);
+    bool may_hold (paddr_t addr, int nodeID);
+
+private:
+    unsigned int hash (paddr_t addr, int i);
+};
+
+/** Exact filter backed by the SoA Line_state_table, with no limit on the
+ *  number of cores.  The delivery mask for a line is computed with one
+ *  row compare and reused for every L1 until a core's state for that
+ *  line changes.  */
+class State_table_snoop_filter : public Snoop_filter {
+public:
+    State_table_snoop_filter ();
+    ~State_table_snoop_filter ();
+
+    Line_state_table *table;
+    Line_state_table::mask_t *mask;
+    paddr_t mask_addr;
+    bool mask_valid;
+
+    Stat_average *holders;
+    Stat_counter *owned;
+
+    void insert (paddr_t addr, int nodeID);
+    void remove (paddr_t addr, int nodeID);
+    bool may_hold (paddr_t addr, int nodeID);
+    void set_state (paddr_t addr, int nodeID, perm_t perm);
+    void transaction (paddr_t addr);
+};
+
+#endif // SNOOP_FILTER_H_
@@ -0,0 +1,344 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "mreq.h"
+#include "settings.h"
+#include "sim.h"
+#include "stack_distance.h"
+#include "stat_engine.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+static const paddr_t SD_EMPTY = ~(paddr_t)0;
+
+/** Starting sizes; both double as the footprint needs.  */
+#define SD_TREE_SLOTS (1 << 16)
+#define SD_LINES (1 << 12)
+
+/********************************************************************************
+ * Fenwick tree.
+ ********************************************************************************/
+Sd_fenwick::Sd_fenwick ()
+{
+    capacity = 0;
+    tree = NULL;
+    reset (SD_TREE_SLOTS, 0);
+}
+
+Sd_fenwick::~Sd_fenwick ()
+{
+    delete [] tree;
+}
+
+void Sd_fenwick::reset (uint64_t capacity, uint64_t count)
+{
+    assert (count <= capacity);
+
+    if (capacity != this->capacity)
+    {
+        delete [] tree;
+        tree = new int[capacity + 1];
+        this->capacity = capacity;
+    }
+    memset (tree, 0, (capacity + 1) * sizeof (int));
+
+    for (uint64_t i = 1; i <= capacity; i++)
+    {
+        uint64_t j = i + (i & (~i + 1));
+
+        tree[i] += (i <= count);
+        if (j <= capacity)
+            tree[j] += tree[i];
+    }
+}
+
+void Sd_fenwick::set (uint64_t t, int delta)
+{
+    assert (t > 0 && t <= capacity);
+
+    for ( ; t <= capacity; t += t & (~t + 1))
+        tree[t] += delta;
+}
+
+uint64_t Sd_fenwick::prefix (uint64_t t)
+{
+    uint64_t sum = 0;
+
+    if (t > capacity)
+        t = capacity;
+    for ( ; t > 0; t -= t & (~t + 1))
+        sum += tree[t];
+    return sum;
+}
+
+/********************************************************************************
+ * Stack distance profile.
+ ********************************************************************************/
+Sd_profile::Sd_profile (int max_sets_log2, int max_assoc)
+    : last_ref (SD_LINES)
+{
+    this->max_sets_log2 = max_sets_log2;
+    this->max_assoc = max_assoc;
+    this->refs = 0;
+    this->cold_misses = 0;
+    this->coherence_misses = 0;
+    this->now = 0;
+    memset (fa_hist, 0, sizeof (fa_hist));
+
+    set_hits = new uint64_t*[max_sets_log2 + 1];
+    stacks = new paddr_t*[max_sets_log2 + 1];
+    for (int s = 0; s <= max_sets_log2; s++)
+    {
+        set_hits[s] = new uint64_t[max_assoc];
+        memset (set_hits[s], 0, max_assoc * sizeof (uint64_t));
+
+        stacks[s] = new paddr_t[(1 << s) * max_assoc];
+        for (int i = 0; i < (1 << s) * max_assoc; i++)
+            stacks[s][i] = SD_EMPTY;
+    }
+}
+
+Sd_profile::~Sd_profile ()
+{
+    for (int s = 0; s <= max_sets_log2; s++)
+    {
+        delete [] set_hits[s];
+        delete [] stacks[s];
+    }
+    delete [] set_hits;
+    delete [] stacks;
+}
+
+/** Number the live lines 1..n in reference order and restart the tree
+ *  after them, doubling it if they would fill more than half.  */
+void Sd_profile::renumber (void)
+{
+    VECTOR<pair<uint64_t, unsigned int> > order;
+    uint64_t capacity = tree.capacity;
+
+    for (unsigned int i = 0; i < last_ref.slots (); i++)
+        if (last_ref.valid (i) && *last_ref.entry (i))
+            order.push_back (make_pair (*last_ref.entry (i), i));
+    sort (order.begin (), order.end ());
+
+    for (unsigned int k = 0; k < order.size (); k++)
+        *last_ref.entry (order[k].second) = k + 1;
+
+    while (2 * order.size () > capacity)
+        capacity *= 2;
+    tree.reset (capacity, order.size ());
+    now = order.size ();
+}
+
+void Sd_profile::access (paddr_t line)
+{
+    uint64_t *last;
+    paddr_t index = line >> settings.cache_line_size_log2;
+
+    if (now == tree.capacity)
+        renumber ();
+    refs++;
+    now++;
+
+    /** Fully associative.  */
+    last = last_ref.lookup (line);
+    if (!last)
+    {
+        cold_misses++;
+        if (last_ref.full ())
+            last_ref.resize (2 * last_ref.size ());
+        last = last_ref.insert (line);
+    }
+    else if (*last == 0)
+    {
+        coherence_misses++;
+    }
+    else
+    {
+        uint64_t dist = tree.prefix (now - 1) - tree.prefix (*last);
+        fa_hist[dist ? 64 - __builtin_clzll (dist) : 0]++;
+        tree.set (*last, -1);
+    }
+    tree.set (now, 1);
+    *last = now;
+
+    /** Set associative, move to front of each set's LRU stack.  */
+    for (int s = 0; s <= max_sets_log2; s++)
+    {
+        paddr_t *stack = &stacks[s][(index & ((1 << s) - 1)) * max_assoc];
+        int p;
+
+        for (p = 0; p < max_assoc && stack[p] != line; p++)
+            ;
+        if (p < max_assoc)
+            set_hits[s][p]++;
+        else
+            p = max_assoc - 1;
+
+        memmove (&stack[1], &stack[0], p * sizeof (paddr_t));
+        stack[0] = line;
+    }
+}
+
+bool Sd_profile::invalidate (paddr_t line)
+{
+    uint64_t *last = last_ref.lookup (line);
+    paddr_t index = line >> settings.cache_line_size_log2;
+
+    if (!last || *last == 0)
+        return false;
+
+    tree.set (*last, -1);
+    *last = 0;
+
+    for (int s = 0; s <= max_sets_log2; s++)
+    {
+        paddr_t *stack = &stacks[s][(index & ((1 << s) - 1)) * max_assoc];
+
+        for (int p = 0; p < max_assoc; p++)
+            if (stack[p] == line)
+            {
+                memmove (&stack[p], &stack[p + 1], (max_assoc - p - 1) * sizeof (paddr_t));
+                stack[max_assoc - 1] = SD_EMPTY;
+                break;
+            }
+    }
+    return true;
+}
+
+/** Misses of a fully associative LRU cache of lines (a power of two).  */
+uint64_t Sd_profile::fa_misses (uint64_t lines)
+{
+    uint64_t hits = 0;
+
+    for (int b = 0; b < 65 && (b == 0 || (1ULL << (b - 1)) < lines); b++)
+        hits += fa_hist[b];
+    return refs - hits;
+}
+
+uint64_t Sd_profile::set_misses (int sets_log2, int assoc)
+{
+    uint64_t hits = 0;
+
+    assert (sets_log2 <= max_sets_log2 && assoc <= max_assoc);
+    for (int p = 0; p < assoc; p++)
+        hits += set_hits[sets_log2][p];
+    return refs - hits;
+}
+
+/********************************************************************************
+ * Miss-rate curve profiler.
+ ********************************************************************************/
+Stack_distance_profiler::Stack_distance_profiler ()
+{
+    if (!ISPOW2 (settings.sd_max_assoc) || settings.sd_max_assoc == 0)
+        fatal_error ("Stack_distance_profiler: sd_max_assoc must be a power of two\n");
+    if (settings.sd_max_sets_log2 > 20)
+        fatal_error ("Stack_distance_profiler: sd_max_sets_log2 too large\n");
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        plain.push_back (new Sd_profile (settings.sd_max_sets_log2, settings.sd_max_assoc));
+        coherent.push_back (new Sd_profile (settings.sd_max_sets_log2, settings.sd_max_assoc));
+    }
+
+    stats = new Stat_engine ("stack_distance");
+    refs             = stats->add_counter ("refs", "processor references profiled");
+    cold_misses      = stats->add_counter ("cold_misses", "first references to a line");
+    invalidations    = stats->add_counter ("invalidations", "profiled lines removed by another core's GETM");
+    coherence_misses = stats->add_counter ("coherence_misses", "re-references after an invalidation");
+}
+
+Stack_distance_profiler::~Stack_distance_profiler ()
+{
+    for (unsigned int i = 0; i < plain.size (); i++)
+    {
+        delete plain[i];
+        delete coherent[i];
+    }
+    delete stats;
+}
+
+void Stack_distance_profiler::processor_access (int nodeID, paddr_t addr)
+{
+    plain[nodeID]->access (addr);
+    coherent[nodeID]->access (addr);
+}
+
+void Stack_distance_profiler::bus_transaction (Mreq *request)
+{
+    if (request->msg != GETM)
+        return;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+        if (i != request->src_mid.nodeID && coherent[i]->invalidate (request->addr))
+            invalidations->inc ();
+}
+
+void Stack_distance_profiler::finish (void)
+{
+    refs->value = 0;
+    cold_misses->value = 0;
+    coherence_misses->value = 0;
+
+    for (unsigned int i = 0; i < coherent.size (); i++)
+    {
+        refs->add (coherent[i]->refs);
+        cold_misses->add (coherent[i]->cold_misses);
+        coherence_misses->add (coherent[i]->coherence_misses);
+    }
+}
+
+/** Miss ratio over all cores for every power-of-two size and
+ *  associativity the profiles cover.  */
+void Stack_distance_profiler::dump_curve (const char *title, VECTOR<Sd_profile *> &profiles)
+{
+    int max_assoc_log2 = __builtin_ctz (settings.sd_max_assoc);
+    uint64_t total_refs = 0;
+
+    for (unsigned int i = 0; i < profiles.size (); i++)
+        total_refs += profiles[i]->refs;
+    if (total_refs == 0)
+        return;
+
+    fprintf (stderr, "\n%s miss ratio:\n  %10s", title, "size");
+    for (int a = 0; a <= max_assoc_log2; a++)
+        fprintf (stderr, " %5d-way", 1 << a);
+    fprintf (stderr, " %9s\n", "full");
+
+    for (int l = 0; l <= (int)settings.sd_max_sets_log2 + max_assoc_log2; l++)
+    {
+        uint64_t misses;
+
+        fprintf (stderr, "  %9lluB", (unsigned long long)settings.cache_line_size << l);
+        for (int a = 0; a <= max_assoc_log2; a++)
+        {
+            int s = l - a;
+
+            if (s < 0 || s > (int)settings.sd_max_sets_log2)
+            {
+                fprintf (stderr, " %9s", "-");
+                continue;
+            }
+
+            misses = 0;
+            for (unsigned int i = 0; i < profiles.size (); i++)
+                misses += profiles[i]->set_misses (s, 1 << a);
+            fprintf (stderr, " %9.4f", (double)misses / total_refs);
+        }
+
+        misses = 0;
+        for (unsigned int i = 0; i < profiles.size (); i++)
+            misses += profiles[i]->fa_misses (1ULL << l);
+        fprintf (stderr, " %9.4f\n", (double)misses / total_refs);
+    }
+}
+
+void Stack_distance_profiler::dump (void)
+{
+    dump_curve ("Trace-only (no coherence)", plain);
+    dump_curve ("Coherence-aware", coherent);
+}
@@ -0,0 +1,108 @@
+#ifndef STACK_DISTANCE_H_
+#define STACK_DISTANCE_H_
+
+#include "line_table.h"
+#include "types.h"
+#include "../protocols/messages.h"
+
+using namespace std;
+
+class Mreq;
+class Stat_counter;
+class Stat_engine;
+
+/**
+ * Fenwick tree over reference numbers.  A slot is set while it holds the
+ * most recent reference to some line, so the number of set slots between
+ * two references is the number of distinct lines touched in between.
+ */
+class Sd_fenwick {
+public:
+    Sd_fenwick ();
+    ~Sd_fenwick ();
+
+    uint64_t capacity;
+
+    /** Slots 1..count set, the rest clear, in linear time.  */
+    void reset (uint64_t capacity, uint64_t count);
+    void set (uint64_t t, int delta);
+    uint64_t prefix (uint64_t t);
+
+private:
+    int *tree;
+};
+
+/**
+ * LRU stack distances for one reference stream.  Fully associative
+ * distances come from the Fenwick tree; set-associative ones from short
+ * per-set LRU stacks kept for every power-of-two number of sets, so one
+ * pass yields the miss ratio of every size and associativity.
+ *
+ * Reference numbers run until the tree is full and are then renumbered
+ * 1..n over the n lines still live, keeping their order, so memory goes
+ * with the footprint rather than the trace length.
+ */
+class Sd_profile {
+public:
+    Sd_profile (int max_sets_log2, int max_assoc);
+    ~Sd_profile ();
+
+    int max_sets_log2;
+    int max_assoc;
+
+    uint64_t refs;
+    uint64_t cold_misses;
+    uint64_t coherence_misses;
+
+    /** Fully associative distances, bucket b holds [2^(b-1), 2^b).  */
+    uint64_t fa_hist[65];
+
+    /** set_hits[s][p]: hits at LRU position p with 2^s sets.  */
+    uint64_t **set_hits;
+
+    void access (paddr_t line);
+    bool invalidate (paddr_t line);
+
+    uint64_t fa_misses (uint64_t lines);
+    uint64_t set_misses (int sets_log2, int assoc);
+
+private:
+    uint64_t now;
+    Line_table<uint64_t> last_ref;   // 0 once invalidated
+    Sd_fenwick tree;
+    paddr_t **stacks;
+
+    void renumber (void);
+};
+
+/**
+ * Miss-rate curve profiler.  Every core has a plain profile of its
+ * reference stream and a coherent one in which other cores' GETMs remove
+ * the line, so coherence misses show up at every cache size.
+ */
+class Stack_distance_profiler {
+public:
+    Stack_distance_profiler ();
+    ~Stack_distance_profiler ();
+
+    VECTOR<Sd_profile *> plain;
+    VECTOR<Sd_profile *> coherent;
+
+    Stat_engine *stats;
+    Stat_counter *refs;
+    Stat_counter *cold_misses;
+    Stat_counter *invalidations;
+    Stat_counter *coherence_misses;
+
+    /** Hooks.  */
+    void processor_access (int nodeID, paddr_t addr);
+    void bus_transaction (Mreq *request);
+
+    void finish (void);
+    void dump (void);
+
+private:
+    void dump_curve (const char *title, VECTOR<Sd_profile *> &profiles);
+};
+
+#endif // STACK_DISTANCE_H_
@@ -0,0 +1,570 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "mreq.h"
+#include "preq.h"
+#include "sim.h"
+#include "stat_engine.h"
+
+extern Sim_settings settings;
+
+static void print_indent (FILE *fp, int indent)
+{
+    for (int i = 0; i < indent; i++)
+        fputs ("  ", fp);
+}
+
+/** Text reports align on the full dotted path of the stat.  */
+static void print_path (FILE *fp, const char *prefix, const char *name)
+{
+    char path[256];
+
+    snprintf (path, sizeof (path), "%s%s", prefix, name);
+    fprintf (fp, "%-48s", path);
+}
+
+/************************************************************
+ * Individual stats.
+ ************************************************************/
+Stat::Stat (const char *name, const char *desc)
+{
+    this->name = strdup (name);
+    this->desc = strdup (desc);
+}
+
+Stat::~Stat ()
+{
+    free (name);
+    free (desc);
+}
+
+Stat_counter::Stat_counter (const char *name, const char *desc)
+    : Stat (name, desc)
+{
+    value = 0;
+}
+
+void Stat_counter::clear (void)
+{
+    value = 0;
+}
+
+void Stat_counter::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (value);
+}
+
+void Stat_counter::print_text (FILE *fp, const char *prefix)
+{
+    print_path (fp, prefix, name);
+    fprintf (fp, " %16llu  # %s\n", (unsigned long long)value, desc);
+}
+
+void Stat_counter::print_csv (FILE *fp, const char *prefix)
+{
+    fprintf (fp, "%s%s,counter,%llu\n", prefix, name, (unsigned long long)value);
+}
+
+void Stat_counter::print_json (FILE *fp, int indent)
+{
+    print_indent (fp, indent);
+    fprintf (fp, "\"%s\": %llu", name, (unsigned long long)value);
+}
+
+Stat_average::Stat_average (const char *name, const char *desc)
+    : Stat (name, desc)
+{
+    samples = 0;
+    sum = 0.0;
+}
+
+void Stat_average::clear (void)
+{
+    samples = 0;
+    sum = 0.0;
+}
+
+void Stat_average::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->io (samples);
+    ckpt->io (sum);
+}
+
+void Stat_average::print_text (FILE *fp, const char *prefix)
+{
+    print_path (fp, prefix, name);
+    fprintf (fp, " %16.3f  # %s (%llu samples)\n", get_mean (), desc,
+             (unsigned long long)samples);
+}
+
+void Stat_average::print_csv (FILE *fp, const char *prefix)
+{
+    fprintf (fp, "%s%s.mean,average,%.6f\n", prefix, name, get_mean ());
+    fprintf (fp, "%s%s.samples,average,%llu\n", prefix, name, (unsigned long long)samples);
+}
+
+void Stat_average::print_json (FILE *fp, int indent)
+{
+    print_indent (fp, indent);
+    fprintf (fp, "\"%s\": {\"mean\": %.6f, \"samples\": %llu}", name, get_mean (),
+             (unsigned long long)samples);
+}
+
+Stat_histogram::Stat_histogram (const char *name, const char *desc,
+                                int bucket_width, int num_buckets)
+    : Stat (name, desc)
+{
+    assert (bucket_width > 0 && num_buckets > 0);
+
+    this->bucket_width = bucket_width;
+    this->num_buckets = num_buckets;
+    this->buckets = new counter_t[num_buckets];
+    clear ();
+}
+
+Stat_histogram::~Stat_histogram ()
+{
+    delete [] buckets;
+}
+
+void Stat_histogram::clear (void)
+{
+    for (int i = 0; i < num_buckets; i++)
+        buckets[i] = 0;
+    overflow = 0;
+    samples = 0;
+    sum = 0.0;
+    min = 0;
+    max = 0;
+}
+
+void Stat_histogram::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->check (num_buckets, "buckets in histogram");
+    ckpt->io (buckets, num_buckets * sizeof (counter_t));
+    ckpt->io (overflow);
+    ckpt->io (samples);
+    ckpt->io (sum);
+    ckpt->io (min);
+    ckpt->io (max);
+}
+
+void Stat_histogram::add (uint64_t sample)
+{
+    uint64_t bucket = sample / bucket_width;
+
+    if (bucket < (uint64_t)num_buckets)
+        buckets[bucket]++;
+    else
+        overflow++;
+
+    if (samples == 0 || sample < min)
+        min = sample;
+    if (sample > max)
+        max = sample;
+
+    samples++;
+    sum += sample;
+}
+
+/** Upper edge of the bucket holding the p-th quantile, clamped to the
+ *  observed min/max so small histograms report exact values.  */
+uint64_t Stat_histogram::percentile (double p)
+{
+    counter_t target;
+    counter_t seen;
+    uint64_t edge;
+
+    if (samples == 0)
+        return 0;
+
+    target = (counter_t) ceil (p * samples);
+    if (target == 0)
+        target = 1;
+
+    seen = 0;
+    for (int i = 0; i < num_buckets; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+        {
+            edge = (uint64_t)(i + 1) * bucket_width - 1;
+            if (edge > max)
+                edge = max;
+            if (edge < min)
+                edge = min;
+            return edge;
+        }
+    }
+
+    return max;
+}
+
+void Stat_histogram::print_text (FILE *fp, const char *prefix)
+{
+    print_path (fp, prefix, name);
+    fprintf (fp, " %16llu  # %s\n", (unsigned long long)samples, desc);
+    fprintf (fp, "%-48s mean %.2f min %llu p50 %llu p90 %llu p99 %llu max %llu\n", "",
+             get_mean (), (unsigned long long)min,
+             (unsigned long long)percentile (0.50), (unsigned long long)percentile (0.90),
+             (unsigned long long)percentile (0.99), (unsigned long long)max);
+}
+
+void Stat_histogram::print_csv (FILE *fp, const char *prefix)
+{
+    fprintf (fp, "%s%s.samples,histogram,%llu\n", prefix, name, (unsigned long long)samples);
+    fprintf (fp, "%s%s.mean,histogram,%.6f\n", prefix, name, get_mean ());
+    fprintf (fp, "%s%s.min,histogram,%llu\n", prefix, name, (unsigned long long)min);
+    fprintf (fp, "%s%s.p50,histogram,%llu\n", prefix, name, (unsigned long long)percentile (0.50));
+    fprintf (fp, "%s%s.p90,histogram,%llu\n", prefix, name, (unsigned long long)percentile (0.90));
+    fprintf (fp, "%s%s.p99,histogram,%llu\n", prefix, name, (unsigned long long)percentile (0.99));
+    fprintf (fp, "%s%s.max,histogram,%llu\n", prefix, name, (unsigned long long)max);
+
+    for (int i = 0; i < num_buckets; i++)
+        if (buckets[i])
+            fprintf (fp, "%s%s.bucket_%d,histogram,%llu\n", prefix, name,
+                     i * bucket_width, (unsigned long long)buckets[i]);
+    if (overflow)
+        fprintf (fp, "%s%s.overflow,histogram,%llu\n", prefix, name, (unsigned long long)overflow);
+}
+
+void Stat_histogram::print_json (FILE *fp, int indent)
+{
+    bool first;
+
+    print_indent (fp, indent);
+    fprintf (fp, "\"%s\": {\"samples\": %llu, \"mean\": %.6f, \"min\": %llu, "
+             "\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu, "
+             "\"bucket_width\": %d, \"overflow\": %llu, \"buckets\": {",
+             name, (unsigned long long)samples, get_mean (), (unsigned long long)min,
+             (unsigned long long)percentile (0.50), (unsigned long long)percentile (0.90),
+             (unsigned long long)percentile (0.99), (unsigned long long)max,
+             bucket_width, (unsigned long long)overflow);
+
+    /** Sparse: only non-empty buckets, keyed by their lower edge.  */
+    first = true;
+    for (int i = 0; i < num_buckets; i++)
+    {
+        if (!buckets[i])
+            continue;
+        fprintf (fp, "%s\"%d\": %llu", first ? "" : ", ", i * bucket_width,
+                 (unsigned long long)buckets[i]);
+        first = false;
+    }
+    fprintf (fp, "}}");
+}
+
+/************************************************************
+ * Stat_engine.
+ ************************************************************/
+Stat_engine::Stat_engine (const char *name)
+{
+    this->name = strdup (name);
+}
+
+Stat_engine::~Stat_engine ()
+{
+    for (unsigned int i = 0; i < stats.size (); i++)
+        delete stats[i];
+    stats.clear ();
+
+    /** Children are owned by their modules.  */
+    children.clear ();
+    free (name);
+}
+
+Stat_counter *Stat_engine::add_counter (const char *name, const char *desc)
+{
+    Stat_counter *stat = new Stat_counter (name, desc);
+    stats.push_back (stat);
+    return stat;
+}
+
+Stat_average *Stat_engine::add_average (const char *name, const char *desc)
+{
+    Stat_average *stat = new Stat_average (name, desc);
+    stats.push_back (stat);
+    return stat;
+}
+
+Stat_histogram *Stat_engine::add_histogram (const char *name, const char *desc,
+                                            int bucket_width, int num_buckets)
+{
+    Stat_histogram *stat = new Stat_histogram (name, desc, bucket_width, num_buckets);
+    stats.push_back (stat);
+    return stat;
+}
+
+void Stat_engine::add_child (Stat_engine *child)
+{
+    assert (child);
+    children.push_back (child);
+}
+
+void Stat_engine::clear (void)
+{
+    for (unsigned int i = 0; i < stats.size (); i++)
+        stats[i]->clear ();
+    for (unsigned int i = 0; i < children.size (); i++)
+        children[i]->clear ();
+}
+
+/** The tree has the same shape whenever the configuration matches.  */
+void Stat_engine::checkpoint (Checkpoint *ckpt)
+{
+    ckpt->check (stats.size (), "stats in group");
+    for (unsigned int i = 0; i < stats.size (); i++)
+        stats[i]->checkpoint (ckpt);
+    ckpt->check (children.size (), "child stat groups");
+    for (unsigned int i = 0; i < children.size (); i++)
+        children[i]->checkpoint (ckpt);
+}
+
+void Stat_engine::print_text (FILE *fp, const char *prefix)
+{
+    char path[256];
+
+    snprintf (path, sizeof (path), "%s%s.", prefix, name);
+
+    for (unsigned int i = 0; i < stats.size (); i++)
+        stats[i]->print_text (fp, path);
+    for (unsigned int i = 0; i < children.size (); i++)
+        children[i]->print_text (fp, path);
+}
+
+void Stat_engine::print_csv (FILE *fp, const char *prefix)
+{
+    char path[256];
+
+    snprintf (path, sizeof (path), "%s%s.", prefix, name);
+
+    for (unsigned int i = 0; i < stats.size (); i++)
+        stats[i]->print_csv (fp, path);
+    for (unsigned int i = 0; i < children.size (); i++)
+        children[i]->print_csv (fp, path);
+}
+
+void Stat_engine::print_json (FILE *fp, int indent)
+{
+    unsigned int items = stats.size () + children.size ();
+    unsigned int n = 0;
+
+    print_indent (fp, indent);
+    fprintf (fp, "\"%s\": {\n", name);
+
+    for (unsigned int i = 0; i < stats.size (); i++)
+    {
+        stats[i]->print_json (fp, indent + 1);
+        fprintf (fp, "%s\n", (++n < items) ? "," : "");
+    }
+    for (unsigned int i = 0; i < children.size (); i++)
+    {
+        children[i]->print_json (fp, indent + 1);
+        fprintf (fp, "%s\n", (++n < items) ? "," : "");
+    }
+
+    print_indent (fp, indent);
+    fprintf (fp, "}");
+}
+
+/************************************************************
+ * Per-module stat engines.
+ ************************************************************/
+Hash_table_stat_engine::Hash_table_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    accesses      = add_counter ("accesses", "processor requests seen by the cache");
+    hits          = add_counter ("hits", "requests satisfied without a bus transaction");
+    misses        = add_counter ("misses", "requests that needed a bus transaction");
+    snoops        = add_counter ("snoops", "bus requests snooped");
+    data_received = add_counter ("data_received", "DATA replies addressed to this cache");
+}
+
+Processor_stat_engine::Processor_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    loads           = add_counter ("loads", "load references issued");
+    stores          = add_counter ("stores", "store references issued");
+    atomics         = add_counter ("atomics", "atomic read-modify-writes, counted as stores");
+    load_links      = add_counter ("load_links", "load-linked references, counted as loads");
+    store_conditionals = add_counter ("store_conditionals", "store-conditionals, counted as stores");
+    sc_failures     = add_counter ("sc_failures", "store-conditionals that lost their link");
+    stall_cycles    = add_counter ("stall_cycles", "cycles spent waiting on the cache");
+    sync_wait_cycles = add_counter ("sync_wait_cycles", "cycles blocked at a barrier or on a lock");
+    request_latency = add_histogram ("request_latency", "cycles from issue to completion", 16, 256);
+}
+
+Memory_controller_stat_engine::Memory_controller_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    requests  = add_counter ("requests", "bus requests that started a memory lookup");
+    data_sent = add_counter ("data_sent", "DATA replies sent by memory");
+    cancelled = add_counter ("cancelled", "lookups cancelled by a cache-to-cache transfer");
+}
+
+Bus_stat_engine::Bus_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    char stat_name[64];
+
+    busy_cycles = add_counter ("busy_cycles", "cycles with a message on the bus");
+    addr_busy_cycles = add_counter ("addr_busy_cycles", "cycles the address phase held the bus");
+    data_busy_cycles = add_counter ("data_busy_cycles", "cycles a DATA reply was being transferred");
+    for (int i = 0; i < MREQ_MESSAGE_NUM; i++)
+    {
+        snprintf (stat_name, sizeof (stat_name), "msg_%s", Mreq::message_t_str[i]);
+        transactions[i] = add_counter (stat_name, "messages broadcast on the bus");
+    }
+    queue_depth = add_average ("queue_depth", "pending requests waiting for the bus");
+}
+
+Prefetch_stat_engine::Prefetch_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    issued      = add_counter ("issued", "prefetch GETS sent to the bus");
+    filtered    = add_counter ("filtered", "candidates already valid or pending in the L1");
+    dropped     = add_counter ("dropped", "candidates over prefetch_max_outstanding");
+    cancelled   = add_counter ("cancelled", "prefetches not granted within prefetch_max_wait cycles");
+    useful      = add_counter ("useful", "prefetched lines later referenced");
+    late        = add_counter ("late", "demand references that waited on an in-flight prefetch");
+    late_cycles = add_average ("late_cycles", "cycles a late reference waited");
+    invalidated = add_counter ("invalidated", "prefetched lines invalidated before use");
+    unused      = add_counter ("unused", "prefetched lines not yet referenced");
+}
+
+Simulator_stat_engine::Simulator_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    run_time                 = add_counter ("run_time", "cycles");
+    cache_misses             = add_counter ("cache_misses", "misses counted by the protocols");
+    cache_accesses           = add_counter ("cache_accesses", "processor requests");
+    silent_upgrades          = add_counter ("silent_upgrades", "E to M upgrades");
+    cache_to_cache_transfers = add_counter ("cache_to_cache_transfers", "DATA sent by caches");
+}
+
+Miss_latency_stat_engine::Miss_latency_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    from_memory    = add_counter ("from_memory", "misses serviced by memory");
+    from_cache     = add_counter ("from_cache", "misses serviced by another cache");
+
+    total          = add_histogram ("total", "issue to completion", 8, 512);
+    l1             = add_histogram ("l1", "cycles in the L1 before and after the bus", 8, 512);
+    bus_queue      = add_histogram ("bus_queue", "waiting for the bus grant", 8, 512);
+    memory         = add_histogram ("memory", "bus grant to memory response", 8, 512);
+    cache_to_cache = add_histogram ("cache_to_cache", "bus grant to cache response", 8, 512);
+    transfer       = add_histogram ("transfer", "response posted to data on the bus", 8, 512);
+}
+
+void Miss_latency_stat_engine::record (Preq *preq)
+{
+    preq->calculate_latencies ();
+
+    total->add (preq->latencies[PREQ_LAT_TOTAL]);
+    l1->add (preq->latencies[PREQ_LAT_L1]);
+    bus_queue->add (preq->latencies[PREQ_LAT_BUS_QUEUE]);
+    transfer->add (preq->latencies[PREQ_LAT_TRANSFER]);
+
+    if (preq->data_from_memory)
+    {
+        from_memory->inc ();
+        memory->add (preq->latencies[PREQ_LAT_RESPONSE]);
+    }
+    else
+    {
+        from_cache->inc ();
+        cache_to_cache->add (preq->latencies[PREQ_LAT_RESPONSE]);
+    }
+}
+
+const char *Sharing_stat_engine::sharing_class_str[SHARING_CLASS_NUM] = {
+    "private", "read_only", "migratory", "producer_consumer", "widely_shared", "other"
+};
+
+Sharing_stat_engine::Sharing_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    char stat_name[64];
+
+    for (int i = 0; i < SHARING_CLASS_NUM; i++)
+    {
+        snprintf (stat_name, sizeof (stat_name), "lines_%s", sharing_class_str[i]);
+        lines[i] = add_counter (stat_name, "lines classified with this pattern");
+        snprintf (stat_name, sizeof (stat_name), "accesses_%s", sharing_class_str[i]);
+        accesses[i] = add_counter (stat_name, "processor requests to these lines");
+        snprintf (stat_name, sizeof (stat_name), "bus_%s", sharing_class_str[i]);
+        bus_transactions[i] = add_counter (stat_name, "bus requests for these lines");
+    }
+
+    read_only_lines    = add_counter ("ro_tracker_read_only", "regions never written");
+    written_lines      = add_counter ("ro_tracker_written", "regions written at least once");
+    untracked_accesses = add_counter ("untracked_accesses", "accesses dropped once the tables filled");
+}
+
+False_sharing_stat_engine::False_sharing_stat_engine (const char *name)
+    : Stat_engine (name)
+{
+    invalidations        = add_counter ("invalidations", "copies invalidated by another core's GETM");
+    false_invalidations  = add_counter ("false_invalidations", "invalidations where writer and victim touched disjoint words");
+    coherence_misses     = add_counter ("coherence_misses", "re-references after an invalidation");
+    true_sharing_misses  = add_counter ("true_sharing_misses", "coherence misses to a word written meanwhile");
+    false_sharing_misses = add_counter ("false_sharing_misses", "avoidable coherence misses");
+}
+
+/************************************************************
+ * Sim_stat_manager.
+ ************************************************************/
+Sim_stat_manager::Sim_stat_manager ()
+{
+    root = new Simulator_stat_engine ("sim");
+
+    miss_latency = new Miss_latency_stat_engine ("miss_latency");
+    root->add_child (miss_latency);
+}
+
+Sim_stat_manager::~Sim_stat_manager ()
+{
+    delete root;
+    delete miss_latency;
+}
+
+void Sim_stat_manager::dump (sim_output_mode_t mode, const char *file)
+{
+    FILE *fp;
+
+    switch (mode) {
+    case OUTPUT_FMT_COUT: root->print_text (stdout, ""); return;
+    case OUTPUT_FMT_CERR: root->print_text (stderr, ""); return;
+    case OUTPUT_FMT_NONE: return;
+    case OUTPUT_FMT_CSV:
+    case OUTPUT_FMT_JSON:
+        break;
+    default:
+        fatal_error ("Sim_stat_manager: unknown report format %d\n", mode);
+    }
+
+    /** Machine readable formats are only written when asked for a file.  */
+    if (file == NULL)
+        return;
+
+    if ((fp = fopen (file, "w")) == NULL)
+        fatal_error ("Sim_stat_manager: unable to open %s\n", file);
+
+    if (mode == OUTPUT_FMT_CSV)
+    {
+        fprintf (fp, "stat,type,value\n");
+        root->print_csv (fp, "");
+    }
+    else
+    {
+        fprintf (fp, "{\n");
+        root->print_json (fp, 1);
+        fprintf (fp, "\n}\n");
+    }
+
+    fclose (fp);
+}
@@ -0,0 +1,266 @@
+#ifndef STAT_ENGINE_H_
+#define STAT_ENGINE_H_
+
+#include "enums.h"
+#include "types.h"
+#include "../protocols/messages.h"
+
+using namespace std;
+
+class Checkpoint;
+
+typedef enum {
+    STAT_COUNTER = 0,
+    STAT_AVERAGE,
+    STAT_HISTOGRAM
+} stat_type_t;
+
+/** Base class for a single named statistic.  Stats are owned by the
+ *  Stat_engine they were created in.  */
+class Stat {
+public:
+    Stat (const char *name, const char *desc);
+    virtual ~Stat ();
+
+    char *name;
+    char *desc;
+
+    virtual stat_type_t get_type (void) =0;
+    virtual void clear (void) =0;
+    virtual void checkpoint (Checkpoint *ckpt) =0;
+
+    virtual void print_text (FILE *fp, const char *prefix) =0;
+    virtual void print_csv (FILE *fp, const char *prefix) =0;
+    virtual void print_json (FILE *fp, int indent) =0;
+};
+
+/** Monotonic event counter.  */
+class Stat_counter : public Stat {
+public:
+    Stat_counter (const char *name, const char *desc);
+
+    counter_t value;
+
+    void inc (void) { value++; }
+    void add (counter_t n) { value += n; }
+
+    stat_type_t get_type (void) { return STAT_COUNTER; }
+    void clear (void);
+    void checkpoint (Checkpoint *ckpt);
+
+    void print_text (FILE *fp, const char *prefix);
+    void print_csv (FILE *fp, const char *prefix);
+    void print_json (FILE *fp, int indent);
+};
+
+/** Running average of sampled values.  */
+class Stat_average : public Stat {
+public:
+    Stat_average (const char *name, const char *desc);
+
+    counter_t samples;
+    double sum;
+
+    void add (double sample) { samples++; sum += sample; }
+    double get_mean (void) { return samples ? sum / samples : 0.0; }
+
+    stat_type_t get_type (void) { return STAT_AVERAGE; }
+    void clear (void);
+    void checkpoint (Checkpoint *ckpt);
+
+    void print_text (FILE *fp, const char *prefix);
+    void print_csv (FILE *fp, const char *prefix);
+    void print_json (FILE *fp, int indent);
+};
+
+/** Fixed-width bucketed histogram.  Samples beyond the last bucket are
+ *  counted in an overflow bucket; min/max/mean are tracked exactly.  */
+class Stat_histogram : public Stat {
+public:
+    Stat_histogram (const char *name, const char *desc,
+                    int bucket_width, int num_buckets);
+    ~Stat_histogram ();
+
+    int bucket_width;
+    int num_buckets;
+    counter_t *buckets;
+    counter_t overflow;
+
+    counter_t samples;
+    double sum;
+    uint64_t min;
+    uint64_t max;
+
+    void add (uint64_t sample);
+    double get_mean (void) { return samples ? sum / samples : 0.0; }
+    uint64_t percentile (double p);
+
+    stat_type_t get_type (void) { return STAT_HISTOGRAM; }
+    void clear (void);
+    void checkpoint (Checkpoint *ckpt);
+
+    void print_text (FILE *fp, const char *prefix);
+    void print_csv (FILE *fp, const char *prefix);
+    void print_json (FILE *fp, int indent);
+};
+
+/** A named group of stats with child groups, e.g. sim.node3.L1.  */
+class Stat_engine {
+public:
+    Stat_engine (const char *name);
+    virtual ~Stat_engine ();
+
+    char *name;
+    VECTOR<Stat *> stats;
+    VECTOR<Stat_engine *> children;
+
+    Stat_counter *add_counter (const char *name, const char *desc);
+    Stat_average *add_average (const char *name, const char *desc);
+    Stat_histogram *add_histogram (const char *name, const char *desc,
+                                   int bucket_width, int num_buckets);
+    void add_child (Stat_engine *child);
+
+    void clear (void);
+    void checkpoint (Checkpoint *ckpt);
+
+    void print_text (FILE *fp, const char *prefix);
+    void print_csv (FILE *fp, const char *prefix);
+    void print_json (FILE *fp, int indent);
+};
+
+class Hash_table_stat_engine : public Stat_engine {
+public:
+    Hash_table_stat_engine (const char *name);
+
+    Stat_counter *accesses;
+    Stat_counter *hits;
+    Stat_counter *misses;
+    Stat_counter *snoops;
+    Stat_counter *data_received;
+};
+
+/** Prefetch usefulness.  The L1 is infinite, so pollution shows up as
+ *  prefetched lines that are never used or are invalidated first.  */
+class Prefetch_stat_engine : public Stat_engine {
+public:
+    Prefetch_stat_engine (const char *name);
+
+    Stat_counter *issued;
+    Stat_counter *filtered;
+    Stat_counter *dropped;
+    Stat_counter *cancelled;
+    Stat_counter *useful;
+    Stat_counter *late;
+    Stat_average *late_cycles;
+    Stat_counter *invalidated;
+    Stat_counter *unused;
+};
+
+class Processor_stat_engine : public Stat_engine {
+public:
+    Processor_stat_engine (const char *name);
+
+    Stat_counter *loads;
+    Stat_counter *stores;
+    Stat_counter *atomics;
+    Stat_counter *load_links;
+    Stat_counter *store_conditionals;
+    Stat_counter *sc_failures;
+    Stat_counter *stall_cycles;
+    Stat_counter *sync_wait_cycles;
+    Stat_histogram *request_latency;
+};
+
+class Memory_controller_stat_engine : public Stat_engine {
+public:
+    Memory_controller_stat_engine (const char *name);
+
+    Stat_counter *requests;
+    Stat_counter *data_sent;
+    Stat_counter *cancelled;
+};
+
+class Bus_stat_engine : public Stat_engine {
+public:
+    Bus_stat_engine (const char *name);
+
+    Stat_counter *busy_cycles;
+    Stat_counter *addr_busy_cycles;
+    Stat_counter *data_busy_cycles;
+    Stat_counter *transactions[MREQ_MESSAGE_NUM];
+    Stat_average *queue_depth;
+};
+
+class Simulator_stat_engine : public Stat_engine {
+public:
+    Simulator_stat_engine (const char *name);
+
+    Stat_counter *run_time;
+    Stat_counter *cache_misses;
+    Stat_counter *cache_accesses;
+    Stat_counter *silent_upgrades;
+    Stat_counter *cache_to_cache_transfers;
+};
+
+/** Miss latency split by where the cycles went (see Preq).  */
+class Miss_latency_stat_engine : public Stat_engine {
+public:
+    Miss_latency_stat_engine (const char *name);
+
+    Stat_counter *from_memory;
+    Stat_counter *from_cache;
+
+    Stat_histogram *total;
+    Stat_histogram *l1;
+    Stat_histogram *bus_queue;
+    Stat_histogram *memory;
+    Stat_histogram *cache_to_cache;
+    Stat_histogram *transfer;
+
+    void record (Preq *preq);
+};
+
+/** Lines, processor accesses and bus transactions per sharing pattern
+ *  (see Sim_analysis).  */
+class Sharing_stat_engine : public Stat_engine {
+public:
+    Sharing_stat_engine (const char *name);
+
+    static const char *sharing_class_str[SHARING_CLASS_NUM];
+
+    Stat_counter *lines[SHARING_CLASS_NUM];
+    Stat_counter *accesses[SHARING_CLASS_NUM];
+    Stat_counter *bus_transactions[SHARING_CLASS_NUM];
+
+    Stat_counter *read_only_lines;
+    Stat_counter *written_lines;
+    Stat_counter *untracked_accesses;
+};
+
+/** Coherence invalidations and the misses that follow them, split into
+ *  true and false sharing (see False_sharing_tracker).  */
+class False_sharing_stat_engine : public Stat_engine {
+public:
+    False_sharing_stat_engine (const char *name);
+
+    Stat_counter *invalidations;
+    Stat_counter *false_invalidations;
+    Stat_counter *coherence_misses;
+    Stat_counter *true_sharing_misses;
+    Stat_counter *false_sharing_misses;
+};
+
+/** Root of the stats hierarchy.  Emits the whole tree in the format
+ *  selected by settings.report_output.  */
+class Sim_stat_manager {
+public:
+    Sim_stat_manager ();
+    ~Sim_stat_manager ();
+
+    Simulator_stat_engine *root;
+    Miss_latency_stat_engine *miss_latency;
+
+    void dump (sim_output_mode_t mode, const char *file);
+};
+
+#endif // STAT_ENGINE_H_
@@ -0,0 +1,232 @@
+#include "checkpoint.h"
+#include "processor.h"
+#include "regression.h"
+#include "sim.h"
+#include "stat_engine.h"
+#include "sync.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+Sync_tracker::Sync_tracker ()
+{
+    stats = new Stat_engine ("sync");
+    sync_lines      = stats->add_counter ("sync_lines", "lines used by atomics");
+    handoffs        = stats->add_counter ("handoffs", "atomics on a line another core wrote last");
+    handoff_latency = stats->add_histogram ("handoff_latency", "cycles from the last write by another core to the atomic", 16, 256);
+    barrier_episodes  = stats->add_counter ("barrier_episodes", "barriers opened");
+    barrier_wait      = stats->add_histogram ("barrier_wait", "cycles a core waited at a barrier", 64, 256);
+    barrier_imbalance = stats->add_histogram ("barrier_imbalance", "cycles from first to last arrival at a barrier", 64, 256);
+    lock_acquires     = stats->add_counter ("lock_acquires", "trace locks granted");
+    lock_wait         = stats->add_histogram ("lock_wait", "cycles from lock request to grant", 16, 256);
+}
+
+Sync_tracker::~Sync_tracker ()
+{
+    delete stats;
+}
+
+void Sync_tracker::write (int node, paddr_t line, bool atomic)
+{
+    MAP<paddr_t, Sync_line>::iterator it = lines.find (line);
+
+    if (it == lines.end ())
+    {
+        if (!atomic)
+            return;
+        it = lines.insert (make_pair (line, Sync_line ())).first;
+        sync_lines->inc ();
+    }
+    else if (atomic && it->second.writer != node)
+    {
+        handoffs->inc ();
+        handoff_latency->add (Global_Clock - it->second.write_time);
+    }
+
+    it->second.writer = node;
+    it->second.write_time = Global_Clock;
+}
+
+void Sync_tracker::unlock (int node, paddr_t line)
+{
+    MAP<paddr_t, int>::iterator it = locks.find (line);
+
+    if (it == locks.end () || it->second != node)
+        fatal_error ("Sync: PR %d released lock 0x%llx it does not hold\n",
+                     node, (unsigned long long int)line);
+    it->second = -1;
+}
+
+void Sync_tracker::open_barrier (paddr_t addr, bool record)
+{
+    Sync_barrier *barrier;
+    timestamp_t first = Global_Clock;
+    timestamp_t last = 0;
+    counter_t wait = 0;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = Sim->get_PR (i);
+
+        if (pr->sync_op != 'b')
+            continue;
+        pr->sync_op = 0;
+        if (!record)
+            continue;
+        if (pr->sync_time < first)
+            first = pr->sync_time;
+        if (pr->sync_time > last)
+            last = pr->sync_time;
+        wait += Global_Clock - pr->sync_time;
+        barrier_wait->add (Global_Clock - pr->sync_time);
+    }
+    if (!record)
+        return;
+
+    barrier = &barriers[addr];
+    barrier->episodes++;
+    barrier->wait += wait;
+    barrier->imbalance += last - first;
+    if (last - first > barrier->max_imbalance)
+        barrier->max_imbalance = last - first;
+    barrier_episodes->inc ();
+    barrier_imbalance->add (last - first);
+}
+
+bool Sync_tracker::end_cycle (bool record)
+{
+    MAP<paddr_t, int> grants;
+    MAP<paddr_t, int>::iterator it;
+    int live = 0;
+    int at_barrier = 0;
+    int waiting = 0;
+    paddr_t barrier = 0;
+    bool mixed = false;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = Sim->get_PR (i);
+
+        if (pr->end_of_trace)
+            continue;
+        live++;
+        if (pr->sync_op == 'b')
+        {
+            if (at_barrier && pr->sync_addr != barrier)
+                mixed = true;
+            barrier = pr->sync_addr;
+            at_barrier++;
+        }
+        else if (pr->sync_op == 'k')
+        {
+            waiting++;
+            it = locks.find (pr->sync_addr);
+            if (it != locks.end () && it->second >= 0)
+                continue;
+            /** Earliest waiter; nodes are scanned in order, so ties go to
+             *  the lowest.  */
+            it = grants.find (pr->sync_addr);
+            if (it == grants.end () || pr->sync_time < Sim->get_PR (it->second)->sync_time)
+                grants[pr->sync_addr] = i;
+        }
+    }
+
+    if (at_barrier && !mixed && at_barrier == live)
+    {
+        open_barrier (barrier, record);
+        return true;
+    }
+
+    for (it = grants.begin (); it != grants.end (); it++)
+    {
+        Processor *pr = Sim->get_PR (it->second);
+
+        locks[it->first] = it->second;
+        pr->sync_op = 0;
+        pr->sync_granted = true;
+        if (!record)
+            continue;
+        lock_acquires->inc ();
+        lock_wait->add (Global_Clock - pr->sync_time);
+    }
+
+    if (live && at_barrier + waiting == live && grants.empty ())
+        deadlock ();
+    return !grants.empty ();
+}
+
+void Sync_tracker::deadlock (void)
+{
+    MAP<paddr_t, int>::iterator it;
+
+    if (regression_checker)
+        regression_checker->detach ();
+    sim_log_muted = false;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = Sim->get_PR (i);
+
+        if (pr->end_of_trace)
+            fprintf (stderr, "Sync -- PR %d: trace finished\n", i);
+        else if (pr->sync_op == 'b')
+            fprintf (stderr, "Sync -- PR %d: at barrier 0x%llx since cycle %lld\n", i,
+                     (unsigned long long int)pr->sync_addr, (long long int)pr->sync_time);
+        else
+        {
+            it = locks.find (pr->sync_addr);
+            fprintf (stderr, "Sync -- PR %d: waiting for lock 0x%llx, held by PR %d, since cycle %lld\n",
+                     i, (unsigned long long int)pr->sync_addr, it->second, (long long int)pr->sync_time);
+        }
+    }
+    fatal_error ("Sync: deadlock at cycle %lld\n", (long long int)Global_Clock);
+}
+
+/** Per-barrier totals, only for traces that use barriers.  */
+void Sync_tracker::report (FILE *fp)
+{
+    MAP<paddr_t, Sync_barrier>::iterator it;
+
+    for (it = barriers.begin (); it != barriers.end (); it++)
+        fprintf (fp, "Barrier 0x%llx:     %8llu episodes, %llu wait cycles, imbalance %.1f avg %llu max cycles\n",
+                 (unsigned long long int)it->first, (unsigned long long int)it->second.episodes,
+                 (unsigned long long int)it->second.wait,
+                 (double)it->second.imbalance / it->second.episodes,
+                 (unsigned long long int)it->second.max_imbalance);
+}
+
+/** A map of plain values: its size, then each key and value.  */
+template <class T> static void io_map (Checkpoint *ckpt, MAP<paddr_t, T> &map)
+{
+    typename MAP<paddr_t, T>::iterator it;
+    unsigned int count = map.size ();
+    paddr_t key;
+    T value;
+
+    ckpt->io (count);
+    if (ckpt->saving)
+    {
+        for (it = map.begin (); it != map.end (); it++)
+        {
+            key = it->first;
+            ckpt->io (key);
+            ckpt->io (it->second);
+        }
+        return;
+    }
+
+    map.clear ();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        ckpt->io (key);
+        ckpt->io (value);
+        map[key] = value;
+    }
+}
+
+void Sync_tracker::checkpoint (Checkpoint *ckpt)
+{
+    io_map (ckpt, lines);
+    io_map (ckpt, barriers);
+    io_map (ckpt, locks);
+}
@@ -0,0 +1,95 @@
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include <stdio.h>
+
+#include "types.h"
+
+using namespace std;
+
+class Checkpoint;
+class Stat_counter;
+class Stat_engine;
+class Stat_histogram;
+
+/** The last completed write to a line atomics have touched.  */
+class Sync_line {
+public:
+    Sync_line () : writer (-1), write_time (0) {}
+
+    int writer;
+    timestamp_t write_time;
+};
+
+/** Totals for one barrier address over all its episodes.  */
+class Sync_barrier {
+public:
+    Sync_barrier () : episodes (0), wait (0), imbalance (0), max_imbalance (0) {}
+
+    counter_t episodes;
+    /** Cycles cores spent waiting, summed over cores and episodes.  */
+    counter_t wait;
+    /** First to last arrival, summed over episodes.  */
+    counter_t imbalance;
+    counter_t max_imbalance;
+};
+
+/**
+ * Synchronization across cores.
+ *
+ * A line becomes a sync line at its first atomic read-modify-write or
+ * successful store-conditional; from then on every completed write to it
+ * is noted, though a plain store only reaches the tracker from a core that
+ * has itself used the line for an atomic, LL/SC or lock.  An atomic by a
+ * core other than the line's last writer is a hand-off, e.g. a lock taken
+ * after another core released it, and its latency runs from that last
+ * write to the atomic's completion.
+ *
+ * Trace barriers ('b') and locks ('k' acquire, 'u' release) block the
+ * core in Processor::sync_op; end_cycle () wakes it.  A barrier opens once
+ * every core that has not finished its trace waits on it.  A free lock
+ * goes to its earliest waiter, lowest node first on a tie, which then
+ * takes it with an atomic on the lock address; the release is a store
+ * that frees the lock when it completes.  If every running core is
+ * blocked, the run stops as a deadlock.
+ */
+class Sync_tracker {
+public:
+    Sync_tracker ();
+    ~Sync_tracker ();
+
+    MAP<paddr_t, Sync_line> lines;
+    MAP<paddr_t, Sync_barrier> barriers;
+    /** Holder of each lock ever taken, -1 once released.  */
+    MAP<paddr_t, int> locks;
+
+    Stat_engine *stats;
+    Stat_counter *sync_lines;
+    Stat_counter *handoffs;
+    Stat_histogram *handoff_latency;
+    Stat_counter *barrier_episodes;
+    Stat_histogram *barrier_wait;
+    Stat_histogram *barrier_imbalance;
+    Stat_counter *lock_acquires;
+    Stat_histogram *lock_wait;
+
+    /** node completed a write to line; atomic for an RMW or a successful
+     *  SC.  */
+    void write (int node, paddr_t line, bool atomic);
+    /** node's lock release to line completed.  */
+    void unlock (int node, paddr_t line);
+
+    /** Open barriers and grant locks; after the node ticks, serially.
+     *  Sampling's functional fast-forward calls it with record false when
+     *  no core can go on.  Returns whether any core was woken.  */
+    bool end_cycle (bool record = true);
+
+    void report (FILE *fp);
+    void checkpoint (Checkpoint *ckpt);
+
+private:
+    void open_barrier (paddr_t addr, bool record);
+    void deadlock (void) __attribute__ ((noreturn));
+};
+
+#endif // SYNC_H_
@@ -0,0 +1,282 @@
+#ifndef TRACE_RECORDER_H_
+#define TRACE_RECORDER_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Header-only recorder for tracing real code into simulator traces.  It
+ * needs nothing from the simulator, only pthreads.
+ *
+ *     trace_start ("traces/my_kernel", true);  // true: binary traces
+ *     ... in each thread:
+ *         trace_thread (id);                    // optional, see below
+ *         trace_load (&a[i]);
+ *         trace_store (&b[i]);
+ *         trace_rmw (&lock);                    // atomic read-modify-write
+ *         trace_barrier (&barrier);             // wait for every core
+ *         trace_thread_end ();                  // or just let it exit
+ *     trace_stop ();
+ *
+ * traced_load (p) and traced_store (p, v) do the access and record it.
+ * trace_ll () and trace_sc () record load-linked and store-conditional.
+ * trace_barrier (), trace_lock () and trace_unlock () record sync events
+ * the simulator replays: a barrier every core meets, and a lock acquire
+ * and release on the lock's address.
+ *
+ * Each thread is one core.  trace_thread () picks the core; a thread that
+ * never calls it takes the next unused number at its first reference.
+ * References go to a private buffer of TRACE_RECORDER_REFS entries, so
+ * recording takes no lock.  A full buffer is written to the thread's own
+ * p<core>.trace.  A thread's buffer is flushed by trace_thread_end () or
+ * when the thread exits; trace_stop () flushes the calling thread, writes
+ * the directory's config with the core count, and must come after every
+ * other recording thread is done.
+ *
+ * Text traces are the usual "r 0x..." lines.  Binary traces start with
+ * TRACE_BINARY_MAGIC, then hold one 8-byte little-endian record per
+ * reference, address << TRACE_OP_BITS | the op's index in TRACE_OPS.
+ * Trace_ref_source reads either.
+ */
+
+/** First bytes of a binary trace.  */
+#define TRACE_BINARY_MAGIC "SIMTRACE"
+#define TRACE_BINARY_MAGIC_SIZE 8
+#define TRACE_RECORD_SIZE 8
+
+/** Trace operations: read, write, atomic read-modify-write, load-linked,
+ *  store-conditional, barrier, lock acquire, lock release.  */
+#define TRACE_OPS "rwalsbku"
+#define TRACE_OP_BITS 4
+
+#ifndef TRACE_RECORDER_REFS
+#define TRACE_RECORDER_REFS (1 << 16)
+#endif
+#define TRACE_RECORDER_MAX_DIR 1000
+
+/** Index of op in TRACE_OPS, -1 if it is not a trace operation.  */
+inline int trace_op_code (char op)
+{
+    const char *p = op ? strchr (TRACE_OPS, op) : NULL;
+
+    return p ? (int)(p - TRACE_OPS) : -1;
+}
+
+inline void trace_record_encode (unsigned char *buf, uint64_t record)
+{
+    for (int i = 0; i < TRACE_RECORD_SIZE; i++)
+        buf[i] = (unsigned char)(record >> (8 * i));
+}
+
+/** The record's address; op gets its operation, '?' for a bad code.  */
+inline uint64_t trace_record_decode (const unsigned char *buf, char *op)
+{
+    uint64_t record = 0;
+    unsigned int code;
+
+    for (int i = 0; i < TRACE_RECORD_SIZE; i++)
+        record |= (uint64_t)buf[i] << (8 * i);
+    code = record & ((1 << TRACE_OP_BITS) - 1);
+    *op = code < strlen (TRACE_OPS) ? TRACE_OPS[code] : '?';
+    return record >> TRACE_OP_BITS;
+}
+
+/** One thread's references not yet written, as binary records.  */
+class Trace_buffer {
+public:
+    int core;
+    FILE *file;
+    int count;
+    uint64_t refs[TRACE_RECORDER_REFS];
+};
+
+/** Shared by all threads; only cores is written once recording starts,
+ *  and only with atomic operations.  */
+class Trace_recorder {
+public:
+    char dir[TRACE_RECORDER_MAX_DIR];
+    bool binary;
+    bool recording;
+    /** One more than the highest core used.  */
+    int cores;
+    /** Next core for a thread that did not pick one.  */
+    int next_core;
+    pthread_key_t key;
+};
+
+inline Trace_recorder *trace_recorder (void)
+{
+    static Trace_recorder recorder;
+    return &recorder;
+}
+
+/** The calling thread's buffer, NULL before its first reference.  */
+inline Trace_buffer *&trace_buffer (void)
+{
+    static __thread Trace_buffer *buffer;
+    return buffer;
+}
+
+inline void trace_write (Trace_buffer *b)
+{
+    Trace_recorder *r = trace_recorder ();
+    unsigned char record[TRACE_RECORD_SIZE];
+
+    for (int i = 0; i < b->count; i++)
+    {
+        if (r->binary)
+        {
+            trace_record_encode (record, b->refs[i]);
+            fwrite (record, TRACE_RECORD_SIZE, 1, b->file);
+        }
+        else
+            fprintf (b->file, "%c 0x%llx\n", TRACE_OPS[b->refs[i] & ((1 << TRACE_OP_BITS) - 1)],
+                     (unsigned long long int)(b->refs[i] >> TRACE_OP_BITS));
+    }
+    b->count = 0;
+}
+
+/** Flush and close the calling thread's trace.  */
+inline void trace_thread_end (void)
+{
+    Trace_buffer *b = trace_buffer ();
+
+    if (!b)
+        return;
+    trace_write (b);
+    fclose (b->file);
+    free (b);
+    trace_buffer () = NULL;
+    pthread_setspecific (trace_recorder ()->key, NULL);
+}
+
+inline void trace_thread_exit (void *buffer)
+{
+    trace_buffer () = (Trace_buffer *)buffer;
+    trace_thread_end ();
+}
+
+inline FILE *trace_open (int core, const char *mode)
+{
+    char path[TRACE_RECORDER_MAX_DIR + 64];
+
+    snprintf (path, sizeof (path), "%s/p%d.trace", trace_recorder ()->dir, core);
+    return fopen (path, mode);
+}
+
+/** Record the calling thread as core, or as the next free core if core
+ *  is negative.  Returns the core, -1 if not recording.  */
+inline int trace_thread (int core = -1)
+{
+    Trace_recorder *r = trace_recorder ();
+    Trace_buffer *b;
+    int cores;
+
+    if (!r->recording)
+        return -1;
+    if (trace_buffer ())
+        trace_thread_end ();
+    if (core < 0)
+        core = __sync_fetch_and_add (&r->next_core, 1);
+    do
+        cores = r->cores;
+    while (core >= cores && !__sync_bool_compare_and_swap (&r->cores, cores, core + 1));
+
+    b = (Trace_buffer *)malloc (sizeof (Trace_buffer));
+    b->core = core;
+    b->count = 0;
+    b->file = trace_open (core, r->binary ? "wb" : "w");
+    if (!b->file)
+    {
+        fprintf (stderr, "Trace_recorder: unable to write %s/p%d.trace\n", r->dir, core);
+        exit (1);
+    }
+    if (r->binary)
+        fwrite (TRACE_BINARY_MAGIC, TRACE_BINARY_MAGIC_SIZE, 1, b->file);
+    trace_buffer () = b;
+    pthread_setspecific (r->key, b);
+    return core;
+}
+
+inline void trace_ref (const void *ptr, char op)
+{
+    Trace_buffer *b = trace_buffer ();
+
+    if (!b)
+    {
+        if (trace_thread () < 0)
+            return;
+        b = trace_buffer ();
+    }
+    b->refs[b->count++] = (uint64_t)(uintptr_t)ptr << TRACE_OP_BITS | trace_op_code (op);
+    if (b->count == TRACE_RECORDER_REFS)
+        trace_write (b);
+}
+
+inline void trace_load (const void *ptr) { trace_ref (ptr, 'r'); }
+inline void trace_store (const void *ptr) { trace_ref (ptr, 'w'); }
+inline void trace_rmw (const void *ptr) { trace_ref (ptr, 'a'); }
+inline void trace_ll (const void *ptr) { trace_ref (ptr, 'l'); }
+inline void trace_sc (const void *ptr) { trace_ref (ptr, 's'); }
+inline void trace_barrier (const void *barrier) { trace_ref (barrier, 'b'); }
+inline void trace_lock (const void *lock) { trace_ref (lock, 'k'); }
+inline void trace_unlock (const void *lock) { trace_ref (lock, 'u'); }
+
+template <class T> inline T traced_load (const T *ptr)
+{
+    trace_load (ptr);
+    return *ptr;
+}
+
+template <class T> inline void traced_store (T *ptr, T value)
+{
+    trace_store (ptr);
+    *ptr = value;
+}
+
+/** Start recording into dir, which must exist.  Call before any thread
+ *  records.  */
+inline void trace_start (const char *dir, bool binary = false)
+{
+    Trace_recorder *r = trace_recorder ();
+
+    snprintf (r->dir, sizeof (r->dir), "%s", dir);
+    r->binary = binary;
+    r->cores = 0;
+    r->next_core = 0;
+    pthread_key_create (&r->key, trace_thread_exit);
+    r->recording = true;
+}
+
+/** Stop recording and write dir/config.  Cores no thread used get empty
+ *  traces.  */
+inline void trace_stop (void)
+{
+    Trace_recorder *r = trace_recorder ();
+    char path[TRACE_RECORDER_MAX_DIR + 64];
+    FILE *file;
+
+    if (!r->recording)
+        return;
+    trace_thread_end ();
+    r->recording = false;
+    pthread_key_delete (r->key);
+
+    for (int i = 0; i < r->cores; i++)
+        if ((file = trace_open (i, "a")) != NULL)
+            fclose (file);
+
+    snprintf (path, sizeof (path), "%s/config", r->dir);
+    if ((file = fopen (path, "w")) == NULL)
+    {
+        fprintf (stderr, "Trace_recorder: unable to write %s\n", path);
+        exit (1);
+    }
+    fprintf (file, "%d\n", r->cores);
+    fclose (file);
+}
+
+#endif // TRACE_RECORDER_H_
@@ -52,5 +52,7 @@ class Processor_stat_engine;
 class Simulator_stat_engine;
 class Router_stat_engine;
 class Sim_stat_manager;
+class Bus_stat_engine;
+class Miss_latency_stat_engine;
 
 #endif
@@ -0,0 +1,118 @@
+#include <stdio.h>
+
+#include "bus.h"
+#include "processor.h"
+#include "regression.h"
+#include "settings.h"
+#include "sim.h"
+#include "watchdog.h"
+
+extern Simulator *Sim;
+extern Sim_settings settings;
+
+Watchdog::Watchdog ()
+{
+    if (settings.livelock_check && settings.watchdog_stall_cycles <= 0)
+        fatal_error ("Watchdog: invalid watchdog_stall_cycles %d\n", settings.watchdog_stall_cycles);
+
+    next_check = 0;
+    next_heartbeat = 0;
+    beat_clock = 0;
+    beat_refs = 0;
+}
+
+void Watchdog::start (void)
+{
+    next_check = Global_Clock + WATCHDOG_INTERVAL;
+    next_heartbeat = Global_Clock + settings.heartrate;
+
+    gettimeofday (&beat_wall, NULL);
+    beat_clock = Global_Clock;
+    beat_refs = references ();
+}
+
+/** References fetched by all processors.  */
+counter_t Watchdog::references (void)
+{
+    counter_t refs = 0;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+        refs += Sim->get_PR (i)->stats->loads->value + Sim->get_PR (i)->stats->stores->value;
+    return refs;
+}
+
+void Watchdog::check (void)
+{
+    int oldest = -1;
+
+    next_check = Global_Clock + WATCHDOG_INTERVAL;
+
+    if (settings.heartrate && Global_Clock >= next_heartbeat)
+        heartbeat ();
+
+    if (!settings.livelock_check)
+        return;
+
+    for (int i = 0; i < settings.num_nodes; i++)
+    {
+        Processor *pr = Sim->get_PR (i);
+
+        if (pr->outstanding_request && !pr->fast_hit_pending &&
+            (oldest < 0 || pr->issue_time < Sim->get_PR (oldest)->issue_time))
+            oldest = i;
+    }
+    if (oldest >= 0 &&
+        Global_Clock - Sim->get_PR (oldest)->issue_time >= (timestamp_t)settings.watchdog_stall_cycles)
+        stall (oldest);
+}
+
+void Watchdog::heartbeat (void)
+{
+    struct timeval now;
+    double seconds;
+    counter_t refs = references ();
+
+    gettimeofday (&now, NULL);
+    seconds = (now.tv_sec - beat_wall.tv_sec) + (now.tv_usec - beat_wall.tv_usec) / 1e6;
+    if (seconds <= 0)
+        seconds = 1e-6;
+
+    fprintf (stdout, "Heartbeat -- Clock: %lld -- %llu references -- %.0f references/s, %.0f cycles/s\n",
+             (long long int)Global_Clock, (unsigned long long int)refs,
+             (refs - beat_refs) / seconds, (Global_Clock - beat_clock) / seconds);
+    fflush (stdout);
+
+    next_heartbeat = Global_Clock + settings.heartrate;
+    beat_wall = now;
+    beat_clock = Global_Clock;
+    beat_refs = refs;
+}
+
+void Watchdog::stall (int node)
+{
+    Processor *pr = Sim->get_PR (node);
+    timestamp_t last_busy = Sim->bus->last_busy;
+    bool bus_idle = Global_Clock - last_busy >= (timestamp_t)settings.watchdog_stall_cycles / 2;
+
+    /** The dump must not vanish into the regression comparator or a muted log.  */
+    if (regression_checker)
+        regression_checker->detach ();
+    sim_log_muted = false;
+
+    fprintf (stderr, "Watchdog -- Clock: %lld -- PR %d has waited %lld cycles since cycle %lld, ",
+             (long long int)Global_Clock, node, (long long int)(Global_Clock - pr->issue_time),
+             (long long int)pr->issue_time);
+    if (bus_idle)
+        fprintf (stderr, "bus idle since cycle %lld\n", (long long int)last_busy);
+    else
+        fprintf (stderr, "bus still busy\n");
+    if (settings.ref_source == REF_SOURCE_STRESS)
+        fprintf (stderr, "Watchdog -- stress seed %d\n", settings.stress_seed);
+    else if (settings.ref_source == REF_SOURCE_SYNTHETIC)
+        fprintf (stderr, "Watchdog -- synth_pattern %d, synth seed %d\n",
+                 settings.synth_pattern, settings.synth_seed);
+
+    for (int i = 0; i < settings.num_nodes; i++)
+        Sim->dump_outstanding_requests (i);
+    fatal_error ("Watchdog: %s\n", bus_idle ? "deadlock" : "livelock");
+}
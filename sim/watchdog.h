@@ -0,0 +1,48 @@
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <sys/time.h>
+
+#include "types.h"
+
+using namespace std;
+
+/** Cycles between watchdog checks.  */
+#define WATCHDOG_INTERVAL 1024
+
+/**
+ * Forward-progress watchdog (livelock_check) and heartbeat (heartrate).  A
+ * protocol that loses a request leaves its processor waiting while the
+ * clock keeps running.  Every WATCHDOG_INTERVAL cycles the oldest
+ * outstanding processor request is checked, and once it has waited
+ * watchdog_stall_cycles the run stops with every node's outstanding request
+ * dumped.  The stall is called a deadlock if the bus has carried nothing
+ * for at least half that long, otherwise a livelock.
+ *
+ * Every heartrate cycles the references and simulated cycles per second
+ * since the last heartbeat go to stdout, which keeps them out of the
+ * simulation log and its regression comparison.
+ */
+class Watchdog {
+public:
+    Watchdog ();
+
+    timestamp_t next_check;
+    timestamp_t next_heartbeat;
+
+    /** Wall clock, cycle and references at the last heartbeat.  */
+    struct timeval beat_wall;
+    timestamp_t beat_clock;
+    counter_t beat_refs;
+
+    /** Take the baselines, after any checkpoint restore.  */
+    void start (void);
+    void check (void);
+
+private:
+    counter_t references (void);
+    void heartbeat (void);
+    void stall (int node) __attribute__ ((noreturn));
+};
+
+#endif // WATCHDOG_H_